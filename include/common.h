@@ -7,6 +7,10 @@
 #include <string.h>
 #include <math.h>
 
+// every stb_ds array allocates through the tracked allocator, see mem.h
+#include "mem.h"
+#define STBDS_REALLOC(context, ptr, size) mem_realloc((ptr), (size))
+#define STBDS_FREE(context, ptr)          mem_free(ptr)
 #include "stb_ds.h"
 
 // ----------------------------------------------------------------------------
@@ -21,6 +25,12 @@
 #define global        static
 #define local_persist static
 
+#if defined(_MSC_VER)
+#define thread_static __declspec(thread)
+#else
+#define thread_static __thread
+#endif
+
 // ----------------------------------------------------------------------------
 // concise numerical type names
 typedef float    f32;
@@ -62,6 +72,55 @@ typedef int64_t  i64;
 #define ClampBot(X,B) Max(X,B)
 #define Clamp(A,X,B) ( ((X) < (A)) ? (A) : ((X) > (B)) ? (B) : (X) )
 
+// ----------------------------------------------------------------------------
+// atomic operations, all with sequentially consistent ordering except ins_atomic_u32_load().
+// the MSVC *_eval loads are read-modify-writes, memory that's mapped read-only (another
+// process' shared memory) has to be read with ins_atomic_u32_load() and explicit fences
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define ins_atomic_u32_eval(x)                 _InterlockedOr((volatile long *)(x), 0)
+#define ins_atomic_u32_eval_assign(x, c)       _InterlockedExchange((volatile long *)(x), (c))
+#define ins_atomic_u32_add_eval(x, c)          (_InterlockedExchangeAdd((volatile long *)(x), (c)) + (c))
+#define ins_atomic_u32_eval_cond_assign(x,k,c) _InterlockedCompareExchange((volatile long *)(x), (k), (c))
+#define ins_atomic_u64_eval(x)                 _InterlockedOr64((volatile __int64 *)(x), 0)
+#define ins_atomic_u64_eval_assign(x, c)       _InterlockedExchange64((volatile __int64 *)(x), (c))
+#define ins_atomic_u64_add_eval(x, c)          (_InterlockedExchangeAdd64((volatile __int64 *)(x), (c)) + (c))
+#define ins_atomic_u32_load(x)                 (_ReadWriteBarrier(), *(volatile u32 *)(x))
+#if defined(_M_ARM64)
+#define ins_atomic_fence()                     __dmb(_ARM64_BARRIER_ISH)
+#else
+#define ins_atomic_fence()                     _mm_mfence()
+#endif
+#else
+#define ins_atomic_u32_eval(x)                 __atomic_load_n((x), __ATOMIC_SEQ_CST)
+#define ins_atomic_u32_eval_assign(x, c)       __atomic_exchange_n((x), (c), __ATOMIC_SEQ_CST)
+#define ins_atomic_u32_add_eval(x, c)          __atomic_add_fetch((x), (c), __ATOMIC_SEQ_CST)
+#define ins_atomic_u32_eval_cond_assign(x,k,c) ({ __typeof__(*(x) + 0) _k_ = (c); __atomic_compare_exchange_n((x), &_k_, (k), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); _k_; })
+#define ins_atomic_u64_eval(x)                 __atomic_load_n((x), __ATOMIC_SEQ_CST)
+#define ins_atomic_u64_eval_assign(x, c)       __atomic_exchange_n((x), (c), __ATOMIC_SEQ_CST)
+#define ins_atomic_u64_add_eval(x, c)          __atomic_add_fetch((x), (c), __ATOMIC_SEQ_CST)
+#define ins_atomic_u32_load(x)                 __atomic_load_n((x), __ATOMIC_ACQUIRE)
+#define ins_atomic_fence()                     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+// ----------------------------------------------------------------------------
+// simd, SSE2 is part of the x64 baseline so it's the only explicit path,
+// other targets take the scalar loops and rely on the compiler
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define SIMD_SSE2 0
+#endif
+
+// ----------------------------------------------------------------------------
+// bit scanning, index of the lowest set bit, x must not be zero
+#if defined(_MSC_VER)
+internal inline u32 ctz64(u64 x) { unsigned long index; _BitScanForward64(&index, x); return index; }
+#else
+#define ctz64(x) ((u32) __builtin_ctzll(x))
+#endif
+
 // ----------------------------------------------------------------------------
 // basic types
 typedef void VoidProc(void);
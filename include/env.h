@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ----------------------------------------------------------------------------
+// Batched headless Prong environments for training paddle agents.
+//
+// Each env owns its own World and is stepped at a fixed tick without a window.
+// All per-step outputs are written into caller-owned arrays, laid out env-major
+// so they can be wrapped directly (eg. numpy.frombuffer) without copying,
+// and env_step() itself never allocates.
+//
+// This header only depends on the C standard library so it can be consumed
+// from outside the game, the rest of the tree uses the types from common.h
+
+#define ENV_TICKS_PER_SEC   60
+#define ENV_MAX_EPISODE_LEN (60 * ENV_TICKS_PER_SEC)
+
+// matches InputFrame.move_left / InputFrame.move_right
+typedef enum {
+    ENV_ACTION_NONE = 0,
+    ENV_ACTION_LEFT,
+    ENV_ACTION_RIGHT,
+    ENV_ACTION_COUNT,
+} EnvAction;
+
+// observations are ENV_OBS_COUNT floats per env, in this order
+enum {
+    ENV_OBS_BALL_X = 0,
+    ENV_OBS_BALL_Y,
+    ENV_OBS_BALL_VEL_X,
+    ENV_OBS_BALL_VEL_Y,
+    ENV_OBS_PADDLE_X,
+    ENV_OBS_PADDLE_Y,
+    ENV_OBS_PADDLE_VEL_X,
+    ENV_OBS_PADDLE_VEL_Y,
+    ENV_OBS_COUNT,
+};
+
+// rewards given per step
+#define ENV_REWARD_HIT   ( 1.0f) // ball bounced off the paddle
+#define ENV_REWARD_MISS  (-1.0f) // ball reached the bottom bound, ends the episode
+
+typedef struct EnvBatch EnvBatch;
+
+// create `num_envs` independent environments, stepped on `num_threads` threads (0 = one per core).
+// every batch runs on the one shared job pool, which is restarted when the thread count differs.
+// that can't happen under a live batch, so NULL while one exists and needs another thread count
+EnvBatch *env_create(uint32_t num_envs, uint32_t num_threads, uint64_t seed);
+// same, but every thread is pinned to a core and always steps the same envs, whose worlds
+// are allocated by that thread and so live on its NUMA node. needs a pinned pool of that many
+// threads, NULL when it would have to replace the pool of a live batch to get one
+EnvBatch *env_create_pinned(uint32_t num_envs, uint32_t num_threads, uint64_t seed);
+void env_destroy(EnvBatch *batch);
+
+uint32_t env_count(const EnvBatch *batch);
+
+// totals of the threads on one NUMA node since the batch was created,
+// an unpinned batch reports all its threads on node 0
+typedef struct {
+    uint32_t num_workers;
+    uint32_t num_envs;
+    uint64_t env_steps;
+    // time spent stepping, summed over the node's threads
+    double busy_seconds;
+} EnvNodeStats;
+
+// fills nodes[0 .. max_nodes) and returns the number of nodes used
+uint32_t env_node_stats(const EnvBatch *batch, EnvNodeStats *nodes, uint32_t max_nodes);
+
+// reset every env and write the initial observations, `observations` holds num_envs * ENV_OBS_COUNT floats
+void env_reset(EnvBatch *batch, float *observations);
+
+// advance every env by one tick using one EnvAction per env,
+// envs that finish an episode are reset in place and report done = 1 along with their first new observation
+void env_step(EnvBatch *batch, const uint8_t *actions, float *observations, float *rewards, uint8_t *dones);
+
+// what the built-in CPU player would do in every env right now, one EnvAction per env,
+// for bots, baselines and soak tests. it predicts the ball in closed form, it doesn't step anything
+void env_ai_actions(EnvBatch *batch, uint8_t *actions);
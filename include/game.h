@@ -1,7 +1,9 @@
 #pragma once
 
 #include "common.h"
+#include "os.h"
 #include "raylib.h"
+#include "telemetry.h"
 
 // ----------------------------------------------------------------------------
 // Convenience functions
@@ -30,16 +32,46 @@ global inline f32 calc_approach(f32 t, f32 target, f32 delta) {
     return (t < target) ? calc_min(t + delta, target) : calc_max(t - delta, target);
 }
 
-global inline f32 calc_unit_random() {
-    return GetRandomValue(0, 1000) / 1000.0f;
+global inline f32 calc_clamp(f32 val, f32 min, f32 max) {
+    return (val < min) ? min : ((val > max) ? max : val);
 }
 
-global inline f32 calc_signed_random() {
-    return (GetRandomValue(0, 1000) / 500.0f) - 1.0f;
+// ----------------------------------------------------------------------------
+// Random numbers, xoshiro128+ run as 4 independent lanes so a batch fill produces 4 values
+// per SSE2 step. The SSE2 and scalar paths give the same stream for a seed on every platform.
+// Every world carries a stream of its own and so does every thread, none of them are shared,
+// so a stream is only ever touched by whoever owns it
+
+#define RNG_LANES 4
+
+typedef struct {
+    // word-major, state[w] holds word w of every lane
+    u32 state[4][RNG_LANES];
+    // one step's worth of values for the single value draws
+    u32 buffered[RNG_LANES];
+    u32 num_buffered;
+} Rng;
+
+// any seed works, zero included, it's spread over the state with splitmix64
+void rng_seed(Rng *rng, u64 seed);
+u32 rng_next_u32(Rng *rng);
+// [0, 1) and [-1, 1), with 24 bits of resolution
+f32 rng_unit(Rng *rng);
+f32 rng_signed(Rng *rng);
+void rng_fill_unit(Rng *rng, f32 *out, u32 count);
+void rng_fill_signed(Rng *rng, f32 *out, u32 count);
+
+// the calling thread's stream, seeded on first use from the order threads first asked for one,
+// threads that need a reproducible stream seed it themselves
+Rng *rng_thread();
+void rng_seed_thread(u64 seed);
+
+global inline f32 calc_unit_random() {
+    return rng_unit(rng_thread());
 }
 
-global inline f32 calc_clamp(f32 val, f32 min, f32 max) {
-    return (val < min) ? min : ((val > max) ? max : val);
+global inline f32 calc_signed_random() {
+    return rng_signed(rng_thread());
 }
 
 // ----------------------------------------------------------------------------
@@ -47,8 +79,10 @@ global inline f32 calc_clamp(f32 val, f32 min, f32 max) {
 
 void Init();
 void Update();
-void UpdateGameplay();
+void UpdateInput();
+void UpdateGameplay(f64 tick_time);
 void DrawFrame();
+void WaitForNextFrame();
 void Shutdown();
 
 // ----------------------------------------------------------------------------
@@ -108,6 +142,14 @@ typedef struct {
     f32 *remainder_y;
     f32 *friction;
     f32 *gravity;
+    // contact response, an inverse mass of zero makes the body kinematic:
+    // it still moves under its own velocity but contacts never push it around
+    f32 *inv_mass;
+    f32 *restitution;
+    f32 *contact_friction;
+    // seconds spent resting on something, asleep bodies skip integration until woken
+    f32 *sleep_seconds;
+    bool *asleep;
 } Movements;
 
 typedef u32 CollisionMask;
@@ -122,9 +164,42 @@ typedef enum {
     SHAPE_NONE = 0,
     SHAPE_CIRC,
     SHAPE_RECT,
+    SHAPE_TILEMAP,
     SHAPE_COUNT,
 } Shape;
 
+// static level geometry as a packed grid of solid bits, positioned by its corner like a rect.
+// one bit per cell, row-major, each row padded to whole words
+typedef struct {
+    u32 cols;
+    u32 rows;
+    u32 cell_size;
+    u32 words_per_row;
+    u64 *cells;
+} Tilemap;
+
+// solid bits for cells col0..col1 of a row, bit i is cell col0 + i.
+// spans are limited to 64 cells and anything outside the map reads as empty
+global inline u64 tilemap_row_span(const Tilemap *tilemap, i32 row, i32 col0, i32 col1) {
+    if (row < 0 || row >= (i32) tilemap->rows) return 0;
+    col1 = Min(col1, col0 + 63);
+    i32 first = Max(col0, 0);
+    i32 last = Min(col1, (i32) tilemap->cols - 1);
+    if (first > last) return 0;
+
+    const u64 *words = tilemap->cells + (u64) row * tilemap->words_per_row;
+    u32 word = first / 64;
+    u32 bit = first % 64;
+    u64 bits = words[word] >> bit;
+    if (bit != 0 && word + 1 < tilemap->words_per_row) {
+        bits |= words[word + 1] << (64 - bit);
+    }
+
+    u32 count = last - first + 1;
+    if (count < 64) bits &= (1ull << count) - 1;
+    return bits << (first - col0);
+}
+
 typedef void (*OnHitFunc)(Entity entity, Entity collided_with);
 typedef struct {
     // offsets from entity position, typically {0, 0}
@@ -137,8 +212,53 @@ typedef struct {
     CollisionMask *mask;
     OnHitFunc *on_hit_x;
     OnHitFunc *on_hit_y;
+    // only filled in for SHAPE_TILEMAP, width and height cover the whole grid
+    Tilemap *tilemaps;
 } Colliders;
 
+// the part of every collider that overlap tests read, packed with its position into blocks
+// of COLLIDER_BLOCK_LANES entities (entity e is lane e % 8 of block e / 8), so a test streams
+// one contiguous block instead of touching a cache line in each of the columns above.
+// x and y are the corner of the collider's bounds, circles are centered in theirs.
+//
+// the blocks are rebuilt from the columns at the start of world_update() and moves write
+// through to both, the columns stay the source of truth outside of the update
+#define COLLIDER_BLOCK_LANES 8
+
+typedef struct {
+    i32 x[COLLIDER_BLOCK_LANES];
+    i32 y[COLLIDER_BLOCK_LANES];
+    i32 width[COLLIDER_BLOCK_LANES];
+    i32 height[COLLIDER_BLOCK_LANES];
+    i32 radius[COLLIDER_BLOCK_LANES];
+    CollisionMask mask[COLLIDER_BLOCK_LANES];
+    u8 shape[COLLIDER_BLOCK_LANES];
+    // one bit per lane, entities with a collider and the ones among them that have movement
+    u32 colliders;
+    u32 moving;
+} ColliderBlock;
+
+// a hit found by a swept move, queued when World.defer_hit_events is set
+typedef struct {
+    Entity entity;
+    Entity other;
+    Axis axis;
+    i32 contact_x;
+    i32 contact_y;
+    OnHitFunc on_hit;
+} CollisionEvent;
+
+typedef struct {
+    // queued this tick, in the order the moves found them
+    CollisionEvent *queued;
+    // scratch for regrouping by handler before dispatch
+    CollisionEvent *sorted;
+    OnHitFunc *handlers;
+    u32 *handler_counts;
+    // the event whose handler is running, lets handlers read the axis and contact point
+    CollisionEvent *dispatching;
+} CollisionEvents;
+
 typedef u32 ComponentMask;
 enum {
     COMPONENT_NONE     = 0,
@@ -148,12 +268,390 @@ enum {
     COMPONENT_COLLIDER = (1 << 3),
 };
 
+// ----------------------------------------------------------------------------
+// Runtime components, registered per world and stored in sparse sets
+// so an entity only pays memory for the components it actually has
+
+// ids below COMPONENT_BUILTIN_COUNT are the fixed columns above (bit index of their ComponentMask flag),
+// registered components are handed out after those
+typedef u32 ComponentId;
+enum {
+    COMPONENT_ID_NAME = 0,
+    COMPONENT_ID_POSITION,
+    COMPONENT_ID_MOVEMENT,
+    COMPONENT_ID_COLLIDER,
+};
+#define COMPONENT_BUILTIN_COUNT 4
+#define COMPONENT_MAX 256
+global const ComponentId COMPONENT_ID_INVALID = 0xFFFFFFFF;
+
+typedef struct {
+    u64 bits[COMPONENT_MAX / 64];
+} ComponentSignature;
+
+// sparse lookups are split into pages that are only allocated once an entity in their range gets the component
+#define SPARSE_PAGE_SIZE 256
+
+typedef struct {
+    const char *name;
+    u32 element_size;
+
+    // entity -> dense index + 1, 0 means the entity doesn't have this component
+    u32 **sparse_pages;
+    // densely packed, iterate these directly to visit every instance
+    Entity *dense_entities;
+    u8 *dense_data;
+    u32 count;
+} ComponentStore;
+
+typedef struct {
+    ComponentStore *stores;
+} ComponentRegistry;
+
 typedef struct {
     bool *in_use;
     bool *active;
     ComponentMask *components;
+    ComponentSignature *signatures;
 } EntityInfos;
 
+// ----------------------------------------------------------------------------
+// Narrow phase, candidate pairs are bucketed by shape combination so each bucket
+// runs through one branch-free kernel that tests NARROW_PHASE_BATCH pairs at a time
+
+typedef enum {
+    PAIR_CIRC_CIRC = 0,
+    PAIR_CIRC_RECT,  // the circle is always entity a
+    PAIR_RECT_RECT,
+    PAIR_KIND_COUNT,
+} PairKind;
+
+#define NARROW_PHASE_BATCH 8
+
+// pair geometry gathered into flat columns, circles keep their radius in `w`,
+// padded with empty pairs up to a whole batch
+typedef struct {
+    Entity *a;
+    Entity *b;
+    f32 *a_x;
+    f32 *a_y;
+    f32 *a_w;
+    f32 *a_h;
+    f32 *b_x;
+    f32 *b_y;
+    f32 *b_w;
+    f32 *b_h;
+    // one bit per pair, one byte per batch
+    u8 *hit_masks;
+    u32 count;
+} PairBucket;
+
+typedef struct {
+    PairBucket buckets[PAIR_KIND_COUNT];
+    // colliders are grown by this much, so pairs that are about to touch are reported too
+    f32 margin;
+} NarrowPhase;
+
+// the buckets are reserved for a few pairs per collider up front, so they've reached their working size
+// before the first pair ever touches and a steady state never sees them grow, see mem.h
+void narrow_phase_begin(NarrowPhase *narrow, f32 margin, u32 num_circles, u32 num_rects);
+void narrow_phase_add_pair(NarrowPhase *narrow, Entity a, Entity b);
+void narrow_phase_run(NarrowPhase *narrow);
+u32 narrow_phase_pair_count(NarrowPhase *narrow);
+void narrow_phase_free(NarrowPhase *narrow);
+
+// ----------------------------------------------------------------------------
+// Contact solver, touching pairs from the narrow phase are resolved with sequential
+// impulses: every contact is solved in turn, `iterations` times over, with each contact's
+// accumulated impulse clamped so it can only push. The impulses are kept for the next
+// tick and reapplied up front (warm starting), so resting piles start out nearly solved.
+//
+// Pairs within `contact_margin` of touching count as touching. Swept moves stop bodies
+// a pixel short of bounds, this is what lets a pile rest on them.
+// Bodies with on_hit handlers keep handling bounds themselves.
+
+// normal points from a to b, a negative penetration is the gap between them.
+// contacts are identified by (key, cell): the pair a << 32 | b, and for a body against a
+// tilemap the solid cell's index + 1, zero for every other pair
+typedef struct {
+    Entity a;
+    Entity b;
+    u64 key;
+    u32 cell;
+    f32 normal_x;
+    f32 normal_y;
+    f32 penetration;
+    f32 inv_mass_a;
+    f32 inv_mass_b;
+    f32 normal_mass;
+    f32 friction;
+    // separating speed the solver aims for, from restitution
+    f32 bounce;
+    f32 impulse;
+    f32 tangent_impulse;
+} Contact;
+
+typedef struct {
+    u32 iterations;
+    // fraction of last tick's impulse to reapply before iterating
+    f32 warm_start;
+    // approach speed below which contacts don't bounce, stops resting bodies from buzzing
+    f32 bounce_threshold;
+    // penetration that's left alone, and the fraction of the rest removed per tick
+    f32 position_slop;
+    f32 position_correction;
+    f32 contact_margin;
+    // bodies in contact and slower than sleep_speed for sleep_seconds fall asleep,
+    // a sleep_seconds of zero keeps everything awake
+    f32 sleep_speed;
+    f32 sleep_seconds;
+
+    Contact *contacts;
+    Contact *prev_contacts;  // sorted by key and cell
+    bool *touching;          // per entity, this tick
+} ContactSolver;
+
+// reserves a few contacts per collider, for the same reason as narrow_phase_begin()
+void contact_solver_begin(ContactSolver *solver, u32 num_colliders);
+void contact_solver_add(ContactSolver *solver, Entity a, Entity b);
+void contact_solver_run(ContactSolver *solver, f32 dt);
+// carries last tick's contacts over to the entities' new ids, see world_compact_entities()
+void contact_solver_remap(ContactSolver *solver, const Entity *remap);
+void contact_solver_free(ContactSolver *solver);
+
+// what the last world_update() spent its time on
+typedef struct {
+    // phase timings are only measured while World.collect_stats is set, reading the clock isn't free
+    f64 move_seconds;
+    f64 overlap_seconds;
+    f64 dispatch_seconds;
+    // narrow-phase shape tests, always counted
+    u32 collision_checks;
+    u32 contacts;
+    u32 sleeping_bodies;
+} WorldStats;
+
+// ----------------------------------------------------------------------------
+// Deferred structural commands. Creating an entity can reallocate every column, so
+// nothing that runs during an update (systems, on_hit handlers, parallel jobs) may
+// create, destroy or add/remove components directly. Those changes are recorded into
+// a per-worker command buffer instead and applied in one sorted batch by
+// world_apply_commands(), which world_update() calls once the tick is done.
+//
+// Creates are applied first, ordered by the entity that asked for them (`origin`) and then
+// by recording order, so spawns get the same ids whichever worker recorded them. Component
+// adds and removes follow, sorted by entity and applied in recording order per entity,
+// destroys go last so anything destroyed this tick stays destroyed.
+
+// handles returned by world_defer_create() until the batch is applied,
+// they can be passed to the other world_defer_* calls of the same batch
+#define ENTITY_PENDING_BIT 0x80000000u
+#define COMMAND_BUFFER_MAX_WORKERS 64
+
+typedef enum {
+    COMMAND_CREATE = 0,
+    COMMAND_ADD_COMPONENT,
+    COMMAND_REMOVE_COMPONENT,
+    COMMAND_DESTROY,
+} CommandKind;
+
+// runs when a deferred create is applied, the new entity can be set up directly from here
+typedef void (*SpawnFunc)(Entity entity, const void *args);
+
+typedef struct {
+    CommandKind kind;
+    Entity entity;
+    Entity origin;
+    ComponentId component;
+    SpawnFunc spawn;
+    // payload in the recording buffer's data, spawn args or the component's initial value
+    u32 data_offset;
+    u32 data_size;
+    u32 sequence;
+    u32 buffer;
+} WorldCommand;
+
+// only ever touched by the worker it belongs to
+typedef struct {
+    WorldCommand *commands;
+    u8 *data;
+    u32 num_creates;
+} CommandBuffer;
+
+typedef struct {
+    CommandBuffer buffers[COMMAND_BUFFER_MAX_WORKERS];
+    // scratch for world_apply_commands(), kept around so it stops allocating
+    WorldCommand *sorted;
+    u8 *data;
+    Entity *created;
+    u32 created_offsets[COMMAND_BUFFER_MAX_WORKERS];
+} WorldCommands;
+
+// ----------------------------------------------------------------------------
+// Spatial index and batched queries. Every positioned entity is bucketed by its bounds
+// into a uniform grid of SPATIAL_CELL_SIZE cells, hashed so the world needs no fixed extent.
+// Colliders covering more than SPATIAL_MAX_CELLS cells (level bounds, tilemaps) are kept on
+// a short list that every query checks directly instead.
+//
+// world_update() builds the index after the move phase for its broad phase once there are enough
+// colliders, and again at the end of the tick while World.spatial_queries is set, so queries see
+// the world as of the end of the last update. Anything created or moved outside of an update, or a
+// world without the flag, needs a world_build_spatial_index() first.
+//
+// Queries are read only and split across the job pool when there are enough of them.
+// A collider matches a query when it shares any bit with the query's mask, and touching counts
+// as overlapping. Results are written into caller-owned arrays, query i owns the slice
+// [i * max_results, (i + 1) * max_results) and counts[i] says how much of it is used.
+
+#define SPATIAL_CELL_SHIFT 6
+#define SPATIAL_CELL_SIZE (1 << SPATIAL_CELL_SHIFT)
+#define SPATIAL_MAX_CELLS 16
+// with fewer colliders than this the broad phase pairs everything, cheaper than building the index
+#define SPATIAL_BROAD_PHASE_MIN_COLLIDERS 64
+
+// bounds are inclusive, a zero sized position-only entity has x0 == x1
+typedef struct {
+    Entity entity;
+    CollisionMask mask;
+    i32 x0;
+    i32 y0;
+    i32 x1;
+    i32 y1;
+} SpatialEntry;
+
+typedef struct {
+    // entries of bucket b are entries[bucket_starts[b] .. bucket_starts[b + 1]),
+    // an entry is in the bucket of every cell its bounds touch
+    u32 bucket_mask;
+    u32 *bucket_starts;
+    SpatialEntry *entries;
+    SpatialEntry *large;
+    // every indexed entity once, large ones included
+    SpatialEntry *items;
+    // cells covered by `entries`, rays stop walking once they leave them
+    i32 cell_x0;
+    i32 cell_y0;
+    i32 cell_x1;
+    i32 cell_y1;
+    // broad phase scratch, see world_resolve_overlaps()
+    Entity *candidates;
+} SpatialIndex;
+
+typedef struct {
+    Rectangle bounds;
+    CollisionMask mask;
+    Entity ignore;
+} AabbQuery;
+
+typedef struct {
+    Vector2 center;
+    f32 radius;
+    CollisionMask mask;
+    Entity ignore;
+} CircleQuery;
+
+typedef struct {
+    Vector2 origin;
+    Vector2 direction;  // normalized by the query
+    f32 max_distance;
+    CollisionMask mask;
+    Entity ignore;
+} RayQuery;
+
+// rays that start inside a collider hit it at distance 0, facing back along the ray
+typedef struct {
+    Entity entity;      // ENTITY_NONE for a miss
+    f32 distance;
+    Vector2 point;
+    Vector2 normal;
+} RayHit;
+
+void world_build_spatial_index();
+void world_cleanup_spatial_index();
+// the query functions return how many queries found more than max_results hits, the extra ones are dropped
+u32 world_query_aabb(const AabbQuery *queries, u32 num_queries, Entity *results, u32 max_results, u32 *counts);
+u32 world_query_circle(const CircleQuery *queries, u32 num_queries, Entity *results, u32 max_results, u32 *counts);
+// nearest hit of every ray
+void world_raycast(const RayQuery *queries, u32 num_queries, RayHit *hits);
+// every hit of every ray, nearest first, the farthest hits are the ones dropped
+u32 world_raycast_all(const RayQuery *queries, u32 num_queries, RayHit *hits, u32 max_hits, u32 *counts);
+// broad phase candidates, every entity above `entity` whose bounds come within `margin` of its own,
+// appended in ascending order to the stb_ds array `candidates`
+void spatial_index_candidates(Entity entity, i32 margin, Entity **candidates);
+// world_query_visible(), by bounds and regardless of mask
+void spatial_index_visible(Rectangle view, Entity **visible);
+
+// ----------------------------------------------------------------------------
+// Entity storage maintenance. Ids are handed out in creation order and never reused, so
+// entities that are close in space end up scattered over the columns, and destroyed ones
+// leave holes. world_compact_entities() sorts the live entities by the Morton (Z-order) code
+// of their bounds' center and packs them to the front, after which neighbours in space are
+// neighbours in every column and collider block.
+//
+// The pass gives entities new ids. Every handle the world holds itself (registered components,
+// warm start contacts, the spatial index) is remapped; handles held anywhere else have to be
+// passed through world_remap_entity() before they're used again. It sorts and copies every
+// column, so it's meant to run every few seconds between updates, never during one
+
+typedef struct {
+    u64 key;
+    Entity entity;
+} CompactionItem;
+
+typedef struct {
+    // id before the last pass -> id after it, ENTITY_NONE for slots that were dead
+    Entity *remap;
+    u32 passes;
+    // scratch, kept between passes so they stop allocating
+    CompactionItem *items;
+    Entity *order;
+    u8 *gather;
+} EntityCompaction;
+
+// false if the entities were already in order without holes, nothing moved and no handle changed
+bool world_compact_entities();
+// sizes the scratch for the current entity count, a pass after it allocates nothing unless
+// entities were created in between
+void world_reserve_compaction();
+// what a handle from before the last pass is now, ENTITY_NONE if it was destroyed.
+// handles are left as they are until the first pass
+Entity world_remap_entity(Entity entity);
+void world_cleanup_compaction();
+
+// ----------------------------------------------------------------------------
+// World checksums, every simulation column is hashed on its own so two runs that
+// drift apart can tell which column went first, `combined` is what gets compared per tick.
+// Floats are hashed as bits, so -0 and 0 (or two NaNs) count as different
+
+typedef enum {
+    CHECKSUM_COMPONENTS = 0,
+    CHECKSUM_POSITION_X,
+    CHECKSUM_POSITION_Y,
+    CHECKSUM_VELOCITY_X,
+    CHECKSUM_VELOCITY_Y,
+    CHECKSUM_REMAINDER_X,
+    CHECKSUM_REMAINDER_Y,
+    CHECKSUM_SLEEP_SECONDS,
+    CHECKSUM_ASLEEP,
+    CHECKSUM_COLLIDER_OFFSET_X,
+    CHECKSUM_COLLIDER_OFFSET_Y,
+    CHECKSUM_COLLIDER_WIDTH,
+    CHECKSUM_COLLIDER_HEIGHT,
+    CHECKSUM_COLLIDER_RADIUS,
+    CHECKSUM_COLLIDER_SHAPE,
+    CHECKSUM_COLLIDER_MASK,
+    CHECKSUM_COLUMN_COUNT,
+} ChecksumColumn;
+
+typedef struct {
+    u64 columns[CHECKSUM_COLUMN_COUNT];
+    u64 combined;
+} WorldChecksum;
+
+// 64 bit hash of a byte range, the SSE2 and scalar paths give the same result
+u64 checksum_bytes(const void *data, u64 size, u64 seed);
+const char *checksum_column_name(ChecksumColumn column);
+
 typedef struct {
     bool initialized;
 
@@ -164,51 +662,664 @@ typedef struct {
     Positions positions;
     Movements movements;
     Colliders colliders;
-} World;
+    ColliderBlock *collider_blocks;
+    ComponentRegistry registry;
+
+    // when set, on_hit callbacks are queued during the physics phase
+    // and dispatched in a batch per handler at the end of world_update()
+    bool defer_hit_events;
+    CollisionEvents hit_events;
+
+    // when set, world_update() rebuilds `spatial` once the tick is done so queries see where everything ended up
+    bool spatial_queries;
+    SpatialIndex spatial;
 
-extern World world;
+    // structural changes recorded during the update, see world_apply_commands()
+    WorldCommands commands;
 
+    // the last world_compact_entities() pass
+    EntityCompaction compaction;
+
+    bool collect_stats;
+    WorldStats stats;
+
+    // when set, world_update() hashes the world into `checksum` at the end of every tick
+    bool collect_checksums;
+    WorldChecksum checksum;
+
+    // for spawning and jitter, world_init() seeds it with a fixed seed and owners can reseed it with rng_seed()
+    Rng rng;
+
+    // scratch for the overlap phase of world_update(), kept around so it stops allocating
+    NarrowPhase narrow_phase;
+    // tuning can be changed any time after world_init(), the contacts persist between ticks
+    ContactSolver solver;
+} World;
+
+// the world that world_* and entity_* functions operate on, bound per thread
+// so that independent worlds can be stepped in parallel (see env.c)
+extern thread_static World *world;
 
 void world_init();
 void world_update(f32 dt);
 void world_cleanup();
+void world_log();
+
+WorldChecksum world_checksum();
+// the first column that differs, or CHECKSUM_COLUMN_COUNT when the checksums match
+ChecksumColumn world_checksum_compare(const WorldChecksum *a, const WorldChecksum *b);
 
 Entity world_create_entity();
 void world_destroy_entity(Entity entity);
 
 bool entity_has_components(Entity entity, ComponentMask mask);
+bool entity_get_bounds(Entity entity, Rectangle *bounds);
+
+// append every positioned entity whose bounds overlap `view` to the stb_ds array `visible`, in entity order
+void world_query_visible(Rectangle view, Entity **visible);
 
 void entity_add_name(Entity entity, NameStr name);
 void entity_add_position(Entity entity, u32 x, u32 y);
 void entity_add_velocity(Entity entity, f32 vel_x, f32 vel_y, f32 friction, f32 gravity);
+// needs a velocity first, a mass of zero makes the body kinematic.
+// contact friction limits sliding along contacts, the weaker of the two bodies wins
+// and bodies without a velocity always grip
+void entity_set_body(Entity entity, f32 mass, f32 restitution, f32 contact_friction);
+void entity_wake(Entity entity);
 void entity_add_collider_rect(Entity entity, CollisionMask mask, u32 offset_x, u32 offset_y, u32 width, u32 height);
 void entity_add_collider_circ(Entity entity, CollisionMask mask, u32 offset_x, u32 offset_y, u32 radius);
+// starts out empty, overlap tests against it only look at the cells under the other collider
+// so a detailed level costs the same per query as an empty one
+void entity_add_collider_tilemap(Entity entity, CollisionMask mask, u32 offset_x, u32 offset_y, u32 cell_size, u32 cols, u32 rows);
+void entity_set_tile(Entity entity, u32 col, u32 row, bool solid);
+
+// the buffer for job worker `worker` (see JobRangeFunc), code that isn't running as a job uses worker 0
+CommandBuffer *world_command_buffer(u32 worker);
+// returns a pending handle, `spawn` gets the real entity and a copy of `args` when the batch is applied
+Entity world_defer_create(CommandBuffer *buffer, Entity origin, SpawnFunc spawn, const void *args, u32 args_size);
+void world_defer_destroy(CommandBuffer *buffer, Entity entity);
+// returns the zeroed initial value to fill in, valid until the next command recorded into `buffer`
+void *world_defer_add_component(CommandBuffer *buffer, Entity entity, ComponentId id);
+void world_defer_remove_component(CommandBuffer *buffer, Entity entity, ComponentId id);
+// apply and clear every buffer, commands recorded while applying (eg. by a SpawnFunc) wait for the next call
+void world_apply_commands();
+void world_cleanup_commands();
+
+ComponentId world_register_component(const char *name, u32 element_size);
+ComponentId world_find_component(const char *name);
+u32 world_component_count(ComponentId id);
+Entity *world_component_entities(ComponentId id);
+void *world_component_data(ComponentId id);
+
+// zeroed data for the new component, NULL for an unregistered id or an entity that isn't alive
+void *entity_add_component(Entity entity, ComponentId id);
+void *entity_get_component(Entity entity, ComponentId id);
+void entity_remove_component(Entity entity, ComponentId id);
+bool entity_has_component(Entity entity, ComponentId id);
+bool entity_has_signature(Entity entity, const ComponentSignature *signature);
+// points every sparse set at the entities' new ids, see world_compact_entities()
+void world_remap_registry(const Entity *remap);
+void world_cleanup_registry();
+
+global inline void signature_set(ComponentSignature *signature, ComponentId id) {
+    signature->bits[id / 64] |= (1ull << (id % 64));
+}
+
+global inline void signature_clear(ComponentSignature *signature, ComponentId id) {
+    signature->bits[id / 64] &= ~(1ull << (id % 64));
+}
+
+global inline bool signature_test(const ComponentSignature *signature, ComponentId id) {
+    return (signature->bits[id / 64] & (1ull << (id % 64))) != 0;
+}
+
+global inline bool signature_intersects(const ComponentSignature *a, const ComponentSignature *b) {
+    u64 shared = 0;
+    for (u32 i = 0; i < COMPONENT_MAX / 64; i++) {
+        shared |= a->bits[i] & b->bits[i];
+    }
+    return shared != 0;
+}
+
+// ----------------------------------------------------------------------------
+// System scheduler, systems declare which component columns they read and write
+// and scheduler_run() builds a dependency graph from that every time it runs:
+// a system waits for every earlier registered system that writes something it touches,
+// or that reads something it writes. Everything else runs side by side on the job pool
+// (jobs_run_graph()), longest remaining chain first, so a system that shares nothing with the critical path
+// doesn't make the frame any longer.
+//
+// Systems run with the world of the thread that called scheduler_run() bound.
+// Structural changes go through the command buffer of the `worker` they're given
+// (see world_command_buffer()), exclusive systems may also change the world directly
+
+typedef void (*SystemFunc)(void *data, u32 worker);
+
+typedef struct {
+    const char *name;
+    SystemFunc run;
+    void *data;
+    ComponentSignature reads;
+    ComponentSignature writes;
+    // orders against every other system, for things like world_update() that touch all of it
+    bool exclusive;
+    bool disabled;
+} System;
 
+typedef struct {
+    System *systems;
+
+    // rebuilt by scheduler_run() from the enabled systems
+    u32 *order;             // by longest remaining chain, the order idle workers pick from
+    u32 *dependents;        // dependents of system i are [dependent_offsets[i], dependent_offsets[i + 1])
+    u32 *dependent_offsets;
+    u32 *chain_lengths;     // systems on the longest chain starting at each one
+    u32 *pending;           // dependencies, see jobs_run_graph()
+    World *world;
+
+    // from the last scheduler_run()
+    f64 *seconds;
+    u32 critical_path;
+} Scheduler;
+
+// returns the system's index, systems keep their index for as long as the scheduler lives
+u32 scheduler_add(Scheduler *scheduler, System system);
+void scheduler_set_enabled(Scheduler *scheduler, u32 system, bool enabled);
+// runs every enabled system once, blocks until they've all finished
+void scheduler_run(Scheduler *scheduler);
+void scheduler_free(Scheduler *scheduler);
+
+// column sets for System.reads and System.writes, eg. signature_of(2, (ComponentId[]) {COMPONENT_ID_POSITION, hp_id})
+global inline ComponentSignature signature_of(u32 count, const ComponentId *ids) {
+    ComponentSignature signature = {0};
+    for (u32 i = 0; i < count; i++) {
+        signature_set(&signature, ids[i]);
+    }
+    return signature;
+}
+
+// single pair overlap tests, these do exactly the same float math as the batch kernels
+// in narrowphase.c so a pair gives the same answer whichever path tests it
 global inline bool rect_rect_overlaps(i32 x1, i32 y1, i32 w1, i32 h1, i32 x2, i32 y2, i32 w2, i32 h2) {
-    Rectangle a = { x1, y1, w1, h1 };
-    Rectangle b = { x2, y2, w2, h2 };
-    return CheckCollisionRecs(a, b);
+    return x1 < x2 + w2 && x1 + w1 > x2
+        && y1 < y2 + h2 && y1 + h1 > y2;
 }
 
 global inline bool circ_rect_overlaps(i32 cx, i32 cy, i32 cr, i32 rx, i32 ry, i32 rw, i32 rh) {
-    Vector2 c = { cx, cy };
-    Rectangle r = { rx, ry, rw, rh };
-    return CheckCollisionCircleRec(c, cr, r);
+    f32 half_w = rw * 0.5f;
+    f32 half_h = rh * 0.5f;
+    f32 dx = fabsf(cx - (rx + half_w));
+    f32 dy = fabsf(cy - (ry + half_h));
+    f32 corner_x = calc_max(dx - half_w, 0);
+    f32 corner_y = calc_max(dy - half_h, 0);
+    return dx <= half_w + cr && dy <= half_h + cr
+        && corner_x * corner_x + corner_y * corner_y <= (f32) cr * cr;
 }
 
 global inline bool circ_circ_overlaps(i32 x1, i32 y1, i32 r1, i32 x2, i32 y2, i32 r2) {
-    Vector2 c1 = { x1, y1 };
-    Vector2 c2 = { x2, y2 };
-    return CheckCollisionCircles(c1, r1, c2, r2);
+    f32 dx = x2 - x1;
+    f32 dy = y2 - y1;
+    f32 radii = r1 + r2;
+    return dx * dx + dy * dy <= radii * radii;
 }
 
-void circ_circ_resolve(Entity entity, Entity collided_with);
-void circ_rect_resolve(Entity entity, Entity collided_with);
-void rect_rect_resolve(Entity entity, Entity collided_with);
+// ----------------------------------------------------------------------------
+// Arena, the gameplay rules shared by the game and the headless environments
+
+typedef struct {
+    i32 width;
+    i32 height;
+
+    Entity ball;
+    Entity paddle;
+    Entity bounds_l;
+    Entity bounds_r;
+    Entity bounds_t;
+    Entity bounds_b;
+} Arena;
+
+void arena_create(Arena *arena, i32 width, i32 height);
+void arena_reset(Arena *arena, f32 ball_vel_x, f32 ball_vel_y);
+void arena_update_paddle(Arena *arena, bool move_left, bool move_right, f32 dt);
+// after world_compact_entities()
+void arena_remap(Arena *arena);
+
+// where and when the ball's center next comes down to the top of the paddle
+typedef struct {
+    f32 time;           // seconds from now
+    Vector2 point;
+    Vector2 velocity;   // at the intercept
+    u32 bounces;        // off the walls on the way
+} BallPrediction;
+
+// solves the ball's path in closed form from its velocity and gravity, reflecting off the bounds
+// walls like the ball's on_hit handlers do, in O(bounces). false if it never comes down to the paddle.
+// `dt` is the tick the world is stepped at, the integration's half tick of gravity is accounted for
+bool arena_predict_ball(const Arena *arena, f32 dt, BallPrediction *prediction);
+// a CPU player, presses the same move_left / move_right an InputFrame would to catch the predicted ball
+void arena_ai_paddle(const Arena *arena, f32 dt, bool *move_left, bool *move_right);
+
+// ----------------------------------------------------------------------------
+// Particles, a standalone pool kept out of the ECS so that hundreds of thousands
+// of short lived particles never touch the entity loops in world_update()
+
+#define PARTICLES_MAX (1 << 18)
+
+typedef struct {
+    u32 count;
+    u32 capacity;
+    Rng rng;
+
+    // tunables applied to every particle
+    f32 gravity;
+    f32 drag;
+
+    // structure of arrays, padded to a multiple of 4 so the simd loops never need a tail
+    f32 *x;
+    f32 *y;
+    f32 *vel_x;
+    f32 *vel_y;
+    f32 *life;
+    f32 *inv_lifetime;
+    f32 *fade;
+    f32 *size;
+    Color *color;
+} ParticleSystem;
+
+void particles_init(ParticleSystem *ps, u32 capacity);
+void particles_free(ParticleSystem *ps);
+void particles_clear(ParticleSystem *ps);
+void particles_update(ParticleSystem *ps, f32 dt);
+void particles_draw(ParticleSystem *ps, Rectangle view);
+
+void particles_emit(ParticleSystem *ps, f32 x, f32 y, f32 vel_x, f32 vel_y, f32 lifetime, f32 size, Color color);
+void particles_emit_burst(ParticleSystem *ps, f32 x, f32 y, u32 count, f32 speed, f32 lifetime, f32 size, Color color);
+
+extern ParticleSystem particles;
+
+// ----------------------------------------------------------------------------
+// Entity inspector, a debug panel listing the entities that pass a filter.
+// The render thread only ever sees the rows inside the list's view: it asks for them
+// through a seqlocked request and the simulation copies just those rows into the next
+// snapshot. Filters are matched by a scan that looks at INSPECTOR_SCAN_PER_TICK entities
+// a tick and keeps the last complete pass on show while the next one runs, so a tick
+// costs the same however big the world is. Edits go back as single field changes
+// through a single producer, single consumer ring and are applied before the next physics step.
+// The render thread's ids are stamped with the compaction pass they're from, the simulation
+// looks up whatever is a pass behind by its new id and hands the new one back in the snapshot
+
+#define INSPECTOR_MAX_ROWS 64
+#define INSPECTOR_NAME_FILTER_LEN 32
+#define INSPECTOR_ROW_NAME_LEN 24
+#define INSPECTOR_SCAN_PER_TICK 16384
+#define INSPECTOR_EDITS_MAX 64
+
+// an entity is listed when it has every component in `components`, a collider sharing a bit
+// with `collision` and a name containing `name`, each only when set. no filter lists every entity
+typedef struct {
+    ComponentMask components;
+    CollisionMask collision;
+    char name[INSPECTOR_NAME_FILTER_LEN];
+} InspectorFilter;
+
+typedef struct {
+    InspectorFilter filter;
+    // rows of the list the render thread has in view
+    u32 first_row;
+    u32 num_rows;
+    Entity selected;
+    // world_compact_entities() passes the world had been through when `selected` was picked
+    u32 compaction_passes;
+} InspectorRequest;
+
+typedef struct {
+    Entity entity;
+    bool in_use;
+    ComponentMask components;
+    CollisionMask mask;
+    i32 x;
+    i32 y;
+    char name[INSPECTOR_ROW_NAME_LEN];
+} InspectorRow;
+
+// everything the panel can show and edit about the selected entity
+typedef struct {
+    Entity entity;
+    bool in_use;
+    ComponentMask components;
+    NameStr name;
+    i32 x;
+    i32 y;
+    f32 vel_x;
+    f32 vel_y;
+    Shape shape;
+    CollisionMask mask;
+    i32 offset_x;
+    i32 offset_y;
+    u32 width;
+    u32 height;
+    u32 radius;
+} InspectorEntity;
+
+typedef struct {
+    // total rows in the list, the rows themselves are only the ones asked for
+    u32 num_matches;
+    // true until the current filter's first pass is done, num_matches is still growing
+    bool scanning;
+    u32 first_row;
+    u32 num_rows;
+    InspectorRow rows[INSPECTOR_MAX_ROWS];
+    // entity is ENTITY_NONE when nothing is selected
+    InspectorEntity selected;
+    // the request's selection as it was sent, selected.entity is what it is now
+    Entity requested;
+    // every id above is from after this many compaction passes
+    u32 compaction_passes;
+} InspectorSnapshot;
+
+typedef enum {
+    INSPECTOR_FIELD_POSITION_X = 0,
+    INSPECTOR_FIELD_POSITION_Y,
+    INSPECTOR_FIELD_VELOCITY_X,
+    INSPECTOR_FIELD_VELOCITY_Y,
+    INSPECTOR_FIELD_OFFSET_X,
+    INSPECTOR_FIELD_OFFSET_Y,
+    INSPECTOR_FIELD_WIDTH,
+    INSPECTOR_FIELD_HEIGHT,
+    INSPECTOR_FIELD_RADIUS,
+    INSPECTOR_FIELD_MASK,
+    INSPECTOR_FIELD_COUNT,
+} InspectorField;
+
+// raygui 4.0 value boxes are integer only, velocities are edited in whole pixels per second
+typedef struct {
+    Entity entity;
+    InspectorField field;
+    i32 value;
+    // same as InspectorRequest.compaction_passes
+    u32 compaction_passes;
+} InspectorEdit;
+
+typedef struct {
+    InspectorEdit items[INSPECTOR_EDITS_MAX];
+    volatile u32 head;
+    volatile u32 tail;
+} InspectorEditRing;
+
+typedef struct {
+    // render thread
+    struct InspectorUi {
+        InspectorRequest request;
+        Vector2 scroll;
+        char name_text[INSPECTOR_NAME_FILTER_LEN];
+        bool name_editing;
+        i32 values[INSPECTOR_FIELD_COUNT];
+        bool editing[INSPECTOR_FIELD_COUNT];
+        // of the snapshot being drawn, edits are stamped with it
+        u32 compaction_passes;
+    } ui;
+
+    // render thread -> simulation
+    InspectorRequest request;
+    volatile u32 request_sequence;
+    InspectorEditRing edits;
+
+    // simulation thread, `matches` is the last complete pass and `building` the one in progress
+    InspectorRequest sim_request;
+    InspectorFilter scan_filter;
+    Entity *matches;
+    Entity *building;
+    u32 scan_cursor;
+    bool scanned_once;
+} Inspector;
+
+// reserves the match lists for the world as it is, so browsing doesn't allocate once gameplay has warmed up
+void inspector_init(Inspector *inspector);
+void inspector_free(Inspector *inspector);
+// render thread, draws the panel from the snapshot's rows and sends back the new request and any edits
+void inspector_draw(Inspector *inspector, const InspectorSnapshot *snapshot, Rectangle bounds);
+// true while a text or value box has the keyboard
+bool inspector_wants_keyboard(const Inspector *inspector);
+// simulation thread
+void inspector_apply_edits(Inspector *inspector);
+void inspector_publish(Inspector *inspector, InspectorSnapshot *snapshot);
+// after a world_compact_entities() pass that moved entities, points the match lists at the new ids
+void inspector_remap(Inspector *inspector);
+
+// ----------------------------------------------------------------------------
+// Render snapshots, the simulation thread publishes one per tick
+// and the render thread draws the newest one without taking any locks
+
+typedef struct {
+    Entity entity;
+    Shape shape;
+    // collider position, circles by their center and rects by their corner
+    i32 x;
+    i32 y;
+    u32 width;
+    u32 height;
+    u32 radius;
+    // gradient fill, shapes without a sprite are only drawn by the debug collider pass
+    bool has_sprite;
+    bool emits_trail;
+    Color color_a;
+    Color color_b;
+} RenderShape;
+
+typedef struct {
+    u64 tick;
+    Camera2D camera;
+    // already culled against the camera's view by the simulation
+    RenderShape *shapes;
+    // only filled in while the inspector is open
+    InspectorSnapshot inspector;
+} RenderSnapshot;
+
+// triple buffer: the writer and reader each own one snapshot,
+// the third is handed back and forth through a single atomic word
+#define SNAPSHOT_FRESH (1u << 2)
+typedef struct {
+    RenderSnapshot snapshots[3];
+    volatile u32 ready;   // index of the latest published snapshot, plus SNAPSHOT_FRESH if the reader hasn't taken it
+    u32 write_index;      // owned by the simulation thread
+    u32 read_index;       // owned by the render thread
+} SnapshotBuffer;
+
+void snapshot_buffer_init(SnapshotBuffer *buffer);
+void snapshot_buffer_free(SnapshotBuffer *buffer);
+RenderSnapshot *snapshot_begin_write(SnapshotBuffer *buffer);
+void snapshot_publish(SnapshotBuffer *buffer);
+RenderSnapshot *snapshot_acquire(SnapshotBuffer *buffer);
+
+// one-shot effects that have to reach the render thread even if it skips snapshots,
+// single producer (simulation) / single consumer (render)
+typedef struct {
+    f32 x;
+    f32 y;
+} RenderSpark;
+
+#define RENDER_SPARKS_MAX 256
+typedef struct {
+    RenderSpark items[RENDER_SPARKS_MAX];
+    volatile u32 head;
+    volatile u32 tail;
+} RenderSparkRing;
+
+bool render_sparks_push(RenderSparkRing *ring, RenderSpark spark);
+bool render_sparks_pop(RenderSparkRing *ring, RenderSpark *spark);
+
+// ----------------------------------------------------------------------------
+// Frame capture, the render texture is read back through a ring of pixel buffers
+// so the GPU copy finishes in the background, finished frames are handed to
+// encoder threads. Nothing here ever blocks the frame, frames are dropped instead
+
+typedef enum {
+    CAPTURE_OFF = 0,
+    CAPTURE_PNG,        // numbered png sequence, encoded in parallel
+    CAPTURE_RAW_VIDEO,  // a single raw rgba stream written in order, convert it with ffmpeg
+} CaptureMode;
+
+typedef enum {
+    CAPTURE_FRAME_FREE = 0,
+    CAPTURE_FRAME_QUEUED,
+    CAPTURE_FRAME_ENCODING,
+} CaptureFrameStatus;
+
+#define CAPTURE_READBACK_SLOTS 3
+#define CAPTURE_FRAME_SLOTS 8
+#define CAPTURE_MAX_ENCODERS 4
+
+// a gpu -> pixel buffer copy in flight
+typedef struct {
+    u32 buffer;     // GL pixel pack buffer
+    void *fence;    // GLsync signalled once the copy has landed
+    u64 index;
+    bool flip_y;
+} CaptureReadback;
+
+// a frame in cpu memory waiting for, or being written by, an encoder thread
+typedef struct {
+    volatile u32 status;
+    u64 index;
+    bool flip_y;
+    u8 *pixels;
+} CaptureFrame;
+
+typedef struct {
+    CaptureMode mode;
+    u32 width;
+    u32 height;
+    char path_prefix[64];
+
+    // owned by the render thread
+    CaptureReadback readbacks[CAPTURE_READBACK_SLOTS];
+    u32 next_readback;
+    u64 frames_captured;
+    u64 frames_dropped;
+
+    CaptureFrame frames[CAPTURE_FRAME_SLOTS];
+    volatile u64 frames_written;
+
+    OsThread encoders[CAPTURE_MAX_ENCODERS];
+    u32 num_encoders;
+    volatile u32 running;
+    void *video_file;
+} FrameCapture;
+
+bool capture_start(FrameCapture *capture, CaptureMode mode, u32 width, u32 height, const char *path_prefix);
+void capture_frame(FrameCapture *capture, RenderTexture target, bool flip_y);
+void capture_stop(FrameCapture *capture);
+
+// ----------------------------------------------------------------------------
+// Performance overlay, every metric is a fixed size ring of recent samples
+// with a single writer thread, the overlay reads them without any locking
+// and may see a sample being overwritten, which is fine for telemetry
+
+#define PERF_RING_SIZE 256
+
+typedef struct {
+    f32 samples[PERF_RING_SIZE];
+    volatile u32 head;  // total samples ever pushed
+} PerfRing;
+
+typedef enum {
+    PERF_FRAME = 0,         // render thread, seconds between frames
+    PERF_SIM_TICK,          // simulation thread, seconds per tick
+    PERF_SIM_MOVE,
+    PERF_SIM_OVERLAP,
+    PERF_SIM_EVENTS,
+    PERF_COLLISION_CHECKS,  // per tick
+    PERF_ALLOCATIONS,       // stb_ds reallocs and frees per frame, across all threads
+    PERF_METRIC_COUNT,
+} PerfMetric;
+
+typedef struct {
+    f32 p50;
+    f32 p95;
+    f32 p99;
+    f32 max;
+} PerfSummary;
+
+typedef struct {
+    PerfRing rings[PERF_METRIC_COUNT];
+    volatile u32 num_entities;
+    volatile u32 num_colliders;
+} PerfStats;
+
+void perf_push(PerfStats *perf, PerfMetric metric, f32 sample);
+PerfSummary perf_summarize(PerfStats *perf, PerfMetric metric);
+void perf_draw_overlay(PerfStats *perf, Vector2 position);
+
+// ----------------------------------------------------------------------------
+// Input events, the main thread turns key changes into timestamped action events every
+// time raylib polls (once a frame, and again every millisecond while waiting for the next one)
+// and hands them to the simulation thread through a single producer, single consumer ring.
+// Right before each tick the simulation applies every event up to that tick's time,
+// an action that was down at any point since the previous tick counts for the whole tick
+// so presses shorter than a frame or a tick are never lost
+
+typedef enum {
+    INPUT_ACTION_MOVE_LEFT = 0,
+    INPUT_ACTION_MOVE_RIGHT,
+    INPUT_ACTION_STEP_FRAME,
+    INPUT_ACTION_COUNT,
+} InputAction;
+
+typedef struct {
+    f64 time;  // os_now_seconds() of the poll that saw the change
+    InputAction action;
+    bool down;
+} InputEvent;
+
+#define INPUT_RING_SIZE 256
+#define INPUT_MAX_KEYS 512
+#define INPUT_POLL_INTERVAL 0.001
+
+typedef struct {
+    InputEvent events[INPUT_RING_SIZE];
+    volatile u32 head;  // total events pushed, only written by the main thread
+    volatile u32 tail;  // total events applied, only written by the simulation thread
+    volatile u32 dropped;
+} InputRing;
+
+// main thread side, key state as of the last poll
+typedef struct {
+    bool key_down[INPUT_MAX_KEYS];
+    // keys that went down since the last input_end_frame(), however many polls happened in between
+    bool key_pressed[INPUT_MAX_KEYS];
+    bool action_down[INPUT_ACTION_COUNT];
+} InputPoller;
+
+// simulation side, what the applied events add up to for one tick
+typedef struct {
+    bool held[INPUT_ACTION_COUNT];    // down as of the tick's time
+    bool active[INPUT_ACTION_COUNT];  // down at any point since the previous tick
+    u32 presses[INPUT_ACTION_COUNT];
+} InputSample;
+
+// call right after every raylib poll (EndDrawing() or PollInputEvents())
+void input_poll(InputPoller *poller, InputRing *ring, f64 now);
+bool input_key_pressed(const InputPoller *poller, KeyboardKey key);
+void input_end_frame(InputPoller *poller);
+// apply the events stamped at or before `time`, later ones are left for the next tick
+void input_sample(InputRing *ring, InputSample *sample, f64 time);
 
 // ----------------------------------------------------------------------------
 // Game state data
 
+// the screen and debug toggles the simulation follows, the main thread packs them into one word
+// that the simulation thread loads once per tick, see PublishSimControl()
+typedef u32 SimControl;
+enum {
+    SIM_CONTROL_GAMEPLAY          = (1 << 0),
+    SIM_CONTROL_MANUAL_FRAME_STEP = (1 << 1),
+    SIM_CONTROL_LOG               = (1 << 2),
+    SIM_CONTROL_TELEMETRY         = (1 << 3),
+    SIM_CONTROL_AI_PADDLE         = (1 << 4),
+    SIM_CONTROL_INSPECTOR         = (1 << 5),
+    SIM_CONTROL_COMPACT_ENTITIES  = (1 << 6),
+};
+
 typedef struct {
     struct Window {
         i32 target_fps;
@@ -221,6 +1332,14 @@ typedef struct {
         bool log;
         bool draw_colliders;
         bool manual_frame_step;
+        bool perf_overlay;
+        // export the world to shared memory every tick, see telemetry.h
+        bool telemetry;
+        // the CPU player drives the paddle instead of the keyboard, see arena_ai_paddle()
+        bool ai_paddle;
+        bool inspector;
+        // re-sort and pack the entity columns every few seconds, see world_compact_entities()
+        bool compact_entities;
     } debug;
 
     struct InputFrame {
@@ -229,17 +1348,57 @@ typedef struct {
         bool move_right;
         bool step_frame;
     } input_frame;
+    InputPoller input;
 
-    Entity ball;
-    Entity paddle;
-    Entity bounds_l;
-    Entity bounds_r;
-    Entity bounds_t;
-    Entity bounds_b;
+    Arena arena;
 
     GameScreen current_screen;
     RenderTexture render_texture;
     Camera2D camera;
+
+    // gameplay is drawn into a `scale` sized corner of render_texture and stretched over the window,
+    // the scale follows the measured frame time between min_scale and max_scale, see UpdateResolution()
+    struct Resolution {
+        bool dynamic;
+        f32 min_scale;
+        f32 max_scale;
+        f32 scale;
+        // smoothed frame time the scale is steered by
+        f32 frame_seconds;
+        u32 frames_on_target;
+        bool stepped_up;
+        // frames on target before the scale tries the next step up, doubled each time a step up didn't hold
+        u32 grow_frames;
+    } resolution;
+
+    // entities inside the camera's view this tick, rebuilt by the simulation for its snapshot
+    Entity *visible_entities;
+
+    // fixed rate simulation on its own thread, the main thread owns the window, input and drawing
+    struct Sim {
+        OsThread thread;
+        volatile u32 running;
+        // written by the main thread whenever a toggle might have changed, the systems only
+        // ever read this tick's copy in `control`
+        volatile u32 published_control;
+        SimControl control;
+        // filled by the main thread's polls, drained right before each tick
+        InputRing input_events;
+        InputSample input;
+        u64 tick;
+        Scheduler scheduler;
+        TelemetryWriter telemetry;
+        // set when the segment couldn't be created, cleared once the toggle goes off so switching it
+        // back on tries again, a failed start isn't retried every tick
+        bool telemetry_failed;
+    } sim;
+
+    SnapshotBuffer snapshots;
+    RenderSparkRing sparks;
+
+    FrameCapture capture;
+    PerfStats perf;
+    Inspector inspector;
 } State;
 
 extern State state;
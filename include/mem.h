@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// ----------------------------------------------------------------------------
+// Tracked allocator behind every stb_ds array (see the STBDS_REALLOC hook in common.h).
+//
+// Each allocation is tagged with the calling thread's current subsystem tag,
+// calls and bytes are counted per tag, both in total and since the last mem_end_frame().
+// Once gameplay has warmed up the game flags a steady state, any allocation after
+// that point is a bug: it's reported once per tag, or aborts the program when built
+// with MEM_STRICT_STEADY_STATE (the PRONG_STRICT_ALLOCATIONS cmake option).
+//
+// Only depends on the C standard library since common.h includes it before anything else
+
+typedef enum {
+    MEM_TAG_UNTAGGED = 0,
+    MEM_TAG_WORLD,      // entity columns
+    MEM_TAG_REGISTRY,   // runtime component sparse sets
+    MEM_TAG_EVENTS,     // deferred collision events
+    MEM_TAG_COMMANDS,   // deferred structural commands
+    MEM_TAG_ASSETS,
+    MEM_TAG_PARTICLES,
+    MEM_TAG_RENDER,     // render snapshots and visibility lists
+    MEM_TAG_COUNT,
+} MemTag;
+
+typedef struct {
+    uint32_t calls[MEM_TAG_COUNT];
+    uint64_t bytes[MEM_TAG_COUNT];
+    uint32_t total_calls;
+    uint64_t total_bytes;
+} MemFrameStats;
+
+void *mem_realloc(void *ptr, size_t size);
+void mem_free(void *ptr);
+
+// set this thread's tag for the allocations that follow, returns the previous one to restore
+MemTag mem_set_tag(MemTag tag);
+const char *mem_tag_name(MemTag tag);
+
+// calls (reallocs and frees) and bytes requested since the previous call, across all threads
+MemFrameStats mem_end_frame();
+uint64_t mem_live_bytes(MemTag tag);
+
+void mem_set_steady_state(bool steady);
+uint32_t mem_steady_state_violations();
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "common.h"
+
+// ----------------------------------------------------------------------------
+// Thin platform layer: threads, timing and a small job pool.
+// Kept separate from game.h so that the platform headers (windows.h, pthread.h)
+// never end up in the same translation unit as raylib.h
+
+typedef struct {
+    u64 handle;
+} OsThread;
+
+typedef void OsThreadFunc(void *data);
+
+OsThread os_thread_create(OsThreadFunc *func, void *data);
+void os_thread_join(OsThread thread);
+void os_thread_yield();
+void os_sleep_seconds(f64 seconds);
+
+u32 os_cpu_count();
+f64 os_now_seconds();
+
+// ----------------------------------------------------------------------------
+// NUMA topology and thread placement, machines without NUMA (or without a way
+// to ask) report a single node 0. memory is placed by first touch, so whatever a
+// pinned thread writes first lands on that thread's node
+
+u32 os_numa_node_count();
+u32 os_numa_node_of_cpu(u32 cpu);
+// pin the calling thread to one logical cpu, false where that isn't supported
+bool os_thread_pin(u32 cpu);
+
+// the logical cpus a thread may run on, enough for 1024 of them like the default cpu_set_t
+typedef struct {
+    u64 bits[16];
+} OsCpuMask;
+
+// save and put back the calling thread's cpus around an os_thread_pin(), false where that isn't supported
+bool os_thread_get_affinity(OsCpuMask *mask);
+bool os_thread_set_affinity(const OsCpuMask *mask);
+
+// ----------------------------------------------------------------------------
+// Named shared memory, visible to other processes on the same machine
+// (POSIX shm_open or a Windows file mapping)
+
+typedef struct {
+    u64 handle;
+    void *base;
+    u64 size;
+    bool owner;
+    char name[64];
+} OsSharedMemory;
+
+// create a zeroed, writable segment, replacing any stale one left behind by a crashed owner
+bool os_shared_memory_create(OsSharedMemory *memory, const char *name, u64 size);
+// map someone else's segment read-only, at whatever size its owner gave it
+bool os_shared_memory_open(OsSharedMemory *memory, const char *name);
+// unmap, the owner also removes the name so the segment goes away with its last reader
+void os_shared_memory_close(OsSharedMemory *memory);
+
+// ----------------------------------------------------------------------------
+// Job pool
+
+// processes items [begin, end) of a parallel_for, `worker` is in [0, jobs_worker_count())
+// and is stable for the duration of the call, 0 is always the calling thread
+typedef void JobRangeFunc(void *data, u32 begin, u32 end, u32 worker);
+
+// spin up `num_threads - 1` worker threads, the calling thread is the last one;
+// passing 0 uses one thread per core
+void jobs_init(u32 num_threads);
+// same, but every worker (the calling thread too) is pinned to a core of its own,
+// handed out round robin over the NUMA nodes so the workers are split evenly between them.
+// the calling thread gets its own cpus back from jobs_shutdown(), which it has to be the one to call
+void jobs_init_pinned(u32 num_threads);
+void jobs_shutdown();
+u32 jobs_worker_count();
+// true while the pool is one started by jobs_init_pinned()
+bool jobs_pinned();
+// NUMA node a pinned worker runs on, 0 when the pool isn't pinned
+u32 jobs_worker_node(u32 worker);
+
+// split [0, count) into batches of `batch_size` items and run them across the pool,
+// blocks until every batch has completed
+void jobs_parallel_for(u32 count, u32 batch_size, JobRangeFunc *func, void *data);
+
+// split [0, count) into one contiguous range per worker, worker w always gets the same range
+// for the same count. with a pinned pool, data that's only ever created and handled through these
+// calls stays on one thread and so on one node, at the price of no load balancing between workers.
+// worker 0 is the calling thread, which is only pinned if it's the one that started the pool:
+// called from any other thread, worker 0's range runs wherever that thread happens to be
+void jobs_parallel_for_static(u32 count, JobRangeFunc *func, void *data);
+
+// runs task `t` for every t in `order` once all the tasks it depends on have finished,
+// the tasks depending on t are dependents[dependent_offsets[t] .. dependent_offsets[t + 1]).
+// pending[t] starts out as t's number of dependencies and is used up by the run.
+// idle workers take the first ready task in `order` and sleep while nothing is ready
+typedef void JobTaskFunc(void *data, u32 task, u32 worker);
+
+void jobs_run_graph(u32 num_tasks, const u32 *order, const u32 *dependent_offsets, const u32 *dependents,
+                    u32 *pending, JobTaskFunc *func, void *data);
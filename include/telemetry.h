@@ -0,0 +1,92 @@
+#pragma once
+
+#include "os.h"
+
+// ----------------------------------------------------------------------------
+// Live telemetry, the simulation exports its entity columns into named shared
+// memory after every tick so external tools can watch a running game without
+// stopping it or talking to it.
+//
+// The segment is a header followed by two frames, each a small frame header
+// and then one fixed size column per TelemetryColumn. The writer never touches
+// the frame a reader is most likely to be copying:
+//   writer: fill the frame that isn't `latest`: bump its sequence to odd, fence,
+//           write the columns, fence, bump the sequence to even, then point `latest` at it
+//   reader: load `latest` and that frame's sequence (retry while it's odd), fence,
+//           copy what's needed, fence, and reload the sequence, a changed value means
+//           the writer came around to this frame mid copy and the copy is thrown away
+// Neither side ever blocks the other, a slow reader only retries.
+//
+// Only depends on os.h so standalone readers don't need raylib, see src/telemetry_reader.c
+
+#define TELEMETRY_SEGMENT_NAME "prong_telemetry"
+#define TELEMETRY_MAGIC 0x544C4D50 // 'PMLT'
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_FRAMES 2
+
+// every column is max_entities 4 byte values
+typedef enum {
+    TELEMETRY_COMPONENTS = 0, // u32, ComponentMask
+    TELEMETRY_POSITION_X,     // i32
+    TELEMETRY_POSITION_Y,     // i32
+    TELEMETRY_VELOCITY_X,     // f32
+    TELEMETRY_VELOCITY_Y,     // f32
+    TELEMETRY_BOUNDS_X,       // f32, entity_get_bounds(), zero sized for entities without a collider
+    TELEMETRY_BOUNDS_Y,       // f32
+    TELEMETRY_BOUNDS_WIDTH,   // f32
+    TELEMETRY_BOUNDS_HEIGHT,  // f32
+    TELEMETRY_COLUMN_COUNT,
+} TelemetryColumn;
+
+typedef struct {
+    volatile u32 sequence;  // odd while the writer is inside this frame
+    u32 num_entities;       // rows valid in every column, at most max_entities
+    u32 total_entities;     // the world's count, larger than num_entities when the export was clamped
+    u32 padding;
+    u64 tick;
+    f64 time;               // writer's os_now_seconds() at publish
+} TelemetryFrame;
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 max_entities;
+    u32 frame_bytes;
+    volatile u32 latest;    // index of the newest complete frame
+    volatile u32 alive;     // cleared by the writer when it stops
+} TelemetryHeader;
+
+// headers are padded to a cache line so the columns are aligned for the reader's copies
+#define TELEMETRY_HEADER_BYTES 64
+#define TELEMETRY_FRAME_HEADER_BYTES 64
+
+global inline u64 telemetry_frame_size(u32 max_entities) {
+    u64 size = TELEMETRY_FRAME_HEADER_BYTES + (u64) TELEMETRY_COLUMN_COUNT * max_entities * sizeof(u32);
+    return (size + 63) & ~63ull;
+}
+
+global inline u64 telemetry_segment_size(u32 max_entities) {
+    return TELEMETRY_HEADER_BYTES + TELEMETRY_FRAMES * telemetry_frame_size(max_entities);
+}
+
+global inline TelemetryFrame *telemetry_frame(const TelemetryHeader *header, u32 index) {
+    return (TelemetryFrame *) ((u8 *) header + TELEMETRY_HEADER_BYTES + (u64) index * header->frame_bytes);
+}
+
+global inline void *telemetry_column(const TelemetryHeader *header, TelemetryFrame *frame, TelemetryColumn column) {
+    return (u8 *) frame + TELEMETRY_FRAME_HEADER_BYTES + (u64) column * header->max_entities * sizeof(u32);
+}
+
+// ----------------------------------------------------------------------------
+// Writer side, owned by the simulation thread
+
+typedef struct {
+    OsSharedMemory memory;
+    TelemetryHeader *header;
+} TelemetryWriter;
+
+// create the segment, worlds with more than `max_entities` entities are exported clamped
+bool telemetry_start(TelemetryWriter *writer, u32 max_entities);
+// copy the current world into the next frame, no-op while stopped
+void telemetry_publish(TelemetryWriter *writer, u64 tick);
+void telemetry_stop(TelemetryWriter *writer);
@@ -0,0 +1,243 @@
+#include "game.h"
+
+// ----------------------------------------------------------------------------
+// Arena setup and paddle rules, these only touch the bound world so they work
+// the same with or without a window (see main.c and env.c)
+
+internal const Vector2 GRAVITY = {0, -50.0f};
+
+internal const f32 BALL_RADIUS = 25;
+internal const Vector2 BALL_START_POS = {0, 100};
+internal const Vector2 BALL_START_VEL = {-100, -200};
+internal const Vector2 PADDLE_SIZE = {200, 50};
+internal const i32 BOUNDS_SIZE = 10;
+
+internal const f32 PADDLE_SPEED_MAX = 2000;
+internal const f32 PADDLE_SPEED_IMPULSE = 500;
+// how fast the paddle slows down once nothing is held
+internal const f32 PADDLE_BRAKE = 2000;
+
+// a prediction gives up after this many bounces off the top and bottom, the ball is
+// just bouncing in place by then (no gravity and no vertical speed, or similar)
+internal const u32 PREDICT_MAX_BOUNCES = 16;
+
+// ----------------------------------------------------------------------------
+// Internal implementation
+
+// earliest time the height y(t) = y + vy t + g t^2 / 2 crosses `level` while moving in `direction`
+// (+1 up, -1 down), INFINITY if it never does
+internal f32 arena_crossing_time(f32 y, f32 vy, f32 g, f32 level, i32 direction) {
+    const f32 eps = 1e-5f;
+    f32 roots[2] = {INFINITY, INFINITY};
+    f32 c = y - level;
+    if (calc_abs(g) < eps) {
+        if (calc_abs(vy) > eps) roots[0] = -c / vy;
+    } else {
+        f32 disc = vy * vy - 2 * g * c;
+        if (disc < 0) return INFINITY;
+
+        // the stable form of the quadratic formula, the usual one cancels badly for small c
+        f32 q = -0.5f * (vy + ((vy < 0) ? -sqrtf(disc) : sqrtf(disc)));
+        roots[0] = q / (0.5f * g);
+        if (calc_abs(q) > eps) roots[1] = c / q;
+    }
+
+    f32 best = INFINITY;
+    for (u32 i = 0; i < 2; i++) {
+        f32 t = roots[i];
+        if (t > eps && t < best && (vy + g * t) * direction > 0) best = t;
+    }
+    return best;
+}
+
+// fold a straight path back and forth between two walls, reflections are just the unfolded
+// distance taken modulo twice the gap
+internal f32 arena_fold_x(f32 x, f32 vx, f32 t, f32 min_x, f32 max_x, u32 *bounces) {
+    f32 span = max_x - min_x;
+    if (span <= 0) return min_x + span / 2;
+
+    f32 unfolded = (x - min_x) + vx * t;
+    *bounces += (u32) calc_abs(floorf(unfolded / span));
+
+    f32 u = fmodf(unfolded, 2 * span);
+    if (u < 0) u += 2 * span;
+    return (u <= span) ? min_x + u : max_x - (u - span);
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void arena_create(Arena *arena, i32 width, i32 height) {
+    *arena = (Arena) {0};
+    arena->width = width;
+    arena->height = height;
+
+    Vector2 arena_center = {width / 2, height / 2};
+    Vector2 paddle_center = {0, (-height + PADDLE_SIZE.y) / 2};
+
+    arena->ball = world_create_entity();
+    entity_add_name(arena->ball, (NameStr) {"ball"});
+    entity_add_position(arena->ball, BALL_START_POS.x, BALL_START_POS.y);
+    entity_add_velocity(arena->ball, BALL_START_VEL.x, BALL_START_VEL.y, 0, GRAVITY.y);
+    entity_add_collider_circ(arena->ball, MASK_BALL, 0, 0, BALL_RADIUS);
+
+    arena->paddle = world_create_entity();
+    entity_add_name(arena->paddle, (NameStr) {"paddle"});
+    entity_add_position(arena->paddle, paddle_center.x, paddle_center.y);
+    entity_add_velocity(arena->paddle, 0, 0, 0.75f, 0);
+    // the paddle is driven by input alone, the ball bounces off it without pushing it around
+    entity_set_body(arena->paddle, 0, 1, 0);
+    entity_add_collider_rect(arena->paddle, MASK_PADDLE, PADDLE_SIZE.x / 2, PADDLE_SIZE.y / 2, PADDLE_SIZE.x, PADDLE_SIZE.y);
+
+    // setup arena bounds
+    arena->bounds_l = world_create_entity(); entity_add_name(arena->bounds_l, (NameStr) {"bounds_l"});
+    arena->bounds_r = world_create_entity(); entity_add_name(arena->bounds_r, (NameStr) {"bounds_r"});
+    arena->bounds_t = world_create_entity(); entity_add_name(arena->bounds_t, (NameStr) {"bounds_t"});
+    arena->bounds_b = world_create_entity(); entity_add_name(arena->bounds_b, (NameStr) {"bounds_b"});
+
+    i32 size = BOUNDS_SIZE;
+    Rectangle interior = (Rectangle) {-arena_center.x, -arena_center.y, width, height};
+    entity_add_position(arena->bounds_l, interior.x                  - size / 2, interior.y + interior.height / 2);
+    entity_add_position(arena->bounds_r, interior.x + interior.width + size / 2, interior.y + interior.height / 2);
+    entity_add_position(arena->bounds_t, interior.x + interior.width / 2,        interior.y + interior.height + size / 2);
+    entity_add_position(arena->bounds_b, interior.x + interior.width / 2,        interior.y                   - size / 2);
+
+    entity_add_collider_rect(arena->bounds_l, MASK_BOUNDS, -size / 2, -interior.height / 2, size, interior.height);
+    entity_add_collider_rect(arena->bounds_r, MASK_BOUNDS, -size / 2, -interior.height / 2, size, interior.height);
+    entity_add_collider_rect(arena->bounds_t, MASK_BOUNDS, -interior.width / 2, -size / 2, interior.width, size);
+    entity_add_collider_rect(arena->bounds_b, MASK_BOUNDS, -interior.width / 2, -size / 2, interior.width, size);
+}
+
+void arena_reset(Arena *arena, f32 ball_vel_x, f32 ball_vel_y) {
+    // re-adding components only overwrites the existing slots, nothing is allocated
+    Vector2 paddle_center = {0, (-arena->height + PADDLE_SIZE.y) / 2};
+
+    entity_add_position(arena->ball, BALL_START_POS.x, BALL_START_POS.y);
+    entity_add_velocity(arena->ball, ball_vel_x, ball_vel_y, 0, GRAVITY.y);
+
+    entity_add_position(arena->paddle, paddle_center.x, paddle_center.y);
+    entity_add_velocity(arena->paddle, 0, 0, 0.75f, 0);
+    entity_set_body(arena->paddle, 0, 1, 0);
+}
+
+void arena_update_paddle(Arena *arena, bool move_left, bool move_right, f32 dt) {
+    Entity paddle = arena->paddle;
+
+    if (move_left || move_right) {
+        const f32 speed_max = PADDLE_SPEED_MAX;
+        const f32 speed_impulse = PADDLE_SPEED_IMPULSE;
+        const i32 sign = move_left ? -1 : move_right ? 1 : 0;
+
+        // if the paddle is moving in the opposite direction, stop it
+        bool switch_direction = sign != calc_sign(world->movements.vel_x[paddle]);
+        if (switch_direction) {
+            world->movements.vel_x[paddle] = 0;
+        }
+
+        // move the paddle based on user input, with an extra boost if we just switched direction
+        const f32 speed_boost = switch_direction ? 50 : 1;
+        world->movements.vel_x[paddle] += sign * speed_boost * speed_impulse * dt;
+
+        // constrain the paddle's max speed
+        if (calc_abs(world->movements.vel_x[paddle]) > speed_max) {
+            world->movements.vel_x[paddle] = calc_approach(world->movements.vel_x[paddle], sign * speed_max, 2000 * dt);
+        }
+    } else {
+        // always be slowing when no input
+        world->movements.vel_x[paddle] = calc_approach(world->movements.vel_x[paddle], 0, PADDLE_BRAKE * dt);
+        world->movements.vel_y[paddle] = calc_approach(world->movements.vel_y[paddle], 0, PADDLE_BRAKE * dt);
+    }
+}
+
+void arena_remap(Arena *arena) {
+    arena->ball = world_remap_entity(arena->ball);
+    arena->paddle = world_remap_entity(arena->paddle);
+    arena->bounds_l = world_remap_entity(arena->bounds_l);
+    arena->bounds_r = world_remap_entity(arena->bounds_r);
+    arena->bounds_t = world_remap_entity(arena->bounds_t);
+    arena->bounds_b = world_remap_entity(arena->bounds_b);
+}
+
+bool arena_predict_ball(const Arena *arena, f32 dt, BallPrediction *prediction) {
+    *prediction = (BallPrediction) {0};
+
+    Rectangle ball, paddle, left, right, top, bottom;
+    bool found = entity_get_bounds(arena->ball, &ball) && entity_get_bounds(arena->paddle, &paddle)
+              && entity_get_bounds(arena->bounds_l, &left) && entity_get_bounds(arena->bounds_r, &right)
+              && entity_get_bounds(arena->bounds_t, &top) && entity_get_bounds(arena->bounds_b, &bottom);
+    if (!found) return false;
+
+    // the ball's center is kept a radius away from every surface, y points up
+    const f32 radius = ball.width / 2;
+    const f32 min_x = left.x + left.width + radius;
+    const f32 max_x = right.x - radius;
+    const f32 min_y = bottom.y + bottom.height + radius;
+    const f32 max_y = top.y - radius;
+    const f32 level = paddle.y + paddle.height + radius;
+
+    const f32 g = world->movements.gravity[arena->ball];
+    const f32 vx = world->movements.vel_x[arena->ball];
+    const f32 x = ball.x + radius;
+    f32 y = ball.y + radius;
+    // gravity is applied before the move every tick, so the positions at the end of each tick
+    // lie on the parabola that starts with half a tick of gravity already added
+    f32 vy = world->movements.vel_y[arena->ball] + g * dt * 0.5f;
+
+    // vertical motion between the top and bottom walls, one segment per bounce, on_hit just flips the velocity
+    f32 time = 0;
+    for (u32 bounce = 0; bounce <= PREDICT_MAX_BOUNCES; bounce++) {
+        f32 t_paddle = arena_crossing_time(y, vy, g, level, -1);
+        f32 t_top = arena_crossing_time(y, vy, g, max_y, 1);
+        f32 t_bottom = arena_crossing_time(y, vy, g, min_y, -1);
+
+        if (t_paddle < INFINITY && t_paddle <= t_top && t_paddle <= t_bottom) {
+            time += t_paddle;
+            u32 side_bounces = 0;
+            f32 intercept_x = arena_fold_x(x, vx, time, min_x, max_x, &side_bounces);
+            *prediction = (BallPrediction) {
+                .time = time,
+                .point = {intercept_x, level},
+                .velocity = {(side_bounces & 1) ? -vx : vx, vy + g * t_paddle},
+                .bounces = side_bounces + bounce,
+            };
+            return true;
+        }
+
+        f32 t_bounce = Min(t_top, t_bottom);
+        if (t_bounce == INFINITY) return false;
+
+        time += t_bounce;
+        y = (t_top <= t_bottom) ? max_y : min_y;
+        vy = -(vy + g * t_bounce);
+    }
+    return false;
+}
+
+void arena_ai_paddle(const Arena *arena, f32 dt, bool *move_left, bool *move_right) {
+    *move_left = false;
+    *move_right = false;
+
+    Rectangle paddle, left, right;
+    bool found = entity_get_bounds(arena->paddle, &paddle)
+              && entity_get_bounds(arena->bounds_l, &left) && entity_get_bounds(arena->bounds_r, &right);
+    if (!found) return;
+
+    // head for where the ball comes down, or wait in the middle while it can't
+    f32 target = (left.x + left.width + right.x) / 2;
+    BallPrediction prediction;
+    if (arena_predict_ball(arena, dt, &prediction)) {
+        target = prediction.point.x;
+    }
+
+    // aim where the paddle would come to rest if it let go now, braking is the only thing
+    // slowing it down, so a bang-bang controller on that stops on target instead of overshooting
+    const f32 vel = world->movements.vel_x[arena->paddle];
+    const f32 center = paddle.x + paddle.width / 2;
+    const f32 rest = center + vel * calc_abs(vel) / (2 * PADDLE_BRAKE);
+    const f32 error = target - rest;
+
+    // anywhere on the middle half of the paddle is good enough
+    if (calc_abs(error) <= paddle.width / 4) return;
+    *move_left = error < 0;
+    *move_right = error > 0;
+}
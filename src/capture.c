@@ -0,0 +1,249 @@
+#include "game.h"
+
+// raylib doesn't expose pixel buffer objects through rlgl, so talk to GL directly
+// through the loader raylib already built, its function pointers are set up by InitWindow()
+#include "external/glad.h"
+
+// raylib compiles its own copy of stb_image_write, keep ours private to this file
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Encoder threads
+
+internal CaptureFrame *capture_claim_frame(FrameCapture *capture) {
+    // raw video has to go out in order, so take the oldest queued frame,
+    // png frames are independent files and any queued one will do
+    bool in_order = capture->mode == CAPTURE_RAW_VIDEO;
+
+    CaptureFrame *claimed = NULL;
+    for (u32 i = 0; i < CAPTURE_FRAME_SLOTS; i++) {
+        CaptureFrame *frame = &capture->frames[i];
+        if (ins_atomic_u32_eval(&frame->status) != CAPTURE_FRAME_QUEUED) continue;
+
+        if (!in_order) {
+            u32 prev = ins_atomic_u32_eval_cond_assign(&frame->status, CAPTURE_FRAME_ENCODING, CAPTURE_FRAME_QUEUED);
+            if (prev == CAPTURE_FRAME_QUEUED) return frame;
+        } else if (!claimed || frame->index < claimed->index) {
+            claimed = frame;
+        }
+    }
+
+    // raw video only ever has the one encoder, nobody else can take it in between
+    if (claimed) {
+        ins_atomic_u32_eval_assign(&claimed->status, CAPTURE_FRAME_ENCODING);
+    }
+    return claimed;
+}
+
+internal void capture_encode_frame(FrameCapture *capture, CaptureFrame *frame) {
+    // gl reads rows bottom up, walk them backwards when the frame needs flipping
+    const i32 stride = capture->width * 4;
+    const u8 *first_row = frame->flip_y ? frame->pixels + (capture->height - 1) * stride : frame->pixels;
+    const i32 row_step = frame->flip_y ? -stride : stride;
+
+    switch (capture->mode) {
+        case CAPTURE_PNG: {
+            char path[128];
+            snprintf(path, sizeof(path), "%s_%06llu.png", capture->path_prefix, (unsigned long long) frame->index);
+            if (!stbi_write_png(path, capture->width, capture->height, 4, first_row, row_step)) {
+                TraceLog(LOG_WARNING, "capture: failed to write '%s'", path);
+            }
+        } break;
+        case CAPTURE_RAW_VIDEO: {
+            FILE *file = capture->video_file;
+            for (u32 y = 0; y < capture->height; y++) {
+                fwrite(first_row + (i64) y * row_step, 1, stride, file);
+            }
+        } break;
+
+        case CAPTURE_OFF:
+        default: break;
+    }
+}
+
+internal void capture_encoder_main(void *data) {
+    FrameCapture *capture = data;
+    for (;;) {
+        // check before claiming, anything queued before we were stopped still gets written
+        bool running = ins_atomic_u32_eval(&capture->running);
+
+        CaptureFrame *frame = capture_claim_frame(capture);
+        if (!frame) {
+            if (!running) break;
+            os_sleep_seconds(0.002);
+            continue;
+        }
+
+        capture_encode_frame(capture, frame);
+        ins_atomic_u64_add_eval(&capture->frames_written, 1);
+        ins_atomic_u32_eval_assign(&frame->status, CAPTURE_FRAME_FREE);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Readback
+
+internal bool capture_readback_done(CaptureReadback *readback, bool wait) {
+    GLuint64 timeout = wait ? 1000000000ull : 0;
+    GLenum result = glClientWaitSync((GLsync) readback->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+internal CaptureFrame *capture_free_frame(FrameCapture *capture) {
+    for (u32 i = 0; i < CAPTURE_FRAME_SLOTS; i++) {
+        if (ins_atomic_u32_eval(&capture->frames[i].status) == CAPTURE_FRAME_FREE) {
+            return &capture->frames[i];
+        }
+    }
+    return NULL;
+}
+
+// copy every finished readback out of its pixel buffer, oldest first
+internal void capture_collect_readbacks(FrameCapture *capture, bool wait) {
+    for (u32 i = 0; i < CAPTURE_READBACK_SLOTS; i++) {
+        CaptureReadback *readback = &capture->readbacks[(capture->next_readback + i) % CAPTURE_READBACK_SLOTS];
+        if (!readback->fence) continue;
+        if (!capture_readback_done(readback, wait)) break;
+
+        glDeleteSync((GLsync) readback->fence);
+        readback->fence = NULL;
+
+        // every encoder is still busy, this frame is lost
+        CaptureFrame *frame = capture_free_frame(capture);
+        if (!frame) {
+            capture->frames_dropped++;
+            continue;
+        }
+
+        const u32 size = capture->width * capture->height * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer);
+        void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        if (pixels) {
+            memcpy(frame->pixels, pixels, size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+            frame->index = readback->index;
+            frame->flip_y = readback->flip_y;
+            ins_atomic_u32_eval_assign(&frame->status, CAPTURE_FRAME_QUEUED);
+        } else {
+            capture->frames_dropped++;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+bool capture_start(FrameCapture *capture, CaptureMode mode, u32 width, u32 height, const char *path_prefix) {
+    if (capture->mode != CAPTURE_OFF) {
+        capture_stop(capture);
+    }
+    if (mode == CAPTURE_OFF) return false;
+
+    *capture = (FrameCapture) {0};
+    capture->width = width;
+    capture->height = height;
+    strncpy(capture->path_prefix, path_prefix, sizeof(capture->path_prefix) - 1);
+
+    if (mode == CAPTURE_RAW_VIDEO) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s.rgba", path_prefix);
+        capture->video_file = fopen(path, "wb");
+        if (!capture->video_file) {
+            TraceLog(LOG_WARNING, "capture: failed to open '%s'", path);
+            return false;
+        }
+        TraceLog(LOG_INFO, "capture: recording to '%s', convert with: ffmpeg -f rawvideo -pixel_format rgba -video_size %ux%u -framerate %d -i %s %s.mp4",
+                 path, width, height, state.window.target_fps, path, path_prefix);
+    } else {
+        TraceLog(LOG_INFO, "capture: recording to '%s_*.png'", path_prefix);
+    }
+    capture->mode = mode;
+
+    const u32 size = width * height * 4;
+    for (u32 i = 0; i < CAPTURE_READBACK_SLOTS; i++) {
+        glGenBuffers(1, &capture->readbacks[i].buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->readbacks[i].buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    for (u32 i = 0; i < CAPTURE_FRAME_SLOTS; i++) {
+        capture->frames[i].pixels = malloc(size);
+    }
+
+    // a raw stream has to be written in order, so it only gets a single writer,
+    // png compression is the slow part and spreads over whatever cores are spare
+    u32 num_encoders = 1;
+    if (mode == CAPTURE_PNG) {
+        u32 spare_cores = os_cpu_count() > 2 ? os_cpu_count() - 2 : 1;
+        num_encoders = Clamp(1, spare_cores, CAPTURE_MAX_ENCODERS);
+    }
+
+    capture->running = 1;
+    for (u32 i = 0; i < num_encoders; i++) {
+        capture->encoders[capture->num_encoders++] = os_thread_create(capture_encoder_main, capture);
+    }
+    return true;
+}
+
+void capture_frame(FrameCapture *capture, RenderTexture target, bool flip_y) {
+    if (capture->mode == CAPTURE_OFF) return;
+
+    capture_collect_readbacks(capture, false);
+    capture->frames_captured++;
+
+    // the gpu still hasn't finished the copy from a few frames back, skip this one rather than wait
+    CaptureReadback *readback = &capture->readbacks[capture->next_readback];
+    if (readback->fence) {
+        capture->frames_dropped++;
+        return;
+    }
+
+    // kick off the copy into the pixel buffer, glReadPixels returns immediately with a pack buffer bound
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target.id);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback->index = capture->frames_captured;
+    readback->flip_y = flip_y;
+    capture->next_readback = (capture->next_readback + 1) % CAPTURE_READBACK_SLOTS;
+}
+
+void capture_stop(FrameCapture *capture) {
+    if (capture->mode == CAPTURE_OFF) return;
+
+    // the last few copies are still on the gpu, this is the one place that's allowed to wait for them
+    capture_collect_readbacks(capture, true);
+
+    ins_atomic_u32_eval_assign(&capture->running, 0);
+    for (u32 i = 0; i < capture->num_encoders; i++) {
+        os_thread_join(capture->encoders[i]);
+    }
+
+    for (u32 i = 0; i < CAPTURE_READBACK_SLOTS; i++) {
+        if (capture->readbacks[i].fence) {
+            glDeleteSync((GLsync) capture->readbacks[i].fence);
+        }
+        glDeleteBuffers(1, &capture->readbacks[i].buffer);
+    }
+    for (u32 i = 0; i < CAPTURE_FRAME_SLOTS; i++) {
+        free(capture->frames[i].pixels);
+    }
+    if (capture->video_file) {
+        fclose(capture->video_file);
+    }
+
+    TraceLog(LOG_INFO, "capture: stopped, %llu frames written, %llu dropped",
+             (unsigned long long) capture->frames_written, (unsigned long long) capture->frames_dropped);
+    *capture = (FrameCapture) {0};
+}
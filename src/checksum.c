@@ -0,0 +1,163 @@
+#include "game.h"
+
+// ----------------------------------------------------------------------------
+// World checksums, see game.h
+// the hash is an xxh3 style accumulate: input is consumed in 64 byte stripes of 8 u64 lanes,
+// each lane adds its neighbour's raw data and the 32x32 bit product of its own data mixed
+// with a key. The keys move on every stripe so swapping two stripes changes the hash.
+// SSE2 does a stripe in four 2-lane steps, the scalar loop does exactly the same math
+// so builds with and without SIMD can be checked against each other
+
+#define CHECKSUM_STRIPE_BYTES 64
+#define CHECKSUM_LANES 8
+
+global const u64 checksum_keys[CHECKSUM_LANES] = {
+    0xBE4BA423396CFEB8ull, 0x1CAD21F72C81017Cull, 0xDB979083E96DD4DEull, 0x1F67B3B7A4A44072ull,
+    0x78E5C0CC4EE679CBull, 0x2172FFCC7DD05A82ull, 0x8E2443F7744608B8ull, 0x4C263A81E69035E0ull,
+};
+internal const u64 CHECKSUM_KEY_STEP = 0x9E3779B97F4A7C15ull;
+
+global const char *checksum_column_names[CHECKSUM_COLUMN_COUNT] = {
+    [CHECKSUM_COMPONENTS]        = "components",
+    [CHECKSUM_POSITION_X]        = "positions.x",
+    [CHECKSUM_POSITION_Y]        = "positions.y",
+    [CHECKSUM_VELOCITY_X]        = "movements.vel_x",
+    [CHECKSUM_VELOCITY_Y]        = "movements.vel_y",
+    [CHECKSUM_REMAINDER_X]       = "movements.remainder_x",
+    [CHECKSUM_REMAINDER_Y]       = "movements.remainder_y",
+    [CHECKSUM_SLEEP_SECONDS]     = "movements.sleep_seconds",
+    [CHECKSUM_ASLEEP]            = "movements.asleep",
+    [CHECKSUM_COLLIDER_OFFSET_X] = "colliders.offset_x",
+    [CHECKSUM_COLLIDER_OFFSET_Y] = "colliders.offset_y",
+    [CHECKSUM_COLLIDER_WIDTH]    = "colliders.width",
+    [CHECKSUM_COLLIDER_HEIGHT]   = "colliders.height",
+    [CHECKSUM_COLLIDER_RADIUS]   = "colliders.radius",
+    [CHECKSUM_COLLIDER_SHAPE]    = "colliders.shape",
+    [CHECKSUM_COLLIDER_MASK]     = "colliders.mask",
+};
+
+// murmur3's finalizer
+internal u64 checksum_mix(u64 x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    return x ^ (x >> 33);
+}
+
+internal void checksum_accumulate(u64 *acc, const u8 *data, u64 num_stripes, u64 first_stripe) {
+#if SIMD_SSE2
+    __m128i v_acc[CHECKSUM_LANES / 2];
+    __m128i v_key[CHECKSUM_LANES / 2];
+    const __m128i v_step = _mm_set1_epi64x((i64) CHECKSUM_KEY_STEP);
+    for (u32 i = 0; i < CHECKSUM_LANES / 2; i++) {
+        v_acc[i] = _mm_loadu_si128((const __m128i *) &acc[2 * i]);
+        v_key[i] = _mm_set_epi64x((i64) (checksum_keys[2 * i + 1] + first_stripe * CHECKSUM_KEY_STEP),
+                                  (i64) (checksum_keys[2 * i] + first_stripe * CHECKSUM_KEY_STEP));
+    }
+
+    for (u64 stripe = 0; stripe < num_stripes; stripe++) {
+        const u8 *in = data + stripe * CHECKSUM_STRIPE_BYTES;
+        for (u32 i = 0; i < CHECKSUM_LANES / 2; i++) {
+            __m128i value = _mm_loadu_si128((const __m128i *) (in + 16 * i));
+            __m128i keyed = _mm_xor_si128(value, v_key[i]);
+            // low half of each lane times its high half
+            __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            v_acc[i] = _mm_add_epi64(v_acc[i], _mm_add_epi64(product, swapped));
+            v_key[i] = _mm_add_epi64(v_key[i], v_step);
+        }
+    }
+
+    for (u32 i = 0; i < CHECKSUM_LANES / 2; i++) {
+        _mm_storeu_si128((__m128i *) &acc[2 * i], v_acc[i]);
+    }
+#else
+    for (u64 stripe = 0; stripe < num_stripes; stripe++) {
+        const u8 *in = data + stripe * CHECKSUM_STRIPE_BYTES;
+        const u64 key_offset = (first_stripe + stripe) * CHECKSUM_KEY_STEP;
+        for (u32 lane = 0; lane < CHECKSUM_LANES; lane++) {
+            u64 value;
+            memcpy(&value, in + 8 * lane, sizeof(value));
+            u64 keyed = value ^ (checksum_keys[lane] + key_offset);
+            acc[lane ^ 1] += value;
+            acc[lane] += (keyed & 0xFFFFFFFFull) * (keyed >> 32);
+        }
+    }
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+u64 checksum_bytes(const void *data, u64 size, u64 seed) {
+    u64 acc[CHECKSUM_LANES];
+    for (u32 lane = 0; lane < CHECKSUM_LANES; lane++) {
+        acc[lane] = checksum_keys[lane] ^ seed;
+    }
+
+    // whole stripes straight from the input, then the tail zero padded to a stripe
+    const u8 *bytes = data;
+    u64 num_stripes = size / CHECKSUM_STRIPE_BYTES;
+    checksum_accumulate(acc, bytes, num_stripes, 0);
+
+    u64 tail_size = size % CHECKSUM_STRIPE_BYTES;
+    if (tail_size != 0) {
+        u8 tail[CHECKSUM_STRIPE_BYTES] = {0};
+        memcpy(tail, bytes + num_stripes * CHECKSUM_STRIPE_BYTES, tail_size);
+        checksum_accumulate(acc, tail, 1, num_stripes);
+    }
+
+    // the size goes in last so trailing zero bytes aren't lost in the padding
+    u64 hash = checksum_mix(size ^ seed);
+    for (u32 lane = 0; lane < CHECKSUM_LANES; lane++) {
+        hash = checksum_mix(hash ^ acc[lane]) + lane;
+    }
+    return hash;
+}
+
+const char *checksum_column_name(ChecksumColumn column) {
+    return (column < CHECKSUM_COLUMN_COUNT) ? checksum_column_names[column] : "none";
+}
+
+WorldChecksum world_checksum() {
+    typedef struct {
+        const void *data;
+        u64 element_size;
+    } ChecksumSource;
+
+    const ChecksumSource sources[CHECKSUM_COLUMN_COUNT] = {
+        [CHECKSUM_COMPONENTS]        = {world->infos.components, sizeof(ComponentMask)},
+        [CHECKSUM_POSITION_X]        = {world->positions.x, sizeof(i32)},
+        [CHECKSUM_POSITION_Y]        = {world->positions.y, sizeof(i32)},
+        [CHECKSUM_VELOCITY_X]        = {world->movements.vel_x, sizeof(f32)},
+        [CHECKSUM_VELOCITY_Y]        = {world->movements.vel_y, sizeof(f32)},
+        [CHECKSUM_REMAINDER_X]       = {world->movements.remainder_x, sizeof(f32)},
+        [CHECKSUM_REMAINDER_Y]       = {world->movements.remainder_y, sizeof(f32)},
+        [CHECKSUM_SLEEP_SECONDS]     = {world->movements.sleep_seconds, sizeof(f32)},
+        [CHECKSUM_ASLEEP]            = {world->movements.asleep, sizeof(bool)},
+        [CHECKSUM_COLLIDER_OFFSET_X] = {world->colliders.offset_x, sizeof(i32)},
+        [CHECKSUM_COLLIDER_OFFSET_Y] = {world->colliders.offset_y, sizeof(i32)},
+        [CHECKSUM_COLLIDER_WIDTH]    = {world->colliders.width, sizeof(u32)},
+        [CHECKSUM_COLLIDER_HEIGHT]   = {world->colliders.height, sizeof(u32)},
+        [CHECKSUM_COLLIDER_RADIUS]   = {world->colliders.radius, sizeof(u32)},
+        [CHECKSUM_COLLIDER_SHAPE]    = {world->colliders.shape, sizeof(Shape)},
+        [CHECKSUM_COLLIDER_MASK]     = {world->colliders.mask, sizeof(CollisionMask)},
+    };
+
+    // each column is seeded with its index, the same values in two columns still hash differently
+    WorldChecksum checksum = {0};
+    for (u32 column = 0; column < CHECKSUM_COLUMN_COUNT; column++) {
+        const ChecksumSource *source = &sources[column];
+        checksum.columns[column] = checksum_bytes(source->data, (u64) world->num_entities * source->element_size, column);
+    }
+    checksum.combined = checksum_bytes(checksum.columns, sizeof(checksum.columns), CHECKSUM_COLUMN_COUNT);
+    return checksum;
+}
+
+ChecksumColumn world_checksum_compare(const WorldChecksum *a, const WorldChecksum *b) {
+    for (u32 column = 0; column < CHECKSUM_COLUMN_COUNT; column++) {
+        if (a->columns[column] != b->columns[column]) return column;
+    }
+    return CHECKSUM_COLUMN_COUNT;
+}
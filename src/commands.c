@@ -0,0 +1,210 @@
+#include "game.h"
+
+// ----------------------------------------------------------------------------
+// Deferred structural commands, see game.h
+// pending handles are ENTITY_PENDING_BIT | buffer << 24 | the buffer's create index,
+// payloads are kept 16 byte aligned so spawn args and component values can be read in place
+
+#define COMMAND_PENDING_INDEX_BITS 24
+#define COMMAND_DATA_ALIGN 16
+
+internal WorldCommand *commands_record(CommandBuffer *buffer, CommandKind kind, Entity entity, u32 data_size) {
+    u32 buffer_index = (u32) (buffer - world->commands.buffers);
+    u32 data_offset = (u32) arrlen(buffer->data);
+    u32 padded_size = (data_size + COMMAND_DATA_ALIGN - 1) & ~(COMMAND_DATA_ALIGN - 1);
+
+    MemTag prev_tag = mem_set_tag(MEM_TAG_COMMANDS);
+    if (padded_size > 0) {
+        memset(arraddnptr(buffer->data, padded_size), 0, padded_size);
+    }
+    WorldCommand command = {
+        .kind = kind,
+        .entity = entity,
+        .data_offset = data_offset,
+        .data_size = data_size,
+        .sequence = (u32) arrlen(buffer->commands),
+        .buffer = buffer_index,
+    };
+    arrput(buffer->commands, command);
+    mem_set_tag(prev_tag);
+
+    return &arrlast(buffer->commands);
+}
+
+internal Entity commands_resolve(Entity entity) {
+    if (!(entity & ENTITY_PENDING_BIT)) return entity;
+
+    u32 buffer = (entity & ~ENTITY_PENDING_BIT) >> COMMAND_PENDING_INDEX_BITS;
+    u32 index = entity & ((1u << COMMAND_PENDING_INDEX_BITS) - 1);
+    if (buffer >= COMMAND_BUFFER_MAX_WORKERS) return ENTITY_NONE;
+
+    u32 created = world->commands.created_offsets[buffer] + index;
+    return (created < arrlen(world->commands.created)) ? world->commands.created[created] : ENTITY_NONE;
+}
+
+// spawns in origin order, ties go to the recording order
+internal int commands_compare_creates(const void *a, const void *b) {
+    const WorldCommand *x = a;
+    const WorldCommand *y = b;
+    if (x->origin != y->origin) return (x->origin < y->origin) ? -1 : 1;
+    if (x->buffer != y->buffer) return (x->buffer < y->buffer) ? -1 : 1;
+    return (x->sequence < y->sequence) ? -1 : (x->sequence > y->sequence);
+}
+
+// destroys after everything else, the rest per entity in recording order
+internal int commands_compare_changes(const void *a, const void *b) {
+    const WorldCommand *x = a;
+    const WorldCommand *y = b;
+    bool x_destroy = x->kind == COMMAND_DESTROY;
+    bool y_destroy = y->kind == COMMAND_DESTROY;
+    if (x_destroy != y_destroy) return x_destroy ? 1 : -1;
+    if (x->entity != y->entity) return (x->entity < y->entity) ? -1 : 1;
+    if (x->buffer != y->buffer) return (x->buffer < y->buffer) ? -1 : 1;
+    return (x->sequence < y->sequence) ? -1 : (x->sequence > y->sequence);
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+CommandBuffer *world_command_buffer(u32 worker) {
+    if (worker >= COMMAND_BUFFER_MAX_WORKERS) {
+        fprintf(stderr, "commands: worker %u is past the %d command buffers\n", worker, COMMAND_BUFFER_MAX_WORKERS);
+        abort();
+    }
+    return &world->commands.buffers[worker];
+}
+
+Entity world_defer_create(CommandBuffer *buffer, Entity origin, SpawnFunc spawn, const void *args, u32 args_size) {
+    u32 buffer_index = (u32) (buffer - world->commands.buffers);
+    Entity pending = ENTITY_PENDING_BIT | (buffer_index << COMMAND_PENDING_INDEX_BITS) | buffer->num_creates++;
+
+    WorldCommand *command = commands_record(buffer, COMMAND_CREATE, pending, args_size);
+    command->origin = origin;
+    command->spawn = spawn;
+    if (args_size > 0) {
+        memcpy(buffer->data + command->data_offset, args, args_size);
+    }
+    return pending;
+}
+
+void world_defer_destroy(CommandBuffer *buffer, Entity entity) {
+    commands_record(buffer, COMMAND_DESTROY, entity, 0);
+}
+
+void *world_defer_add_component(CommandBuffer *buffer, Entity entity, ComponentId id) {
+    // only reads the registry, which doesn't change during an update
+    u32 id_index = id - COMPONENT_BUILTIN_COUNT;
+    bool is_registered = id >= COMPONENT_BUILTIN_COUNT && id_index < arrlen(world->registry.stores);
+    if (!is_registered) return NULL;
+
+    WorldCommand *command = commands_record(buffer, COMMAND_ADD_COMPONENT, entity, world->registry.stores[id_index].element_size);
+    command->component = id;
+    return buffer->data + command->data_offset;
+}
+
+void world_defer_remove_component(CommandBuffer *buffer, Entity entity, ComponentId id) {
+    WorldCommand *command = commands_record(buffer, COMMAND_REMOVE_COMPONENT, entity, 0);
+    command->component = id;
+}
+
+void world_apply_commands() {
+    WorldCommands *commands = &world->commands;
+
+    // take everything recorded so far into one batch and empty the buffers, payloads are
+    // copied along so anything recorded while applying can't move them underneath us
+    u32 num_commands = 0;
+    u32 num_creates = 0;
+    for (u32 i = 0; i < COMMAND_BUFFER_MAX_WORKERS; i++) {
+        num_commands += arrlen(commands->buffers[i].commands);
+        commands->created_offsets[i] = num_creates;
+        num_creates += commands->buffers[i].num_creates;
+    }
+    if (num_commands == 0) return;
+
+    MemTag prev_tag = mem_set_tag(MEM_TAG_COMMANDS);
+    arrsetlen(commands->sorted, 0);
+    arrsetlen(commands->data, 0);
+    arrsetlen(commands->created, num_creates);
+    for (u32 i = 0; i < COMMAND_BUFFER_MAX_WORKERS; i++) {
+        CommandBuffer *buffer = &commands->buffers[i];
+        u32 data_base = (u32) arrlen(commands->data);
+        for (u32 c = 0; c < arrlen(buffer->commands); c++) {
+            WorldCommand command = buffer->commands[c];
+            command.data_offset += data_base;
+            arrput(commands->sorted, command);
+        }
+        if (arrlen(buffer->data) > 0) {
+            memcpy(arraddnptr(commands->data, arrlen(buffer->data)), buffer->data, arrlen(buffer->data));
+        }
+
+        arrsetlen(buffer->commands, 0);
+        arrsetlen(buffer->data, 0);
+        buffer->num_creates = 0;
+    }
+    mem_set_tag(prev_tag);
+
+    // creates go to the front, the sort then puts them in origin order
+    u32 num_sorted_creates = 0;
+    for (u32 i = 0; i < num_commands; i++) {
+        if (commands->sorted[i].kind == COMMAND_CREATE) {
+            WorldCommand create = commands->sorted[i];
+            commands->sorted[i] = commands->sorted[num_sorted_creates];
+            commands->sorted[num_sorted_creates++] = create;
+        }
+    }
+    qsort(commands->sorted, num_sorted_creates, sizeof(WorldCommand), commands_compare_creates);
+
+    // all ids are handed out before any spawn runs, so a batch's spawns always get a contiguous run.
+    // pending handles are only resolved for the commands of this batch, a spawn gets its real entity
+    for (u32 i = 0; i < num_sorted_creates; i++) {
+        WorldCommand *create = &commands->sorted[i];
+        u32 index = create->entity & ((1u << COMMAND_PENDING_INDEX_BITS) - 1);
+        commands->created[commands->created_offsets[create->buffer] + index] = world_create_entity();
+    }
+    for (u32 i = 0; i < num_sorted_creates; i++) {
+        WorldCommand *create = &commands->sorted[i];
+        if (create->spawn) {
+            create->spawn(commands_resolve(create->entity), commands->data + create->data_offset);
+        }
+    }
+
+    WorldCommand *changes = commands->sorted + num_sorted_creates;
+    u32 num_changes = num_commands - num_sorted_creates;
+    for (u32 i = 0; i < num_changes; i++) {
+        changes[i].entity = commands_resolve(changes[i].entity);
+    }
+    qsort(changes, num_changes, sizeof(WorldCommand), commands_compare_changes);
+
+    for (u32 i = 0; i < num_changes; i++) {
+        WorldCommand *change = &changes[i];
+        if (change->entity == ENTITY_NONE || change->entity >= world->num_entities) continue;
+
+        switch (change->kind) {
+            case COMMAND_ADD_COMPONENT: {
+                void *data = entity_add_component(change->entity, change->component);
+                if (data) memcpy(data, commands->data + change->data_offset, change->data_size);
+                break;
+            }
+            case COMMAND_REMOVE_COMPONENT: {
+                entity_remove_component(change->entity, change->component);
+                break;
+            }
+            case COMMAND_DESTROY: {
+                world_destroy_entity(change->entity);
+                break;
+            }
+            default: break;
+        }
+    }
+}
+
+void world_cleanup_commands() {
+    WorldCommands *commands = &world->commands;
+    for (u32 i = 0; i < COMMAND_BUFFER_MAX_WORKERS; i++) {
+        arrfree(commands->buffers[i].commands);
+        arrfree(commands->buffers[i].data);
+    }
+    arrfree(commands->sorted);
+    arrfree(commands->data);
+    arrfree(commands->created);
+}
@@ -0,0 +1,166 @@
+#include "game.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Entity storage maintenance, see game.h
+
+// entities without a position sort after everything else, in id order
+internal const u64 COMPACT_KEY_UNPLACED = 0xFFFFFFFFFFFFFFFFull;
+
+// spread the 32 bits of v out to the even bits of the result
+internal u64 compact_spread_bits(u32 v) {
+    u64 x = v;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8))  & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2))  & 0x3333333333333333ull;
+    x = (x | (x << 1))  & 0x5555555555555555ull;
+    return x;
+}
+
+// flipping the sign bit keeps negative coordinates ordered below positive ones
+internal u64 compact_morton_key(Entity entity) {
+    Rectangle bounds = {0};
+    if (!entity_get_bounds(entity, &bounds)) return COMPACT_KEY_UNPLACED;
+
+    i32 center_x = (i32) floorf(bounds.x + bounds.width / 2);
+    i32 center_y = (i32) floorf(bounds.y + bounds.height / 2);
+    return compact_spread_bits((u32) center_x ^ 0x80000000u) | (compact_spread_bits((u32) center_y ^ 0x80000000u) << 1);
+}
+
+internal int compact_compare_items(const void *a, const void *b) {
+    const CompactionItem *x = a;
+    const CompactionItem *y = b;
+    if (x->key != y->key) return (x->key < y->key) ? -1 : 1;
+    return (x->entity < y->entity) ? -1 : (x->entity > y->entity);
+}
+
+// column[i] = column[order[i]] for the first `count` slots, through the gather scratch
+internal void compact_gather(void *column, u32 element_size, u32 count) {
+    EntityCompaction *compaction = &world->compaction;
+    u8 *bytes = column;
+    for (u32 i = 0; i < count; i++) {
+        memcpy(compaction->gather + (u64) i * element_size, bytes + (u64) compaction->order[i] * element_size, element_size);
+    }
+    memcpy(bytes, compaction->gather, (u64) count * element_size);
+}
+
+#define COMPACT_COLUMN(column) \
+    do { compact_gather((column), sizeof(*(column)), count); arrsetlen((column), count); } while (0)
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+bool world_compact_entities() {
+    EntityCompaction *compaction = &world->compaction;
+
+    // pending handles from the command buffers can't be remapped, so they're resolved first
+    world_apply_commands();
+
+    // ENTITY_NONE stays where it is, every other live entity gets a key
+    u32 num_entities = world->num_entities;
+    MemTag prev_tag = mem_set_tag(MEM_TAG_WORLD);
+    arrsetlen(compaction->items, 0);
+    for (Entity entity = 1; entity < num_entities; entity++) {
+        if (!world->infos.in_use[entity]) continue;
+        CompactionItem item = {compact_morton_key(entity), entity};
+        arrput(compaction->items, item);
+    }
+    u32 count = arrlen(compaction->items) + 1;
+    qsort(compaction->items, count - 1, sizeof(CompactionItem), compact_compare_items);
+
+    arrsetlen(compaction->order, count);
+    compaction->order[0] = ENTITY_NONE;
+    bool in_place = count == num_entities;
+    for (u32 i = 1; i < count; i++) {
+        compaction->order[i] = compaction->items[i - 1].entity;
+        in_place = in_place && compaction->order[i] == i;
+    }
+
+    // nothing moves, but the table still has to describe this pass rather than the one before
+    arrsetlen(compaction->remap, num_entities);
+    memset(compaction->remap, 0, num_entities * sizeof(Entity));
+    for (u32 i = 0; i < count; i++) {
+        compaction->remap[compaction->order[i]] = i;
+    }
+    compaction->passes++;
+    if (in_place) {
+        mem_set_tag(prev_tag);
+        return false;
+    }
+
+    // big enough for the widest column, the names
+    arrsetlen(compaction->gather, (u64) count * sizeof(NameStr));
+
+    COMPACT_COLUMN(world->infos.in_use);
+    COMPACT_COLUMN(world->infos.active);
+    COMPACT_COLUMN(world->infos.components);
+    COMPACT_COLUMN(world->infos.signatures);
+    COMPACT_COLUMN(world->names.name);
+
+    COMPACT_COLUMN(world->positions.x);
+    COMPACT_COLUMN(world->positions.y);
+    COMPACT_COLUMN(world->positions.prev_x);
+    COMPACT_COLUMN(world->positions.prev_y);
+
+    COMPACT_COLUMN(world->movements.vel_x);
+    COMPACT_COLUMN(world->movements.vel_y);
+    COMPACT_COLUMN(world->movements.remainder_x);
+    COMPACT_COLUMN(world->movements.remainder_y);
+    COMPACT_COLUMN(world->movements.friction);
+    COMPACT_COLUMN(world->movements.gravity);
+    COMPACT_COLUMN(world->movements.inv_mass);
+    COMPACT_COLUMN(world->movements.restitution);
+    COMPACT_COLUMN(world->movements.contact_friction);
+    COMPACT_COLUMN(world->movements.sleep_seconds);
+    COMPACT_COLUMN(world->movements.asleep);
+
+    // tilemaps move with their cells, dead slots had theirs freed when they were destroyed
+    COMPACT_COLUMN(world->colliders.offset_x);
+    COMPACT_COLUMN(world->colliders.offset_y);
+    COMPACT_COLUMN(world->colliders.width);
+    COMPACT_COLUMN(world->colliders.height);
+    COMPACT_COLUMN(world->colliders.radius);
+    COMPACT_COLUMN(world->colliders.shape);
+    COMPACT_COLUMN(world->colliders.mask);
+    COMPACT_COLUMN(world->colliders.on_hit_x);
+    COMPACT_COLUMN(world->colliders.on_hit_y);
+    COMPACT_COLUMN(world->colliders.tilemaps);
+    mem_set_tag(prev_tag);
+
+    world->num_entities = count;
+
+    // the collider blocks are rebuilt from the columns by the next update, everything else
+    // that keeps ids between updates is pointed at the new ones here
+    world_remap_registry(compaction->remap);
+    contact_solver_remap(&world->solver, compaction->remap);
+    if (world->spatial_queries) {
+        world_build_spatial_index();
+    }
+    return true;
+}
+
+void world_reserve_compaction() {
+    EntityCompaction *compaction = &world->compaction;
+    u32 num_entities = world->num_entities;
+    MemTag prev_tag = mem_set_tag(MEM_TAG_WORLD);
+    arrsetcap(compaction->items, num_entities);
+    arrsetcap(compaction->order, num_entities);
+    arrsetcap(compaction->remap, num_entities);
+    arrsetcap(compaction->gather, (u64) num_entities * sizeof(NameStr));
+    mem_set_tag(prev_tag);
+}
+
+Entity world_remap_entity(Entity entity) {
+    EntityCompaction *compaction = &world->compaction;
+    if (compaction->passes == 0) return entity;
+    return (entity < arrlen(compaction->remap)) ? compaction->remap[entity] : ENTITY_NONE;
+}
+
+void world_cleanup_compaction() {
+    arrfree(world->compaction.remap);
+    arrfree(world->compaction.items);
+    arrfree(world->compaction.order);
+    arrfree(world->compaction.gather);
+}
@@ -0,0 +1,313 @@
+#include "game.h"
+#include "env.h"
+#include "os.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Batched headless environments, see env.h
+
+typedef struct {
+    World world;
+    Arena arena;
+
+    u32 ticks;
+    f32 reward;
+    bool done;
+} Env;
+
+// per worker step timings, padded out to a cache line so the workers don't share one
+typedef struct {
+    f64 seconds;
+    u64 env_steps;
+    u32 num_envs;
+    u8 padding[44];
+} EnvWorkerStats;
+
+struct EnvBatch {
+    // allocated one by one on the worker that creates them, see env_create_range()
+    Env **envs;
+    u32 num_envs;
+    u64 seed;
+
+    // every env stays on the worker (and so the node) that created it
+    bool pinned;
+    EnvWorkerStats *worker_stats;
+    u32 num_workers;
+
+    // arguments of the call in flight, read by the job workers
+    const u8 *actions;
+    u8 *ai_actions;
+    f32 *observations;
+    f32 *rewards;
+    u8 *dones;
+};
+
+internal const f32 ENV_DT = 1.0f / ENV_TICKS_PER_SEC;
+internal const i32 ENV_ARENA_WIDTH = 1280;
+internal const i32 ENV_ARENA_HEIGHT = 720;
+
+// enough envs per job batch to amortize the dispatch, few enough to balance uneven workloads
+internal const u32 ENV_BATCH_SIZE = 64;
+
+// the env being stepped on this thread, so the on_hit callbacks can report rewards
+thread_static Env *env_current = NULL;
+
+// batches created and not yet destroyed, the job pool can't be restarted under any of them
+global u32 env_live_batches = 0;
+
+// ----------------------------------------------------------------------------
+// Internal implementation
+
+internal void EnvBallHitX(Entity entity, Entity collided_with) {
+    world->movements.vel_x[entity] *= -1;
+    world->movements.remainder_x[entity] = 0;
+}
+
+internal void EnvBallHitY(Entity entity, Entity collided_with) {
+    world->movements.vel_y[entity] *= -1;
+    world->movements.remainder_y[entity] = 0;
+
+    if (collided_with == env_current->arena.bounds_b) {
+        env_current->reward += ENV_REWARD_MISS;
+        env_current->done = true;
+    }
+}
+
+internal void env_reset_episode(Env *env) {
+    // serve in a random horizontal direction, always falling towards the paddle.
+    // the env's world stream is only used to jitter the serve, the physics itself is deterministic
+    f32 vel_x = rng_signed(&env->world.rng) * 300;
+    f32 vel_y = -200 - 100 * rng_unit(&env->world.rng);
+
+    arena_reset(&env->arena, vel_x, vel_y);
+    env->ticks = 0;
+}
+
+internal void env_write_observation(Env *env, f32 *obs) {
+    Entity ball = env->arena.ball;
+    Entity paddle = env->arena.paddle;
+
+    obs[ENV_OBS_BALL_X]       = world->positions.x[ball];
+    obs[ENV_OBS_BALL_Y]       = world->positions.y[ball];
+    obs[ENV_OBS_BALL_VEL_X]   = world->movements.vel_x[ball];
+    obs[ENV_OBS_BALL_VEL_Y]   = world->movements.vel_y[ball];
+    obs[ENV_OBS_PADDLE_X]     = world->positions.x[paddle];
+    obs[ENV_OBS_PADDLE_Y]     = world->positions.y[paddle];
+    obs[ENV_OBS_PADDLE_VEL_X] = world->movements.vel_x[paddle];
+    obs[ENV_OBS_PADDLE_VEL_Y] = world->movements.vel_y[paddle];
+}
+
+internal void env_bind(Env *env) {
+    world = &env->world;
+    env_current = env;
+}
+
+// NULL for a worker the batch wasn't sized for, which only a pool restarted behind env.c's back has
+internal EnvWorkerStats *env_worker_stats(EnvBatch *batch, u32 worker) {
+    return (worker < batch->num_workers) ? &batch->worker_stats[worker] : NULL;
+}
+
+internal void env_create_range(void *data, u32 begin, u32 end, u32 worker) {
+    EnvBatch *batch = data;
+    EnvWorkerStats *stats = env_worker_stats(batch, worker);
+    if (stats) stats->num_envs += end - begin;
+    for (u32 i = begin; i < end; i++) {
+        // the env and its world columns are first touched here, on the thread that will usually step them,
+        // always the one that will when the batch is pinned
+        Env *env = calloc(1, sizeof(Env));
+        batch->envs[i] = env;
+        env_bind(env);
+
+        world_init();
+        rng_seed(&world->rng, batch->seed + i);
+        world->defer_hit_events = true;
+        arena_create(&env->arena, ENV_ARENA_WIDTH, ENV_ARENA_HEIGHT);
+        world->colliders.on_hit_x[env->arena.ball] = EnvBallHitX;
+        world->colliders.on_hit_y[env->arena.ball] = EnvBallHitY;
+    }
+}
+
+internal void env_destroy_range(void *data, u32 begin, u32 end, u32 worker) {
+    EnvBatch *batch = data;
+    for (u32 i = begin; i < end; i++) {
+        env_bind(batch->envs[i]);
+        world_cleanup();
+        free(batch->envs[i]);
+    }
+}
+
+internal void env_reset_range(void *data, u32 begin, u32 end, u32 worker) {
+    EnvBatch *batch = data;
+    for (u32 i = begin; i < end; i++) {
+        Env *env = batch->envs[i];
+        env_bind(env);
+        env_reset_episode(env);
+        env_write_observation(env, &batch->observations[i * ENV_OBS_COUNT]);
+    }
+}
+
+internal void env_step_range(void *data, u32 begin, u32 end, u32 worker) {
+    EnvBatch *batch = data;
+    f64 start = os_now_seconds();
+    for (u32 i = begin; i < end; i++) {
+        Env *env = batch->envs[i];
+        env_bind(env);
+
+        Entity ball = env->arena.ball;
+        u8 action = batch->actions[i];
+        env->reward = 0;
+        env->done = false;
+
+        f32 prev_ball_vel_y = world->movements.vel_y[ball];
+
+        arena_update_paddle(&env->arena, action == ENV_ACTION_LEFT, action == ENV_ACTION_RIGHT, ENV_DT);
+        world_update(ENV_DT);
+
+        // gravity only ever pulls the ball down, so an upward flip that
+        // didn't come from the bottom bound came from the paddle
+        bool bounced_up = prev_ball_vel_y < 0 && world->movements.vel_y[ball] > 0;
+        if (bounced_up && !env->done) {
+            env->reward += ENV_REWARD_HIT;
+        }
+
+        env->ticks++;
+        if (env->ticks >= ENV_MAX_EPISODE_LEN) {
+            env->done = true;
+        }
+
+        batch->rewards[i] = env->reward;
+        batch->dones[i] = env->done;
+
+        if (env->done) {
+            env_reset_episode(env);
+        }
+        env_write_observation(env, &batch->observations[i * ENV_OBS_COUNT]);
+    }
+
+    EnvWorkerStats *stats = env_worker_stats(batch, worker);
+    if (stats) {
+        stats->seconds += os_now_seconds() - start;
+        stats->env_steps += end - begin;
+    }
+}
+
+internal void env_ai_range(void *data, u32 begin, u32 end, u32 worker) {
+    EnvBatch *batch = data;
+    for (u32 i = begin; i < end; i++) {
+        Env *env = batch->envs[i];
+        env_bind(env);
+
+        bool move_left, move_right;
+        arena_ai_paddle(&env->arena, ENV_DT, &move_left, &move_right);
+        batch->ai_actions[i] = move_left ? ENV_ACTION_LEFT : move_right ? ENV_ACTION_RIGHT : ENV_ACTION_NONE;
+    }
+}
+
+// run a range function over every env, leaving the caller's bound world untouched
+internal void env_run(EnvBatch *batch, JobRangeFunc *func) {
+    World *bound_world = world;
+    if (batch->pinned) {
+        jobs_parallel_for_static(batch->num_envs, func, batch);
+    } else {
+        jobs_parallel_for(batch->num_envs, ENV_BATCH_SIZE, func, batch);
+    }
+    world = bound_world;
+    env_current = NULL;
+}
+
+// gets the shared pool to `num_threads` threads, pinned if asked. live batches have their worker
+// stats sized for the pool they were created on, and pinned ones have their envs on its workers'
+// nodes, so it's only ever restarted without any
+internal bool env_use_pool(u32 num_threads, bool pinned) {
+    if (jobs_worker_count() == num_threads && (jobs_pinned() || !pinned)) return true;
+
+    if (env_live_batches > 0) {
+        fprintf(stderr, "env: can't restart the job pool with %u %sthreads while %u batches use it\n",
+                num_threads, pinned ? "pinned " : "", env_live_batches);
+        return false;
+    }
+    if (pinned) {
+        jobs_init_pinned(num_threads);
+    } else {
+        jobs_init(num_threads);
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Implementation
+
+internal EnvBatch *env_create_batch(u32 num_envs, u64 seed, bool pinned) {
+    EnvBatch *batch = calloc(1, sizeof(EnvBatch));
+    batch->num_envs = num_envs;
+    batch->seed = seed;
+    batch->pinned = pinned;
+    batch->envs = calloc(num_envs, sizeof(Env *));
+    batch->num_workers = jobs_worker_count();
+    batch->worker_stats = calloc(batch->num_workers, sizeof(EnvWorkerStats));
+    env_live_batches++;
+
+    env_run(batch, env_create_range);
+    return batch;
+}
+
+EnvBatch *env_create(uint32_t num_envs, uint32_t num_threads, uint64_t seed) {
+    // an unpinned batch is just as happy on a pinned pool
+    if (!env_use_pool((num_threads > 0) ? num_threads : os_cpu_count(), false)) return NULL;
+    return env_create_batch(num_envs, seed, false);
+}
+
+EnvBatch *env_create_pinned(uint32_t num_envs, uint32_t num_threads, uint64_t seed) {
+    if (!env_use_pool((num_threads > 0) ? num_threads : os_cpu_count(), true)) return NULL;
+    return env_create_batch(num_envs, seed, true);
+}
+
+void env_destroy(EnvBatch *batch) {
+    if (!batch) return;
+
+    env_run(batch, env_destroy_range);
+    free(batch->envs);
+    free(batch->worker_stats);
+    free(batch);
+    env_live_batches--;
+}
+
+uint32_t env_count(const EnvBatch *batch) {
+    return batch->num_envs;
+}
+
+uint32_t env_node_stats(const EnvBatch *batch, EnvNodeStats *nodes, uint32_t max_nodes) {
+    u32 num_nodes = 0;
+    memset(nodes, 0, max_nodes * sizeof(EnvNodeStats));
+    for (u32 worker = 0; worker < batch->num_workers; worker++) {
+        u32 node = jobs_worker_node(worker);
+        if (node >= max_nodes) continue;
+
+        const EnvWorkerStats *stats = &batch->worker_stats[worker];
+        nodes[node].num_workers++;
+        nodes[node].num_envs += stats->num_envs;
+        nodes[node].env_steps += stats->env_steps;
+        nodes[node].busy_seconds += stats->seconds;
+        num_nodes = Max(num_nodes, node + 1);
+    }
+    return num_nodes;
+}
+
+void env_reset(EnvBatch *batch, float *observations) {
+    batch->observations = observations;
+    env_run(batch, env_reset_range);
+}
+
+void env_ai_actions(EnvBatch *batch, uint8_t *actions) {
+    batch->ai_actions = actions;
+    env_run(batch, env_ai_range);
+}
+
+void env_step(EnvBatch *batch, const uint8_t *actions, float *observations, float *rewards, uint8_t *dones) {
+    batch->actions = actions;
+    batch->observations = observations;
+    batch->rewards = rewards;
+    batch->dones = dones;
+    env_run(batch, env_step_range);
+}
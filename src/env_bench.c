@@ -0,0 +1,89 @@
+#include "env.h"
+#include "os.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Throughput benchmark for the batched environments
+// usage: prong_env_bench [num_envs] [num_steps] [num_threads] [ai] [pinned]
+// random actions by default, a nonzero `ai` plays every env with the built-in CPU player instead,
+// a nonzero `pinned` pins the threads and keeps every env's world on its thread's NUMA node
+
+#define BENCH_MAX_NODES 64
+
+int main(int argc, char **argv) {
+    u32 num_envs    = (argc > 1) ? (u32) atoi(argv[1]) : 4096;
+    u32 num_steps   = (argc > 2) ? (u32) atoi(argv[2]) : 1000;
+    u32 num_threads = (argc > 3) ? (u32) atoi(argv[3]) : 0;
+    bool use_ai     = (argc > 4) ? atoi(argv[4]) != 0 : false;
+    bool pinned     = (argc > 5) ? atoi(argv[5]) != 0 : false;
+
+    EnvBatch *batch = pinned ? env_create_pinned(num_envs, num_threads, 1234) : env_create(num_envs, num_threads, 1234);
+    if (!batch) return 1;
+
+    f32 *observations = calloc(num_envs * ENV_OBS_COUNT, sizeof(f32));
+    f32 *rewards = calloc(num_envs, sizeof(f32));
+    u8 *dones = calloc(num_envs, sizeof(u8));
+    u8 *actions = calloc(num_envs, sizeof(u8));
+
+    env_reset(batch, observations);
+
+    u64 episodes = 0;
+    f64 total_reward = 0;
+    u32 lcg = 1;
+    f64 ai_seconds = 0;
+
+    f64 start = os_now_seconds();
+    for (u32 step = 0; step < num_steps; step++) {
+        if (use_ai) {
+            f64 ai_start = os_now_seconds();
+            env_ai_actions(batch, actions);
+            ai_seconds += os_now_seconds() - ai_start;
+        } else {
+            for (u32 i = 0; i < num_envs; i++) {
+                lcg = lcg * 1664525u + 1013904223u;
+                actions[i] = (u8) ((lcg >> 16) % ENV_ACTION_COUNT);
+            }
+        }
+
+        env_step(batch, actions, observations, rewards, dones);
+
+        for (u32 i = 0; i < num_envs; i++) {
+            episodes += dones[i];
+            total_reward += rewards[i];
+        }
+    }
+    f64 elapsed = os_now_seconds() - start;
+
+    f64 env_steps = (f64) num_envs * num_steps;
+    printf("envs: %u, steps: %u, threads: %u%s, numa nodes: %u\n",
+           num_envs, num_steps, jobs_worker_count(), pinned ? " (pinned)" : "", os_numa_node_count());
+    printf("elapsed: %.3f s, %.2f M env-steps/sec\n", elapsed, env_steps / elapsed / 1e6);
+    printf("episodes: %llu, mean reward per episode: %.3f\n",
+           (unsigned long long) episodes, episodes ? total_reward / episodes : 0.0);
+    if (use_ai) {
+        printf("ai: %.3f s, %.1f ns per decision, reward %.1f over %u steps\n",
+               ai_seconds, ai_seconds / env_steps * 1e9, total_reward, num_steps);
+    }
+
+    // per node rates are over the node's own busy time, so they add up to more than the total
+    // whenever the nodes wait on each other
+    EnvNodeStats nodes[BENCH_MAX_NODES];
+    u32 num_nodes = env_node_stats(batch, nodes, BENCH_MAX_NODES);
+    for (u32 node = 0; node < num_nodes; node++) {
+        if (nodes[node].num_workers == 0) continue;
+        f64 node_seconds = nodes[node].busy_seconds / nodes[node].num_workers;
+        printf("node %u: %u threads, %u envs, %.2f M env-steps/sec, %.0f%% busy\n",
+               node, nodes[node].num_workers, nodes[node].num_envs,
+               node_seconds > 0 ? nodes[node].env_steps / node_seconds / 1e6 : 0.0,
+               100.0 * node_seconds / elapsed);
+    }
+
+    env_destroy(batch);
+    jobs_shutdown();
+    free(observations);
+    free(rewards);
+    free(dones);
+    free(actions);
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "game.h"
+
+// ----------------------------------------------------------------------------
+// Input events, see game.h
+
+typedef struct {
+    KeyboardKey key;
+    InputAction action;
+} InputBinding;
+
+global const InputBinding input_bindings[] = {
+    {KEY_LEFT,  INPUT_ACTION_MOVE_LEFT},
+    {KEY_A,     INPUT_ACTION_MOVE_LEFT},
+    {KEY_RIGHT, INPUT_ACTION_MOVE_RIGHT},
+    {KEY_D,     INPUT_ACTION_MOVE_RIGHT},
+    {KEY_SPACE, INPUT_ACTION_STEP_FRAME},
+};
+
+// single producer: fill the slot, then publish it by bumping the head
+internal void input_push(InputRing *ring, f64 time, InputAction action, bool down) {
+    u32 head = ring->head;
+    if (head - ins_atomic_u32_eval(&ring->tail) >= INPUT_RING_SIZE) {
+        // the simulation isn't draining (stalled or off the gameplay screen), newest events lose
+        ins_atomic_u32_add_eval(&ring->dropped, 1);
+        return;
+    }
+
+    ring->events[head % INPUT_RING_SIZE] = (InputEvent) {time, action, down};
+    ins_atomic_u32_eval_assign(&ring->head, head + 1);
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void input_poll(InputPoller *poller, InputRing *ring, f64 now) {
+    // a key that went down and came back up within one poll never shows up as down,
+    // only in raylib's queue of presses, which is refilled by every poll
+    bool tapped[INPUT_ACTION_COUNT] = {0};
+    for (i32 key = GetKeyPressed(); key != 0; key = GetKeyPressed()) {
+        if (key < 0 || key >= INPUT_MAX_KEYS) continue;
+        poller->key_pressed[key] = true;
+
+        for (u32 i = 0; i < sizeof(input_bindings) / sizeof(input_bindings[0]); i++) {
+            if (input_bindings[i].key == (KeyboardKey) key) tapped[input_bindings[i].action] = true;
+        }
+    }
+
+    for (i32 key = 0; key < INPUT_MAX_KEYS; key++) {
+        bool down = IsKeyDown(key);
+        if (down && !poller->key_down[key]) poller->key_pressed[key] = true;
+        poller->key_down[key] = down;
+    }
+
+    // only changes of an action go out, whichever of its keys caused them
+    bool action_down[INPUT_ACTION_COUNT] = {0};
+    for (u32 i = 0; i < sizeof(input_bindings) / sizeof(input_bindings[0]); i++) {
+        action_down[input_bindings[i].action] |= poller->key_down[input_bindings[i].key];
+    }
+
+    for (u32 action = 0; action < INPUT_ACTION_COUNT; action++) {
+        if (action_down[action] != poller->action_down[action]) {
+            input_push(ring, now, action, action_down[action]);
+            poller->action_down[action] = action_down[action];
+        } else if (tapped[action] && !action_down[action]) {
+            input_push(ring, now, action, true);
+            input_push(ring, now, action, false);
+        }
+    }
+}
+
+bool input_key_pressed(const InputPoller *poller, KeyboardKey key) {
+    return (key >= 0 && key < INPUT_MAX_KEYS) ? poller->key_pressed[key] : false;
+}
+
+void input_end_frame(InputPoller *poller) {
+    memset(poller->key_pressed, 0, sizeof(poller->key_pressed));
+}
+
+void input_sample(InputRing *ring, InputSample *sample, f64 time) {
+    for (u32 action = 0; action < INPUT_ACTION_COUNT; action++) {
+        sample->active[action] = sample->held[action];
+        sample->presses[action] = 0;
+    }
+
+    // single consumer: read up to the published head, then hand the slots back by bumping the tail
+    u32 head = ins_atomic_u32_eval(&ring->head);
+    u32 tail = ring->tail;
+    for (; tail != head; tail++) {
+        const InputEvent *event = &ring->events[tail % INPUT_RING_SIZE];
+        if (event->time > time) break;
+
+        sample->held[event->action] = event->down;
+        if (event->down) {
+            sample->active[event->action] = true;
+            sample->presses[event->action]++;
+        }
+    }
+    ins_atomic_u32_eval_assign(&ring->tail, tail);
+}
@@ -0,0 +1,494 @@
+#include "game.h"
+#include "raygui.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Entity inspector, see game.h
+
+internal const f32 INSPECTOR_ROW_HEIGHT = 20;
+internal const f32 INSPECTOR_PADDING = 8;
+internal const f32 INSPECTOR_LABEL_WIDTH = 64;
+// selected entity's header, position, velocity, offset, size and mask
+internal const u32 INSPECTOR_DETAIL_ROWS = 6;
+// give up on a torn request after this many tries and keep using the previous one
+internal const u32 INSPECTOR_REQUEST_ATTEMPTS = 4;
+internal const i32 INSPECTOR_VALUE_LIMIT = 1000000;
+
+internal const char *INSPECTOR_COMPONENT_NAMES[] = {"name", "position", "movement", "collider"};
+internal const char *INSPECTOR_COLLISION_NAMES[] = {"ball", "paddle", "bounds"};
+
+// ----------------------------------------------------------------------------
+// Internal implementation, render thread
+
+internal void inspector_write_request(Inspector *inspector, const InspectorRequest *request) {
+    u32 sequence = inspector->request_sequence;
+    ins_atomic_u32_eval_assign(&inspector->request_sequence, sequence + 1);
+    ins_atomic_fence();
+    inspector->request = *request;
+    ins_atomic_fence();
+    ins_atomic_u32_eval_assign(&inspector->request_sequence, sequence + 2);
+}
+
+internal void inspector_push_edit(Inspector *inspector, Entity entity, InspectorField field, i32 value) {
+    InspectorEditRing *ring = &inspector->edits;
+    u32 head = ring->head;
+    u32 tail = ins_atomic_u32_eval(&ring->tail);
+    if (head - tail >= INSPECTOR_EDITS_MAX) {
+        // the simulation is paused or stalled, the edit can be typed again
+        return;
+    }
+
+    ring->items[head % INSPECTOR_EDITS_MAX] = (InspectorEdit) {entity, field, value, inspector->ui.compaction_passes};
+    ins_atomic_u32_eval_assign(&ring->head, head + 1);
+}
+
+// one toggle per bit, labelled left to right from bit 0
+internal void inspector_draw_flags(Rectangle row, const char *label, const char **names, u32 count, u32 *flags) {
+    GuiLabel((Rectangle) {row.x, row.y, INSPECTOR_LABEL_WIDTH, row.height}, label);
+
+    f32 width = (row.width - INSPECTOR_LABEL_WIDTH) / count;
+    for (u32 i = 0; i < count; i++) {
+        bool active = (*flags & (1u << i)) != 0;
+        Rectangle toggle = {row.x + INSPECTOR_LABEL_WIDTH + i * width, row.y, width - 2, row.height};
+        GuiToggle(toggle, names[i], &active);
+        *flags = active ? (*flags | (1u << i)) : (*flags & ~(1u << i));
+    }
+}
+
+// shows the live value until the box is clicked, leaving the box sends whatever was typed
+internal void inspector_draw_value(Inspector *inspector, Rectangle bounds, const char *label, Entity entity,
+                                   InspectorField field, i32 live_value, i32 min_value) {
+    struct InspectorUi *ui = &inspector->ui;
+    if (!ui->editing[field]) {
+        ui->values[field] = live_value;
+    }
+
+    // raygui draws the label to the left of the box
+    Rectangle box = {bounds.x + INSPECTOR_LABEL_WIDTH, bounds.y, bounds.width - INSPECTOR_LABEL_WIDTH - 4, bounds.height};
+    if (GuiValueBox(box, label, &ui->values[field], min_value, INSPECTOR_VALUE_LIMIT, ui->editing[field])) {
+        ui->editing[field] = !ui->editing[field];
+        if (!ui->editing[field] && ui->values[field] != live_value) {
+            inspector_push_edit(inspector, entity, field, ui->values[field]);
+        }
+    }
+}
+
+internal void inspector_draw_row(const InspectorRow *row, Rectangle bounds, bool selected) {
+    if (selected) {
+        DrawRectangleRec(bounds, GetColor(GuiGetStyle(DEFAULT, BASE_COLOR_PRESSED)));
+    }
+
+    char components[] = "----";
+    for (u32 i = 0; i < ArrayCount(INSPECTOR_COMPONENT_NAMES); i++) {
+        if (row->components & (1u << i)) components[i] = INSPECTOR_COMPONENT_NAMES[i][0];
+    }
+    const char *name = row->in_use ? row->name : "(free)";
+    GuiLabel((Rectangle) {bounds.x + 4, bounds.y, bounds.width - 4, bounds.height},
+             TextFormat("%7u  %-16s %s  %02x  %6d %6d", row->entity, name, components, row->mask, row->x, row->y));
+}
+
+internal void inspector_draw_details(Inspector *inspector, const InspectorEntity *selected, Rectangle row) {
+    if (selected->entity == ENTITY_NONE) {
+        GuiLabel(row, "click an entity to edit it");
+        return;
+    }
+    if (!selected->in_use) {
+        GuiLabel(row, TextFormat("entity %u was destroyed", selected->entity));
+        return;
+    }
+
+    GuiLabel(row, TextFormat("entity %u '%s'  components %#x", selected->entity, selected->name.val, selected->components));
+    row.y += INSPECTOR_ROW_HEIGHT;
+
+    Entity entity = selected->entity;
+    Rectangle left = {row.x, row.y, row.width / 2, row.height};
+    Rectangle right = {row.x + row.width / 2, row.y, row.width / 2, row.height};
+    const f32 step = INSPECTOR_ROW_HEIGHT + INSPECTOR_PADDING / 2;
+
+    if (selected->components & COMPONENT_POSITION) {
+        inspector_draw_value(inspector, left, "x", entity, INSPECTOR_FIELD_POSITION_X, selected->x, -INSPECTOR_VALUE_LIMIT);
+        inspector_draw_value(inspector, right, "y", entity, INSPECTOR_FIELD_POSITION_Y, selected->y, -INSPECTOR_VALUE_LIMIT);
+        left.y += step; right.y += step;
+    }
+    if (selected->components & COMPONENT_MOVEMENT) {
+        inspector_draw_value(inspector, left, "vel x", entity, INSPECTOR_FIELD_VELOCITY_X, calc_round(selected->vel_x), -INSPECTOR_VALUE_LIMIT);
+        inspector_draw_value(inspector, right, "vel y", entity, INSPECTOR_FIELD_VELOCITY_Y, calc_round(selected->vel_y), -INSPECTOR_VALUE_LIMIT);
+        left.y += step; right.y += step;
+    }
+    if (selected->components & COMPONENT_COLLIDER) {
+        inspector_draw_value(inspector, left, "offset x", entity, INSPECTOR_FIELD_OFFSET_X, selected->offset_x, -INSPECTOR_VALUE_LIMIT);
+        inspector_draw_value(inspector, right, "offset y", entity, INSPECTOR_FIELD_OFFSET_Y, selected->offset_y, -INSPECTOR_VALUE_LIMIT);
+        left.y += step; right.y += step;
+
+        if (selected->shape == SHAPE_RECT) {
+            inspector_draw_value(inspector, left, "width", entity, INSPECTOR_FIELD_WIDTH, selected->width, 0);
+            inspector_draw_value(inspector, right, "height", entity, INSPECTOR_FIELD_HEIGHT, selected->height, 0);
+        } else if (selected->shape == SHAPE_CIRC) {
+            inspector_draw_value(inspector, left, "radius", entity, INSPECTOR_FIELD_RADIUS, selected->radius, 0);
+        } else {
+            GuiLabel(left, TextFormat("size %u x %u", selected->width, selected->height));
+        }
+        inspector_draw_value(inspector, right, "mask", entity, INSPECTOR_FIELD_MASK, selected->mask, 0);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Internal implementation, simulation thread
+
+internal InspectorRequest inspector_read_request(Inspector *inspector) {
+    for (u32 attempt = 0; attempt < INSPECTOR_REQUEST_ATTEMPTS; attempt++) {
+        u32 sequence = ins_atomic_u32_load(&inspector->request_sequence);
+        if (sequence & 1) continue;
+        ins_atomic_fence();
+
+        InspectorRequest request = inspector->request;
+
+        ins_atomic_fence();
+        if (ins_atomic_u32_load(&inspector->request_sequence) == sequence) {
+            inspector->sim_request = request;
+            break;
+        }
+    }
+    return inspector->sim_request;
+}
+
+// an id the render thread picked, as it is now. only one compaction pass is remembered, ids from
+// before that are dropped, which takes the panel being closed for the whole interval
+internal Entity inspector_current_entity(Entity entity, u32 compaction_passes) {
+    u32 passes = world->compaction.passes;
+    if (compaction_passes == passes) return entity;
+    return (compaction_passes + 1 == passes) ? world_remap_entity(entity) : ENTITY_NONE;
+}
+
+internal int inspector_compare_entities(const void *a, const void *b) {
+    Entity x = *(const Entity *) a;
+    Entity y = *(const Entity *) b;
+    return (x > y) - (x < y);
+}
+
+internal bool inspector_filter_empty(const InspectorFilter *filter) {
+    return filter->components == 0 && filter->collision == 0 && filter->name[0] == 0;
+}
+
+internal bool inspector_filter_matches(const InspectorFilter *filter, Entity entity) {
+    if (!world->infos.in_use[entity]) return false;
+
+    ComponentMask components = world->infos.components[entity];
+    if ((components & filter->components) != filter->components) return false;
+    if (filter->collision != 0) {
+        if (!(components & COMPONENT_COLLIDER)) return false;
+        if (!(world->colliders.mask[entity] & filter->collision)) return false;
+    }
+    if (filter->name[0] != 0) {
+        if (!(components & COMPONENT_NAME)) return false;
+        if (!strstr(world->names.name[entity].val, filter->name)) return false;
+    }
+    return true;
+}
+
+internal void inspector_reserve(Inspector *inspector) {
+    if (arrcap(inspector->building) >= world->num_entities && arrcap(inspector->matches) >= world->num_entities) return;
+
+    MemTag prev_tag = mem_set_tag(MEM_TAG_RENDER);
+    arrsetcap(inspector->building, world->num_entities);
+    arrsetcap(inspector->matches, world->num_entities);
+    mem_set_tag(prev_tag);
+}
+
+// picks up where the last tick stopped, a finished pass replaces the one on show
+internal void inspector_scan(Inspector *inspector) {
+    inspector_reserve(inspector);
+
+    u32 begin = Max(inspector->scan_cursor, 1);
+    u32 end = Min(begin + INSPECTOR_SCAN_PER_TICK, world->num_entities);
+    for (Entity entity = begin; entity < end; entity++) {
+        if (inspector_filter_matches(&inspector->scan_filter, entity)) {
+            arrput(inspector->building, entity);
+        }
+    }
+    inspector->scan_cursor = end;
+
+    if (inspector->scan_cursor >= world->num_entities) {
+        Entity *finished = inspector->building;
+        inspector->building = inspector->matches;
+        inspector->matches = finished;
+        arrsetlen(inspector->building, 0);
+        inspector->scan_cursor = 0;
+        inspector->scanned_once = true;
+    }
+}
+
+internal void inspector_fill_row(InspectorRow *row, Entity entity) {
+    *row = (InspectorRow) {.entity = entity};
+    if (entity >= world->num_entities) return;
+
+    row->in_use = world->infos.in_use[entity];
+    row->components = world->infos.components[entity];
+    if (row->components & COMPONENT_NAME) {
+        strncpy(row->name, world->names.name[entity].val, INSPECTOR_ROW_NAME_LEN - 1);
+    }
+    if (row->components & COMPONENT_POSITION) {
+        row->x = world->positions.x[entity];
+        row->y = world->positions.y[entity];
+    }
+    if (row->components & COMPONENT_COLLIDER) {
+        row->mask = world->colliders.mask[entity];
+    }
+}
+
+internal void inspector_fill_selected(InspectorEntity *selected, Entity entity) {
+    *selected = (InspectorEntity) {.entity = entity};
+    if (entity == ENTITY_NONE || entity >= world->num_entities) return;
+
+    selected->in_use = world->infos.in_use[entity];
+    selected->components = world->infos.components[entity];
+    if (selected->components & COMPONENT_NAME) {
+        selected->name = world->names.name[entity];
+    }
+    if (selected->components & COMPONENT_POSITION) {
+        selected->x = world->positions.x[entity];
+        selected->y = world->positions.y[entity];
+    }
+    if (selected->components & COMPONENT_MOVEMENT) {
+        selected->vel_x = world->movements.vel_x[entity];
+        selected->vel_y = world->movements.vel_y[entity];
+    }
+    if (selected->components & COMPONENT_COLLIDER) {
+        selected->shape = world->colliders.shape[entity];
+        selected->mask = world->colliders.mask[entity];
+        selected->offset_x = world->colliders.offset_x[entity];
+        selected->offset_y = world->colliders.offset_y[entity];
+        selected->width = world->colliders.width[entity];
+        selected->height = world->colliders.height[entity];
+        selected->radius = world->colliders.radius[entity];
+    }
+}
+
+internal void inspector_apply_edit(const InspectorEdit *edit) {
+    Entity entity = inspector_current_entity(edit->entity, edit->compaction_passes);
+    if (entity == ENTITY_NONE || entity >= world->num_entities || !world->infos.in_use[entity]) return;
+
+    ComponentMask components = world->infos.components[entity];
+    bool has_collider = (components & COMPONENT_COLLIDER) != 0;
+    Shape shape = has_collider ? world->colliders.shape[entity] : SHAPE_NONE;
+    i32 value = edit->value;
+
+    switch (edit->field) {
+        case INSPECTOR_FIELD_POSITION_X:
+        case INSPECTOR_FIELD_POSITION_Y: {
+            if (!(components & COMPONENT_POSITION)) return;
+            // a teleport, not a move, nothing sweeps the way from the old position
+            bool is_x = edit->field == INSPECTOR_FIELD_POSITION_X;
+            i32 *position = is_x ? world->positions.x : world->positions.y;
+            i32 *prev_position = is_x ? world->positions.prev_x : world->positions.prev_y;
+            position[entity] = value;
+            prev_position[entity] = value;
+            if (components & COMPONENT_MOVEMENT) {
+                f32 *remainder = is_x ? world->movements.remainder_x : world->movements.remainder_y;
+                remainder[entity] = 0;
+            }
+        } break;
+        case INSPECTOR_FIELD_VELOCITY_X: {
+            if (!(components & COMPONENT_MOVEMENT)) return;
+            world->movements.vel_x[entity] = value;
+        } break;
+        case INSPECTOR_FIELD_VELOCITY_Y: {
+            if (!(components & COMPONENT_MOVEMENT)) return;
+            world->movements.vel_y[entity] = value;
+        } break;
+        case INSPECTOR_FIELD_OFFSET_X: {
+            if (!has_collider) return;
+            world->colliders.offset_x[entity] = value;
+        } break;
+        case INSPECTOR_FIELD_OFFSET_Y: {
+            if (!has_collider) return;
+            world->colliders.offset_y[entity] = value;
+        } break;
+        case INSPECTOR_FIELD_WIDTH: {
+            if (shape != SHAPE_RECT) return;
+            world->colliders.width[entity] = Max(value, 0);
+        } break;
+        case INSPECTOR_FIELD_HEIGHT: {
+            if (shape != SHAPE_RECT) return;
+            world->colliders.height[entity] = Max(value, 0);
+        } break;
+        case INSPECTOR_FIELD_RADIUS: {
+            // circles keep their bounds at twice the radius, like entity_add_collider_circ()
+            if (shape != SHAPE_CIRC) return;
+            world->colliders.radius[entity] = Max(value, 0);
+            world->colliders.width[entity] = 2 * Max(value, 0);
+            world->colliders.height[entity] = 2 * Max(value, 0);
+        } break;
+        case INSPECTOR_FIELD_MASK: {
+            if (!has_collider) return;
+            world->colliders.mask[entity] = (CollisionMask) value;
+        } break;
+        default: return;
+    }
+
+    // whatever changed, a body resting on the old state has to look again
+    if (components & COMPONENT_MOVEMENT) {
+        entity_wake(entity);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void inspector_init(Inspector *inspector) {
+    *inspector = (Inspector) {0};
+    inspector_reserve(inspector);
+}
+
+void inspector_free(Inspector *inspector) {
+    arrfree(inspector->matches);
+    arrfree(inspector->building);
+    *inspector = (Inspector) {0};
+}
+
+void inspector_draw(Inspector *inspector, const InspectorSnapshot *snapshot, Rectangle bounds) {
+    struct InspectorUi *ui = &inspector->ui;
+    InspectorRequest *request = &ui->request;
+    GuiPanel(bounds, "inspector");
+
+    // the entities were moved to new ids, the simulation has looked up the selection's
+    ui->compaction_passes = snapshot->compaction_passes;
+    if (request->compaction_passes != snapshot->compaction_passes && request->selected == snapshot->requested) {
+        request->selected = snapshot->selected.entity;
+        request->compaction_passes = snapshot->compaction_passes;
+    }
+
+    Rectangle row = {
+        bounds.x + INSPECTOR_PADDING,
+        bounds.y + INSPECTOR_ROW_HEIGHT + INSPECTOR_PADDING,
+        bounds.width - 2 * INSPECTOR_PADDING,
+        INSPECTOR_ROW_HEIGHT
+    };
+    const f32 step = INSPECTOR_ROW_HEIGHT + INSPECTOR_PADDING / 2;
+
+    // filters
+    GuiLabel((Rectangle) {row.x, row.y, INSPECTOR_LABEL_WIDTH, row.height}, "name");
+    Rectangle name_box = {row.x + INSPECTOR_LABEL_WIDTH, row.y, row.width - INSPECTOR_LABEL_WIDTH, row.height};
+    if (GuiTextBox(name_box, ui->name_text, INSPECTOR_NAME_FILTER_LEN, ui->name_editing)) {
+        ui->name_editing = !ui->name_editing;
+    }
+    memset(request->filter.name, 0, INSPECTOR_NAME_FILTER_LEN);
+    strncpy(request->filter.name, ui->name_text, INSPECTOR_NAME_FILTER_LEN - 1);
+    row.y += step;
+
+    inspector_draw_flags(row, "has", INSPECTOR_COMPONENT_NAMES, ArrayCount(INSPECTOR_COMPONENT_NAMES), &request->filter.components);
+    row.y += step;
+    inspector_draw_flags(row, "collides", INSPECTOR_COLLISION_NAMES, ArrayCount(INSPECTOR_COLLISION_NAMES), &request->filter.collision);
+    row.y += step;
+
+    GuiLabel(row, TextFormat("%u entities%s", snapshot->num_matches, snapshot->scanning ? ", still scanning" : ""));
+    row.y += step;
+
+    // the list, only the rows inside the scroll panel's view are ever asked for or drawn
+    f32 details_height = INSPECTOR_DETAIL_ROWS * step;
+    Rectangle list = {row.x, row.y, row.width, bounds.y + bounds.height - INSPECTOR_PADDING - details_height - row.y};
+    Rectangle content = {0, 0, list.width - GuiGetStyle(LISTVIEW, SCROLLBAR_WIDTH) - 2, snapshot->num_matches * INSPECTOR_ROW_HEIGHT};
+    Rectangle view = {0};
+    GuiScrollPanel(list, NULL, content, &ui->scroll, &view);
+
+    request->first_row = (u32) Max(-ui->scroll.y / INSPECTOR_ROW_HEIGHT, 0);
+    request->num_rows = Min((u32) (view.height / INSPECTOR_ROW_HEIGHT) + 2, INSPECTOR_MAX_ROWS);
+
+    // the rows are from the request a tick or two ago, each is drawn where it belongs now
+    Vector2 mouse = GetMousePosition();
+    bool clicked = IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mouse, view);
+    BeginScissorMode(view.x, view.y, view.width, view.height);
+    for (u32 r = 0; r < snapshot->num_rows; r++) {
+        const InspectorRow *entry = &snapshot->rows[r];
+        f32 y = view.y + ui->scroll.y + (snapshot->first_row + r) * INSPECTOR_ROW_HEIGHT;
+        if (y + INSPECTOR_ROW_HEIGHT < view.y || y > view.y + view.height) continue;
+
+        Rectangle entry_bounds = {view.x, y, view.width, INSPECTOR_ROW_HEIGHT};
+        if (clicked && CheckCollisionPointRec(mouse, entry_bounds) && request->selected != entry->entity) {
+            request->selected = entry->entity;
+            request->compaction_passes = snapshot->compaction_passes;
+            memset(ui->editing, 0, sizeof(ui->editing));
+        }
+        inspector_draw_row(entry, entry_bounds, entry->entity == request->selected);
+    }
+    EndScissorMode();
+
+    // the selected entity, once the simulation has caught up with the selection
+    row.y = list.y + list.height + INSPECTOR_PADDING;
+    if (snapshot->selected.entity == request->selected) {
+        inspector_draw_details(inspector, &snapshot->selected, row);
+    }
+
+    inspector_write_request(inspector, request);
+}
+
+bool inspector_wants_keyboard(const Inspector *inspector) {
+    if (inspector->ui.name_editing) return true;
+    for (u32 i = 0; i < INSPECTOR_FIELD_COUNT; i++) {
+        if (inspector->ui.editing[i]) return true;
+    }
+    return false;
+}
+
+void inspector_apply_edits(Inspector *inspector) {
+    InspectorEditRing *ring = &inspector->edits;
+    u32 tail = ring->tail;
+    u32 head = ins_atomic_u32_eval(&ring->head);
+    for (; tail != head; tail++) {
+        inspector_apply_edit(&ring->items[tail % INSPECTOR_EDITS_MAX]);
+    }
+    ins_atomic_u32_eval_assign(&ring->tail, tail);
+}
+
+void inspector_publish(Inspector *inspector, InspectorSnapshot *snapshot) {
+    InspectorRequest request = inspector_read_request(inspector);
+
+    // a new filter starts over, nothing from the old one is shown
+    if (memcmp(&request.filter, &inspector->scan_filter, sizeof(InspectorFilter)) != 0) {
+        inspector->scan_filter = request.filter;
+        arrsetlen(inspector->matches, 0);
+        arrsetlen(inspector->building, 0);
+        inspector->scan_cursor = 0;
+        inspector->scanned_once = false;
+    }
+
+    // without a filter row i is simply entity i + 1, skipping ENTITY_NONE
+    bool filtered = !inspector_filter_empty(&inspector->scan_filter);
+    const Entity *list = NULL;
+    if (filtered) {
+        inspector_scan(inspector);
+        list = inspector->scanned_once ? inspector->matches : inspector->building;
+        snapshot->num_matches = arrlen(list);
+        snapshot->scanning = !inspector->scanned_once;
+    } else {
+        snapshot->num_matches = (world->num_entities > 0) ? world->num_entities - 1 : 0;
+        snapshot->scanning = false;
+    }
+
+    snapshot->first_row = Min(request.first_row, snapshot->num_matches);
+    snapshot->num_rows = Min(Min(request.num_rows, (u32) INSPECTOR_MAX_ROWS), snapshot->num_matches - snapshot->first_row);
+    for (u32 r = 0; r < snapshot->num_rows; r++) {
+        u32 index = snapshot->first_row + r;
+        inspector_fill_row(&snapshot->rows[r], filtered ? list[index] : index + 1);
+    }
+
+    snapshot->requested = request.selected;
+    snapshot->compaction_passes = world->compaction.passes;
+    inspector_fill_selected(&snapshot->selected, inspector_current_entity(request.selected, request.compaction_passes));
+}
+
+void inspector_remap(Inspector *inspector) {
+    // the finished pass keeps showing, in entity order like a fresh one would be
+    u32 num_kept = 0;
+    for (u32 i = 0; i < arrlen(inspector->matches); i++) {
+        Entity entity = world_remap_entity(inspector->matches[i]);
+        if (entity != ENTITY_NONE) inspector->matches[num_kept++] = entity;
+    }
+    arrsetlen(inspector->matches, num_kept);
+    qsort(inspector->matches, num_kept, sizeof(Entity), inspector_compare_entities);
+
+    // the one in progress covered a range of the old ids, which is scattered over the new ones
+    arrsetlen(inspector->building, 0);
+    inspector->scan_cursor = 0;
+}
@@ -1,15 +1,18 @@
 #include "game.h"
 
+#include <stdlib.h>
+
 #include "raygui.h"
 #include "dark/style_dark.h"
+#include "rlgl.h"
 
 // ----------------------------------------------------------------------------
 // Global data
 
-internal const Vector2 GRAVITY = {0, -50.0f};
+internal World game_world = {0};
 
 Assets assets = {0};
-World world = {0};
+ParticleSystem particles = {0};
 State state = {
     .window = {
         .target_fps = 60,
@@ -23,16 +26,349 @@ State state = {
         .manual_frame_step = false,
     },
     .current_screen = TITLE,
+    .resolution = {
+        .dynamic = true,
+        .min_scale = 0.5f,
+        .max_scale = 1.0f,
+        .scale = 1.0f,
+    },
 };
 
+internal void EmitHitSparks(Entity entity, Axis axis) {
+    // sparks fly from the edge of the ball that hit, which is the side it's moving towards
+    RenderSpark spark = {
+        .x = world->positions.x[entity] + world->colliders.offset_x[entity],
+        .y = world->positions.y[entity] + world->colliders.offset_y[entity],
+    };
+    f32 radius = world->colliders.radius[entity];
+    if (axis == AXIS_X) spark.x += calc_sign(world->movements.vel_x[entity]) * radius;
+    else                spark.y += calc_sign(world->movements.vel_y[entity]) * radius;
+
+    // the particles live on the render thread, hand the burst over
+    render_sparks_push(&state.sparks, spark);
+}
+
 internal void BallHitX2(Entity entity, Entity collided_with) {
-    world.movements.vel_x[entity] *= -1;
-    world.movements.remainder_x[entity] = 0;
+    EmitHitSparks(entity, AXIS_X);
+    world->movements.vel_x[entity] *= -1;
+    world->movements.remainder_x[entity] = 0;
 }
 
 internal void BallHitY2(Entity entity, Entity collided_with) {
-    world.movements.vel_y[entity] *= -1;
-    world.movements.remainder_y[entity] = 0;
+    EmitHitSparks(entity, AXIS_Y);
+    world->movements.vel_y[entity] *= -1;
+    world->movements.remainder_y[entity] = 0;
+}
+
+// world space rectangle covered by the camera, the bounding box of the viewport's corners
+internal Rectangle GetCameraView(Camera2D camera, f32 viewport_width, f32 viewport_height) {
+    Vector2 corners[4] = {
+        GetScreenToWorld2D((Vector2) {0, 0}, camera),
+        GetScreenToWorld2D((Vector2) {viewport_width, 0}, camera),
+        GetScreenToWorld2D((Vector2) {0, viewport_height}, camera),
+        GetScreenToWorld2D((Vector2) {viewport_width, viewport_height}, camera),
+    };
+
+    Vector2 min = corners[0];
+    Vector2 max = corners[0];
+    for (i32 i = 1; i < 4; i++) {
+        min.x = calc_min(min.x, corners[i].x);
+        min.y = calc_min(min.y, corners[i].y);
+        max.x = calc_max(max.x, corners[i].x);
+        max.y = calc_max(max.y, corners[i].y);
+    }
+    return (Rectangle) {min.x, min.y, max.x - min.x, max.y - min.y};
+}
+
+internal const f32 SIM_TICKS_PER_SEC = 60;
+// the tick's system graph is only a few systems wide, more workers would just sit idle
+internal const u32 SIM_MAX_WORKERS = 4;
+
+// every 10 seconds, starting with the first tick
+internal const u32 COMPACT_INTERVAL_TICKS = 600;
+
+// rows exported per telemetry frame, about 2.4 MB of shared memory per frame at this size
+internal const u32 TELEMETRY_MAX_ENTITIES = 65536;
+
+// dynamic resolution, see UpdateResolution(). late means a smoothed frame time past the budget by this factor,
+// and one step of the scale is 5% of the window along each axis
+internal const f32 RESOLUTION_SCALE_FLOOR = 0.25f;
+internal const f32 RESOLUTION_SMOOTHING = 0.1f;
+internal const f32 RESOLUTION_LATE = 1.1f;
+internal const f32 RESOLUTION_SAMPLE_LIMIT = 4.0f;
+internal const f32 RESOLUTION_STEP = 0.05f;
+internal const u32 RESOLUTION_GROW_FRAMES = 120;
+internal const u32 RESOLUTION_GROW_FRAMES_MAX = 3600;
+
+// long enough for the arrays the first frames size once to have done so, the per tick contact
+// and pair arrays don't depend on it as they're reserved from the collider count every tick,
+// see narrow_phase_begin() and contact_solver_begin()
+internal const u32 ALLOCATION_WARMUP_FRAMES = 120;
+
+// close out the last frame's allocation counts, and once gameplay has been running
+// for a while treat any further allocation as a bug, see mem.h
+internal void TrackAllocations() {
+    local_persist u32 gameplay_frames = 0;
+
+    MemFrameStats allocations = mem_end_frame();
+    perf_push(&state.perf, PERF_ALLOCATIONS, allocations.total_calls);
+
+    if (state.current_screen == GAMEPLAY) {
+        gameplay_frames++;
+    } else {
+        gameplay_frames = 0;
+    }
+    mem_set_steady_state(gameplay_frames > ALLOCATION_WARMUP_FRAMES);
+}
+
+// hand the toggles the simulation follows over to it, runs on the main thread
+internal void PublishSimControl() {
+    SimControl control = 0;
+    if (state.current_screen == GAMEPLAY)  control |= SIM_CONTROL_GAMEPLAY;
+    if (state.debug.manual_frame_step)     control |= SIM_CONTROL_MANUAL_FRAME_STEP;
+    if (state.debug.log)                   control |= SIM_CONTROL_LOG;
+    if (state.debug.telemetry)             control |= SIM_CONTROL_TELEMETRY;
+    if (state.debug.ai_paddle)             control |= SIM_CONTROL_AI_PADDLE;
+    if (state.debug.inspector)             control |= SIM_CONTROL_INSPECTOR;
+    if (state.debug.compact_entities)      control |= SIM_CONTROL_COMPACT_ENTITIES;
+    ins_atomic_u32_eval_assign(&state.sim.published_control, control);
+}
+
+// copy everything the renderer needs out of the world, culled against the camera
+// tilemaps go out as one rect per solid cell, only the cells inside the view
+internal void PublishTilemapCells(RenderSnapshot *snapshot, Entity entity, Rectangle view) {
+    Tilemap *tilemap = &world->colliders.tilemaps[entity];
+    const i32 cell_size = tilemap->cell_size;
+    const i32 map_x = world->positions.x[entity] + world->colliders.offset_x[entity];
+    const i32 map_y = world->positions.y[entity] + world->colliders.offset_y[entity];
+
+    i32 col0 = floorf((view.x - map_x) / cell_size);
+    i32 col1 = floorf((view.x + view.width - map_x) / cell_size);
+    i32 row0 = floorf((view.y - map_y) / cell_size);
+    i32 row1 = floorf((view.y + view.height - map_y) / cell_size);
+
+    for (i32 row = row0; row <= row1; row++) {
+        for (i32 span_col = col0; span_col <= col1; span_col += 64) {
+            u64 span = tilemap_row_span(tilemap, row, span_col, col1);
+            while (span != 0) {
+                i32 col = span_col + ctz64(span);
+                span &= span - 1;
+
+                RenderShape shape = {
+                    .entity = entity,
+                    .shape = SHAPE_RECT,
+                    .x = map_x + col * cell_size,
+                    .y = map_y + row * cell_size,
+                    .width = cell_size,
+                    .height = cell_size,
+                    .has_sprite = true,
+                    .color_a = GRAY,
+                    .color_b = DARKGRAY,
+                };
+                arrput(snapshot->shapes, shape);
+            }
+        }
+    }
+}
+
+internal void PublishSnapshot() {
+    MemTag prev_tag = mem_set_tag(MEM_TAG_RENDER);
+    RenderSnapshot *snapshot = snapshot_begin_write(&state.snapshots);
+    snapshot->tick = state.sim.tick;
+    snapshot->camera = state.camera;
+
+    Rectangle view = GetCameraView(state.camera, state.window.width, state.window.height);
+    arrsetlen(state.visible_entities, 0);
+    world_query_visible(view, &state.visible_entities);
+
+    for (u32 v = 0; v < arrlen(state.visible_entities); v++) {
+        Entity i = state.visible_entities[v];
+        if (!entity_has_components(i, COMPONENT_COLLIDER)) continue;
+        if (world->colliders.shape[i] == SHAPE_TILEMAP) {
+            PublishTilemapCells(snapshot, i, view);
+            continue;
+        }
+
+        RenderShape shape = {
+            .entity = i,
+            .shape  = world->colliders.shape[i],
+            .x      = world->positions.x[i] + world->colliders.offset_x[i],
+            .y      = world->positions.y[i] + world->colliders.offset_y[i],
+            .width  = world->colliders.width[i],
+            .height = world->colliders.height[i],
+            .radius = world->colliders.radius[i],
+        };
+        if (i == state.arena.ball) {
+            shape.has_sprite = true;
+            shape.emits_trail = true;
+            shape.color_a = BLUE;
+            shape.color_b = YELLOW;
+        } else if (i == state.arena.paddle) {
+            shape.has_sprite = true;
+            shape.color_a = RED;
+            shape.color_b = GREEN;
+        }
+        arrput(snapshot->shapes, shape);
+    }
+
+    if (state.sim.control & SIM_CONTROL_INSPECTOR) {
+        inspector_publish(&state.inspector, &snapshot->inspector);
+    }
+
+    snapshot_publish(&state.snapshots);
+    mem_set_tag(prev_tag);
+}
+
+// follows the debug toggle, the segment only exists while telemetry is switched on.
+// the toggle belongs to the main thread, a failed start is remembered here instead
+internal void PublishTelemetry() {
+    TelemetryWriter *telemetry = &state.sim.telemetry;
+    bool enabled = state.sim.control & SIM_CONTROL_TELEMETRY;
+    if (!enabled) {
+        state.sim.telemetry_failed = false;
+        if (telemetry->header) telemetry_stop(telemetry);
+        return;
+    }
+    if (!telemetry->header) {
+        if (state.sim.telemetry_failed) return;
+        if (!telemetry_start(telemetry, TELEMETRY_MAX_ENTITIES)) {
+            state.sim.telemetry_failed = true;
+            return;
+        }
+    }
+    telemetry_publish(telemetry, state.sim.tick);
+}
+
+internal void PushSimStats(f64 tick_seconds) {
+    perf_push(&state.perf, PERF_SIM_TICK, tick_seconds);
+    perf_push(&state.perf, PERF_SIM_MOVE, world->stats.move_seconds);
+    perf_push(&state.perf, PERF_SIM_OVERLAP, world->stats.overlap_seconds);
+    perf_push(&state.perf, PERF_SIM_EVENTS, world->stats.dispatch_seconds);
+    perf_push(&state.perf, PERF_COLLISION_CHECKS, world->stats.collision_checks);
+
+    u32 num_colliders = 0;
+    for (u32 i = 0; i < world->num_entities; i++) {
+        if (entity_has_components(i, COMPONENT_COLLIDER)) num_colliders++;
+    }
+    ins_atomic_u32_eval_assign(&state.perf.num_entities, world->num_entities);
+    ins_atomic_u32_eval_assign(&state.perf.num_colliders, num_colliders);
+}
+
+// ----------------------------------------------------------------------------
+// Simulation systems, run by state.sim.scheduler once per tick, see UpdateGameplay()
+
+internal void SystemInspectorEdits(void *data, u32 worker) {
+    inspector_apply_edits(&state.inspector);
+}
+
+internal void SystemPaddleInput(void *data, u32 worker) {
+    const InputSample *input = &state.sim.input;
+    bool move_left = input->active[INPUT_ACTION_MOVE_LEFT];
+    bool move_right = input->active[INPUT_ACTION_MOVE_RIGHT];
+    if (state.sim.control & SIM_CONTROL_AI_PADDLE) {
+        arena_ai_paddle(&state.arena, 1.0f / SIM_TICKS_PER_SEC, &move_left, &move_right);
+    }
+    arena_update_paddle(&state.arena, move_left, move_right, 1.0f / SIM_TICKS_PER_SEC);
+}
+
+internal void SystemPhysics(void *data, u32 worker) {
+    if (state.sim.control & SIM_CONTROL_LOG) {
+        world_log();
+    }
+    world_update(1.0f / SIM_TICKS_PER_SEC);
+    state.sim.tick++;
+}
+
+// entity ids change, so everything here holding on to one is remapped right away
+internal void SystemCompaction(void *data, u32 worker) {
+    // sized whether or not compaction is on, so turning it on mid game doesn't allocate in the
+    // steady state, see TrackAllocations()
+    world_reserve_compaction();
+    if (!(state.sim.control & SIM_CONTROL_COMPACT_ENTITIES) || state.sim.tick % COMPACT_INTERVAL_TICKS != 1) return;
+
+    if (world_compact_entities()) {
+        arena_remap(&state.arena);
+        inspector_remap(&state.inspector);
+    }
+}
+
+internal void SystemTelemetry(void *data, u32 worker) {
+    PublishTelemetry();
+}
+
+internal void SystemSnapshot(void *data, u32 worker) {
+    PublishSnapshot();
+}
+
+// the snapshot and telemetry exports only read the world, so they run side by side once physics is done
+internal void InitSimSystems() {
+    Scheduler *scheduler = &state.sim.scheduler;
+    ComponentId spatial[] = {COMPONENT_ID_POSITION, COMPONENT_ID_MOVEMENT, COMPONENT_ID_COLLIDER};
+    // the snapshot also copies names for the inspector's rows
+    ComponentId inspected[] = {COMPONENT_ID_NAME, COMPONENT_ID_POSITION, COMPONENT_ID_MOVEMENT, COMPONENT_ID_COLLIDER};
+
+    scheduler_add(scheduler, (System) {
+        .name = "inspector edits",
+        .run = SystemInspectorEdits,
+        .writes = signature_of(ArrayCount(spatial), spatial),
+    });
+    scheduler_add(scheduler, (System) {
+        .name = "paddle input",
+        .run = SystemPaddleInput,
+        // the CPU player looks at where everything is
+        .reads = signature_of(2, (ComponentId[]) {COMPONENT_ID_POSITION, COMPONENT_ID_COLLIDER}),
+        .writes = signature_of(1, (ComponentId[]) {COMPONENT_ID_MOVEMENT}),
+    });
+    // moves, collides and applies deferred commands, which can touch any entity
+    scheduler_add(scheduler, (System) {
+        .name = "physics",
+        .run = SystemPhysics,
+        .exclusive = true,
+    });
+    // moves entities to new ids
+    scheduler_add(scheduler, (System) {
+        .name = "compaction",
+        .run = SystemCompaction,
+        .exclusive = true,
+    });
+    scheduler_add(scheduler, (System) {
+        .name = "telemetry",
+        .run = SystemTelemetry,
+        .reads = signature_of(ArrayCount(spatial), spatial),
+    });
+    scheduler_add(scheduler, (System) {
+        .name = "snapshot",
+        .run = SystemSnapshot,
+        .reads = signature_of(ArrayCount(inspected), inspected),
+    });
+}
+
+internal void SimThreadMain(void *data) {
+    // from here on the game world belongs to this thread
+    world = &game_world;
+
+    const f64 tick_duration = 1.0 / SIM_TICKS_PER_SEC;
+    f64 next_tick = os_now_seconds();
+    while (ins_atomic_u32_eval(&state.sim.running)) {
+        f64 now = os_now_seconds();
+        if (now < next_tick) {
+            os_sleep_seconds(next_tick - now);
+            continue;
+        }
+
+        // after a long stall (debugger, window drag) don't try to catch up on every missed tick
+        if (now - next_tick > 0.25) {
+            next_tick = now;
+        }
+        f64 tick_time = next_tick;
+        next_tick += tick_duration;
+
+        // one load per tick, every system of the tick sees the same toggles
+        state.sim.control = ins_atomic_u32_eval(&state.sim.published_control);
+        if (state.sim.control & SIM_CONTROL_GAMEPLAY) {
+            UpdateGameplay(tick_time);
+        }
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -43,6 +379,7 @@ int main() {
     while (!state.input_frame.exit_requested) {
         Update();
         DrawFrame();
+        WaitForNextFrame();
     }
     Shutdown();
     return 0;
@@ -55,7 +392,8 @@ internal void Init() {
     // init raylib
     SetConfigFlags(FLAG_MSAA_4X_HINT | FLAG_VSYNC_HINT);
     InitWindow(state.window.width, state.window.height, state.window.title);
-    SetTargetFPS(state.window.target_fps);
+    // frames are paced by WaitForNextFrame() instead, raylib's limiter would sleep through input
+    SetTargetFPS(0);
     SetExitKey(KEY_NULL); // unbind ESC to exit
 
     // init raygui
@@ -64,8 +402,32 @@ internal void Init() {
     // init assets
     LoadAssets();
 
+    // the telemetry toggle can also be flipped on from the start, for tools attached before the first frame
+    const char *telemetry = getenv("PRONG_TELEMETRY");
+    state.debug.telemetry = telemetry && telemetry[0] && strcmp(telemetry, "0") != 0;
+    // same for the CPU player, for unattended soak runs
+    const char *ai_paddle = getenv("PRONG_AI_PADDLE");
+    state.debug.ai_paddle = ai_paddle && ai_paddle[0] && strcmp(ai_paddle, "0") != 0;
+    // and the periodic entity compaction
+    const char *compact_entities = getenv("PRONG_COMPACT_ENTITIES");
+    state.debug.compact_entities = compact_entities && compact_entities[0] && strcmp(compact_entities, "0") != 0;
+    // bounds of the render scale, a fraction of the window size along each axis. the texture is
+    // only ever as big as the window, so the scale can't go past 1
+    const char *dynamic_resolution = getenv("PRONG_DYNAMIC_RESOLUTION");
+    if (dynamic_resolution) state.resolution.dynamic = dynamic_resolution[0] && strcmp(dynamic_resolution, "0") != 0;
+    const char *resolution_min = getenv("PRONG_RESOLUTION_MIN");
+    const char *resolution_max = getenv("PRONG_RESOLUTION_MAX");
+    if (resolution_min) state.resolution.min_scale = Clamp(RESOLUTION_SCALE_FLOOR, (f32) atof(resolution_min), 1.0f);
+    if (resolution_max) state.resolution.max_scale = Clamp(RESOLUTION_SCALE_FLOOR, (f32) atof(resolution_max), 1.0f);
+    state.resolution.min_scale = Min(state.resolution.min_scale, state.resolution.max_scale);
+    state.resolution.scale = state.resolution.max_scale;
+    state.resolution.grow_frames = RESOLUTION_GROW_FRAMES;
+
     // init game data
     state.render_texture = LoadRenderTexture(state.window.width, state.window.height);
+    // the gameplay frame is usually stretched over the window, smooth it out rather than showing blocky texels
+    SetTextureFilter(state.render_texture.texture, TEXTURE_FILTER_BILINEAR);
+    particles_init(&particles, PARTICLES_MAX);
 
     Vector2 window_center = {state.window.width / 2, state.window.height / 2};
     state.camera = (Camera2D){
@@ -75,45 +437,28 @@ internal void Init() {
         .zoom = 1.0f
     };
 
+    world = &game_world;
     world_init();
-
-    f32 ball_radius = 25;
-    Vector2 ball_pos = {0, 100};
-    Vector2 ball_vel = {-100, -200};
-    Vector2 paddle_size = {200, 50};
-    Vector2 paddle_center = {0, (-state.window.height + paddle_size.y) / 2};
-
-    state.ball = world_create_entity();
-    entity_add_name(state.ball, (NameStr) {"ball"});
-    entity_add_position(state.ball, ball_pos.x, ball_pos.y);
-    entity_add_velocity(state.ball, ball_vel.x, ball_vel.y, 0, GRAVITY.y);
-    entity_add_collider_circ(state.ball, MASK_BALL, 0, 0, ball_radius);
-    world.colliders.on_hit_x[state.ball] = BallHitX2;
-    world.colliders.on_hit_y[state.ball] = BallHitY2;
-
-    state.paddle = world_create_entity();
-    entity_add_name(state.paddle, (NameStr) {"paddle"});
-    entity_add_position(state.paddle, paddle_center.x, paddle_center.y);
-    entity_add_velocity(state.paddle, 0, 0, 0.75f, 0);
-    entity_add_collider_rect(state.paddle, MASK_PADDLE, paddle_size.x / 2, paddle_size.y / 2, paddle_size.x, paddle_size.y);
-
-    // setup arena bounds
-    state.bounds_l = world_create_entity(); entity_add_name(state.bounds_l, (NameStr) {"bounds_l"});
-    state.bounds_r = world_create_entity(); entity_add_name(state.bounds_r, (NameStr) {"bounds_r"});
-    state.bounds_t = world_create_entity(); entity_add_name(state.bounds_t, (NameStr) {"bounds_t"});
-    state.bounds_b = world_create_entity(); entity_add_name(state.bounds_b, (NameStr) {"bounds_b"});
-
-    i32 size = 10;
-    Rectangle interior = (Rectangle) {-window_center.x, -window_center.y, state.window.width, state.window.height};
-    entity_add_position(state.bounds_l, interior.x                  - size / 2, interior.y + interior.height / 2);
-    entity_add_position(state.bounds_r, interior.x + interior.width + size / 2, interior.y + interior.height / 2);
-    entity_add_position(state.bounds_t, interior.x + interior.width / 2,        interior.y + interior.height + size / 2);
-    entity_add_position(state.bounds_b, interior.x + interior.width / 2,        interior.y                   - size / 2);
-
-    entity_add_collider_rect(state.bounds_l, MASK_BOUNDS, -size / 2, -interior.height / 2, size, interior.height);
-    entity_add_collider_rect(state.bounds_r, MASK_BOUNDS, -size / 2, -interior.height / 2, size, interior.height);
-    entity_add_collider_rect(state.bounds_t, MASK_BOUNDS, -interior.width / 2, -size / 2, interior.width, size);
-    entity_add_collider_rect(state.bounds_b, MASK_BOUNDS, -interior.width / 2, -size / 2, interior.width, size);
+    world->collect_stats = true;
+    world->spatial_queries = true;
+
+    arena_create(&state.arena, state.window.width, state.window.height);
+    world->colliders.on_hit_x[state.arena.ball] = BallHitX2;
+    world->colliders.on_hit_y[state.arena.ball] = BallHitY2;
+    inspector_init(&state.inspector);
+
+    // give the renderer something to draw before the first tick, then hand the world over
+    snapshot_buffer_init(&state.snapshots);
+    world_build_spatial_index();
+    PublishSnapshot();
+
+    // the simulation thread is the only one handing work to the pool
+    jobs_init(Min(os_cpu_count(), SIM_MAX_WORKERS));
+    InitSimSystems();
+
+    PublishSimControl();
+    state.sim.running = 1;
+    state.sim.thread = os_thread_create(SimThreadMain, NULL);
 }
 
 internal void Update() {
@@ -127,7 +472,7 @@ internal void Update() {
             break;
         }
         case GAMEPLAY: {
-            UpdateGameplay();
+            UpdateInput();
             break;
         }
         case CREDITS: {
@@ -138,71 +483,139 @@ internal void Update() {
             break;
         }
     }
+    PublishSimControl();
 }
 
-internal void UpdateGameplay() {
-    const f32 dt = GetFrameTime();
-
-    // collect input
+internal void UpdateInput() {
+    // presses were collected by every poll since the last frame, see input_poll()
+    InputPoller *input = &state.input;
     state.input_frame = (struct InputFrame){
-            .exit_requested = WindowShouldClose() || IsKeyPressed(KEY_ESCAPE),
-            .move_left  = IsKeyDown(KEY_LEFT)  || IsKeyDown(KEY_A),
-            .move_right = IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D),
-            .step_frame = IsKeyPressed(KEY_SPACE),
+            .exit_requested = WindowShouldClose() || input_key_pressed(input, KEY_ESCAPE),
+            .move_left  = input->action_down[INPUT_ACTION_MOVE_LEFT],
+            .move_right = input->action_down[INPUT_ACTION_MOVE_RIGHT],
+            .step_frame = input_key_pressed(input, KEY_SPACE),
     };
 
-    // toggle debug flags if needed
-    if (IsKeyPressed(KEY_ONE))   state.debug.manual_frame_step = !state.debug.manual_frame_step;
-    if (IsKeyPressed(KEY_TWO))   state.debug.draw_colliders    = !state.debug.draw_colliders;
-    if (IsKeyPressed(KEY_THREE)) state.debug.log               = !state.debug.log;
+    // toggle debug flags if needed, unless the keys are being typed into the inspector
+    if (!inspector_wants_keyboard(&state.inspector)) {
+        if (input_key_pressed(input, KEY_ONE))   state.debug.manual_frame_step = !state.debug.manual_frame_step;
+        if (input_key_pressed(input, KEY_TWO))   state.debug.draw_colliders    = !state.debug.draw_colliders;
+        if (input_key_pressed(input, KEY_THREE)) state.debug.log               = !state.debug.log;
+        if (input_key_pressed(input, KEY_FOUR))  state.debug.perf_overlay      = !state.debug.perf_overlay;
+        if (input_key_pressed(input, KEY_FIVE))  state.debug.telemetry         = !state.debug.telemetry;
+        if (input_key_pressed(input, KEY_SIX))   state.debug.ai_paddle         = !state.debug.ai_paddle;
+        if (input_key_pressed(input, KEY_SEVEN)) state.debug.inspector         = !state.debug.inspector;
+        if (input_key_pressed(input, KEY_EIGHT)) state.debug.compact_entities  = !state.debug.compact_entities;
+        if (input_key_pressed(input, KEY_NINE))  state.resolution.dynamic      = !state.resolution.dynamic;
+    }
+
+    // start or stop recording, F9 for a png sequence and F10 for raw video
+    if (input_key_pressed(input, KEY_F9) || input_key_pressed(input, KEY_F10)) {
+        CaptureMode mode = input_key_pressed(input, KEY_F9) ? CAPTURE_PNG : CAPTURE_RAW_VIDEO;
+        if (state.capture.mode == mode) {
+            capture_stop(&state.capture);
+        } else {
+            Texture2D texture = state.render_texture.texture;
+            capture_start(&state.capture, mode, texture.width, texture.height, "capture");
+        }
+    }
+
+    // the simulation gets its input from the event ring, not from here
+    input_end_frame(input);
+}
+
+// one fixed tick of the simulation, runs on the simulation thread
+internal void UpdateGameplay(f64 tick_time) {
+    // sampled as late as possible, every event up to this tick's time applies to it,
+    // drained even while paused so a step press doesn't wait behind a stale ring
+    InputSample *input = &state.sim.input;
+    input_sample(&state.sim.input_events, input, tick_time);
+    bool step_requested = input->presses[INPUT_ACTION_STEP_FRAME] > 0;
 
     // if manual frame stepping is enabled, only update if the user has requested it
-    if (state.debug.manual_frame_step && !state.input_frame.step_frame) {
+    if ((state.sim.control & SIM_CONTROL_MANUAL_FRAME_STEP) && !step_requested) {
         return;
     }
 
+    f64 tick_start = os_now_seconds();
+
     // update camera
     state.camera.target = (Vector2){0, 0};
     state.camera.offset = (Vector2){state.window.width / 2, state.window.height / 2};
     state.camera.rotation = 0.0f;
     state.camera.zoom = 1.0f;
 
-    // process paddle movement input
-    if (state.input_frame.move_left || state.input_frame.move_right) {
-        const f32 speed_max = 2000;
-        const f32 speed_impulse = 500;
-        const i32 sign = state.input_frame.move_left ? -1 : state.input_frame.move_right ? 1 : 0;
+    // input, physics and the exports, in whatever order their column accesses allow
+    scheduler_run(&state.sim.scheduler);
+    PushSimStats(os_now_seconds() - tick_start);
+}
 
-        // if the paddle is moving in the opposite direction, stop it
-        bool switch_direction = sign != calc_sign(world.movements.vel_x[state.paddle]);
-        if (switch_direction) {
-            world.movements.vel_x[state.paddle] = 0;
-        }
+// pick this frame's render scale from the frame times so far, runs on the main thread.
+// the frame loop sleeps off whatever time is left, so the headroom can't be measured directly:
+// the scale drops as soon as frames run late and only creeps back up after a stretch on target,
+// waiting twice as long after every step up that had to be taken back
+internal void UpdateResolution(f32 frame_seconds) {
+    struct Resolution *resolution = &state.resolution;
+    const f32 budget = 1.0f / Max(state.window.target_fps, 1);
+
+    // recordings keep the size they were started with, and the other screens draw raygui widgets
+    // that are hit tested in window coordinates
+    if (state.capture.mode != CAPTURE_OFF || state.current_screen != GAMEPLAY) {
+        resolution->scale = 1.0f;
+        resolution->frame_seconds = budget;
+        resolution->frames_on_target = 0;
+        return;
+    }
+    if (!resolution->dynamic) {
+        resolution->scale = resolution->max_scale;
+        resolution->frame_seconds = budget;
+        return;
+    }
 
-        // move the paddle based on user input, with an extra boost if we just switched direction
-        const f32 speed_boost = switch_direction ? 50 : 1;
-        world.movements.vel_x[state.paddle] += sign * speed_boost * speed_impulse * dt;
+    // a single hitch (a window drag, a slow swap) shouldn't throw away half the pixels
+    frame_seconds = Min(frame_seconds, budget * RESOLUTION_SAMPLE_LIMIT);
+    resolution->frame_seconds += (frame_seconds - resolution->frame_seconds) * RESOLUTION_SMOOTHING;
 
-        // constrain the paddle's max speed
-        if (calc_abs(world.movements.vel_x[state.paddle]) > speed_max) {
-            world.movements.vel_x[state.paddle] = calc_approach(world.movements.vel_x[state.paddle], sign * speed_max, 2000 * dt);
+    if (resolution->frame_seconds > budget * RESOLUTION_LATE) {
+        if (resolution->scale > resolution->min_scale) {
+            // fill cost goes with the pixel count, the square of the scale
+            f32 fit = resolution->scale * sqrtf(budget / resolution->frame_seconds);
+            if (resolution->stepped_up) {
+                resolution->grow_frames = Min(resolution->grow_frames * 2, RESOLUTION_GROW_FRAMES_MAX);
+            }
+            resolution->scale = Max(Min(fit, resolution->scale - RESOLUTION_STEP), resolution->min_scale);
+            resolution->stepped_up = false;
+            // the new size gets a fresh measurement, not the average of the old one
+            resolution->frame_seconds = budget;
         }
-    } else {
-        // always be slowing when no input
-        world.movements.vel_x[state.paddle] = calc_approach(world.movements.vel_x[state.paddle], 0, 2000 * dt);
-        world.movements.vel_y[state.paddle] = calc_approach(world.movements.vel_y[state.paddle], 0, 2000 * dt);
+        resolution->frames_on_target = 0;
+    } else if (++resolution->frames_on_target >= resolution->grow_frames && resolution->scale < resolution->max_scale) {
+        resolution->scale = Min(resolution->scale + RESOLUTION_STEP, resolution->max_scale);
+        resolution->stepped_up = true;
+        resolution->frames_on_target = 0;
     }
-
-    // update entities
-    world_update(dt);
 }
 
 internal void DrawFrame() {
+    // newest state the simulation has finished, never touches the world itself
+    RenderSnapshot *snapshot = snapshot_acquire(&state.snapshots);
+    perf_push(&state.perf, PERF_FRAME, GetFrameTime());
+    TrackAllocations();
+    UpdateResolution(GetFrameTime());
+
+    // the part of the render texture this frame fills
+    const Texture2D render_texture = state.render_texture.texture;
+    const i32 render_width = Max((i32) roundf(render_texture.width * state.resolution.scale), 1);
+    const i32 render_height = Max((i32) roundf(render_texture.height * state.resolution.scale), 1);
+
     // draw world to render texture
     BeginTextureMode(state.render_texture);
     ClearBackground(DARKGRAY);
+    // everything still draws in window coordinates, the smaller viewport squeezes the whole frame into
+    // the corner of the texture that starts at texel (0, 0), which is the part the upscale below reads
+    rlViewport(0, 0, render_width, render_height);
 
-    BeginMode2D(state.camera);
+    BeginMode2D(snapshot->camera);
     switch (state.current_screen) {
         case TITLE: {
             DrawText("Prong", 10, 10, 40, LIGHTGRAY);
@@ -216,55 +629,54 @@ internal void DrawFrame() {
             };
             if (GuiLabelButton(button_rect, GuiIconText(ICON_PLAYER_PLAY, "Play"))) {
                 state.current_screen = GAMEPLAY;
+                PublishSimControl();
             }
             break;
         }
         case GAMEPLAY: {
-            Texture2D texture;
-            Rectangle texture_rect;
-            const Vector2 origin = {0, 0};
+            // spawn the effects the simulation asked for, then move every particle
+            RenderSpark spark;
+            while (render_sparks_pop(&state.sparks, &spark)) {
+                particles_emit_burst(&particles, spark.x, spark.y, 64, 400, 0.6f, 4, GOLD);
+            }
+            for (u32 i = 0; i < arrlen(snapshot->shapes); i++) {
+                RenderShape *shape = &snapshot->shapes[i];
+                if (shape->emits_trail) {
+                    particles_emit_burst(&particles, shape->x, shape->y, 8, 40, 0.75f, 6, SKYBLUE);
+                }
+            }
+            particles_update(&particles, GetFrameTime());
 
-            i32 pos_x, pos_y, off_x, off_y, width, height, radius;
+            Rectangle view = GetCameraView(snapshot->camera, state.render_texture.texture.width, state.render_texture.texture.height);
+            particles_draw(&particles, view);
 
-            pos_x = world.positions.x[state.ball];
-            pos_y = world.positions.y[state.ball];
-            off_x = world.colliders.offset_x[state.ball];
-            off_y = world.colliders.offset_y[state.ball];
-            radius = world.colliders.radius[state.ball];
-            DrawCircleGradient(pos_x + off_x, pos_y + off_y, radius, BLUE, YELLOW);
+            for (u32 i = 0; i < arrlen(snapshot->shapes); i++) {
+                RenderShape *shape = &snapshot->shapes[i];
+                if (!shape->has_sprite) continue;
 
-            pos_x = world.positions.x[state.paddle];
-            pos_y = world.positions.y[state.paddle];
-            off_x = world.colliders.offset_x[state.paddle];
-            off_y = world.colliders.offset_y[state.paddle];
-            width = world.colliders.width[state.paddle];
-            height = world.colliders.height[state.paddle];
-            DrawRectangleGradientV(pos_x + off_x, pos_y + off_y, width, height, RED, GREEN);
+                switch (shape->shape) {
+                    case SHAPE_CIRC: {
+                        DrawCircleGradient(shape->x, shape->y, shape->radius, shape->color_a, shape->color_b);
+                    } break;
+                    case SHAPE_RECT: {
+                        DrawRectangleGradientV(shape->x, shape->y, shape->width, shape->height, shape->color_a, shape->color_b);
+                    } break;
 
+                    case SHAPE_NONE:
+                    default: break;
+                }
+            }
 
             if (state.debug.draw_colliders) {
                 Color debug_color = MAGENTA;
-                for (u32 i = 0; i < world.num_entities; i++) {
-                    if (i == ENTITY_NONE) continue;
-
-                    bool has_position = entity_has_components(i, COMPONENT_POSITION);
-                    bool has_collider = entity_has_components(i, COMPONENT_COLLIDER);
-                    if (!has_position || !has_collider) continue;
-
-                    pos_x = world.positions.x[i];
-                    pos_y = world.positions.y[i];
-                    off_x = world.colliders.offset_x[i];
-                    off_y = world.colliders.offset_y[i];
-
-                    switch (world.colliders.shape[i]) {
+                for (u32 i = 0; i < arrlen(snapshot->shapes); i++) {
+                    RenderShape *shape = &snapshot->shapes[i];
+                    switch (shape->shape) {
                         case SHAPE_CIRC: {
-                            radius = world.colliders.radius[i];
-                            DrawCircleLines(pos_x + off_x, pos_y + off_y, radius, debug_color);
+                            DrawCircleLines(shape->x, shape->y, shape->radius, debug_color);
                         } break;
                         case SHAPE_RECT: {
-                            width = world.colliders.width[i];
-                            height = world.colliders.height[i];
-                            DrawRectangleLines(pos_x + off_x, pos_y + off_y, width, height, debug_color);
+                            DrawRectangleLines(shape->x, shape->y, shape->width, shape->height, debug_color);
                         } break;
 
                         case SHAPE_NONE:
@@ -282,15 +694,18 @@ internal void DrawFrame() {
     EndMode2D();
     EndTextureMode();
 
+    // TODO - need to sort this out, I think its the UI that is flipped, gamescreen stuff isn't
+    const int flip_y = state.current_screen == GAMEPLAY ? 1 : -1;
+
+    // grab the frame before any screen-only overlays are drawn on top
+    capture_frame(&state.capture, state.render_texture, flip_y < 0);
+
     // draw render texture to screen
     BeginDrawing();
     ClearBackground(BLACK);
-
-    // TODO - need to sort this out, I think its the UI that is flipped, gamescreen stuff isn't
-    const int flip_y = state.current_screen == GAMEPLAY ? 1 : -1;
     DrawTexturePro(
-        state.render_texture.texture,
-        (Rectangle){0, 0, state.render_texture.texture.width, flip_y * state.render_texture.texture.height},
+        render_texture,
+        (Rectangle){0, 0, render_width, flip_y * render_height},
         (Rectangle){0, 0, state.window.width, state.window.height},
         (Vector2){0, 0},
         0.0f,
@@ -298,11 +713,59 @@ internal void DrawFrame() {
     if (state.debug.manual_frame_step) {
         DrawText("frame step enabled", 10, 10, 20, state.input_frame.step_frame ? GREEN : WHITE);
     }
+    if (state.debug.perf_overlay) {
+        perf_draw_overlay(&state.perf, (Vector2) {state.window.width - 390, 10});
+    }
+    if (state.debug.inspector) {
+        inspector_draw(&state.inspector, &snapshot->inspector, (Rectangle) {10, 40, 460, state.window.height - 80});
+    }
+    if (state.capture.mode != CAPTURE_OFF) {
+        const char *mode = state.capture.mode == CAPTURE_PNG ? "png" : "raw";
+        DrawText(TextFormat("REC %s  %llu dropped", mode, (unsigned long long) state.capture.frames_dropped),
+                 10, state.window.height - 30, 20, RED);
+    }
     EndDrawing();
+    input_poll(&state.input, &state.sim.input_events, os_now_seconds());
+}
+
+// pace frames to the target rate, polling input every millisecond in the meantime so key
+// changes reach the simulation long before the next frame would have seen them.
+// only during gameplay without the inspector open, extra polls would eat the mouse clicks raygui buttons look for
+internal void WaitForNextFrame() {
+    local_persist f64 next_frame = 0;
+    const f64 frame_duration = 1.0 / Max(state.window.target_fps, 1);
+
+    f64 now = os_now_seconds();
+    next_frame += frame_duration;
+    if (now - next_frame > 0.25) {
+        next_frame = now;
+    }
+
+    while ((now = os_now_seconds()) < next_frame) {
+        os_sleep_seconds(Min(INPUT_POLL_INTERVAL, next_frame - now));
+        if (state.current_screen == GAMEPLAY && !state.debug.inspector) {
+            PollInputEvents();
+            input_poll(&state.input, &state.sim.input_events, os_now_seconds());
+        }
+    }
 }
 
 internal void Shutdown() {
+    // stop the simulation before tearing down anything it might still be touching
+    ins_atomic_u32_eval_assign(&state.sim.running, 0);
+    os_thread_join(state.sim.thread);
+
+    // flushes whatever frames are still in flight
+    capture_stop(&state.capture);
+    telemetry_stop(&state.sim.telemetry);
+    scheduler_free(&state.sim.scheduler);
+    jobs_shutdown();
+
     world_cleanup();
+    snapshot_buffer_free(&state.snapshots);
+    particles_free(&particles);
+    arrfree(state.visible_entities);
+    inspector_free(&state.inspector);
     UnloadRenderTexture(state.render_texture);
     UnloadAssets();
     CloseWindow();
@@ -312,6 +775,7 @@ internal void Shutdown() {
 // Asset functions
 
 internal void LoadAssets() {
+    MemTag prev_tag = mem_set_tag(MEM_TAG_ASSETS);
     arrput(assets.paddle_textures, LoadTexture("data/paddle-red.png"));
 
     for (int i = 0; i < 4; i++) {
@@ -320,6 +784,7 @@ internal void LoadAssets() {
         Texture2D texture = LoadTexture(path);
         arrput(assets.ball_textures, texture);
     }
+    mem_set_tag(prev_tag);
 }
 
 internal void UnloadAssets() {
@@ -365,6 +830,3 @@ internal void UpdateAnimation(Animation *anim) {
 
 #define RAYGUI_IMPLEMENTATION
 #include "raygui.h"
-
-#define STB_DS_IMPLEMENTATION
-#include "stb_ds.h"
@@ -0,0 +1,148 @@
+#include "common.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Tracked allocator, see mem.h
+
+// prefixed to every block so reallocs and frees know what they're giving back,
+// 16 bytes keeps the pointer handed out as aligned as malloc's
+typedef struct {
+    u64 size;
+    u32 tag;
+    u32 magic;
+} MemHeader;
+
+#define MEM_MAGIC 0x4D454D21
+
+typedef struct {
+    volatile u64 live_bytes;
+    volatile u64 frame_bytes;
+    volatile u32 frame_calls;
+    volatile u32 reported;
+} MemTagCounters;
+
+global MemTagCounters mem_counters[MEM_TAG_COUNT] = {0};
+global volatile u32 mem_steady_state = 0;
+global volatile u32 mem_violations = 0;
+
+thread_static MemTag mem_current_tag = MEM_TAG_UNTAGGED;
+
+global const char *mem_tag_names[MEM_TAG_COUNT] = {
+    [MEM_TAG_UNTAGGED]  = "untagged",
+    [MEM_TAG_WORLD]     = "world",
+    [MEM_TAG_REGISTRY]  = "registry",
+    [MEM_TAG_EVENTS]    = "events",
+    [MEM_TAG_COMMANDS]  = "commands",
+    [MEM_TAG_ASSETS]    = "assets",
+    [MEM_TAG_PARTICLES] = "particles",
+    [MEM_TAG_RENDER]    = "render",
+};
+
+internal void mem_report_violation(MemTag tag, u64 size) {
+    ins_atomic_u32_add_eval(&mem_violations, 1);
+#if defined(MEM_STRICT_STEADY_STATE)
+    fprintf(stderr, "mem: %llu byte '%s' allocation during steady state gameplay\n", (unsigned long long) size, mem_tag_names[tag]);
+    abort();
+#else
+    // once per tag, a leaky loop would otherwise flood the log every frame
+    if (ins_atomic_u32_eval_assign(&mem_counters[tag].reported, 1) == 0) {
+        fprintf(stderr, "mem: %llu byte '%s' allocation during steady state gameplay\n", (unsigned long long) size, mem_tag_names[tag]);
+    }
+#endif
+}
+
+internal void mem_record_call(MemTag tag, u64 requested_bytes) {
+    MemTagCounters *counters = &mem_counters[tag];
+    ins_atomic_u32_add_eval(&counters->frame_calls, 1);
+    ins_atomic_u64_add_eval(&counters->frame_bytes, requested_bytes);
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void *mem_realloc(void *ptr, size_t size) {
+    if (size == 0) {
+        mem_free(ptr);
+        return NULL;
+    }
+
+    // a block keeps the tag it was created under, growing an array is charged to its owner
+    MemHeader *header = NULL;
+    MemTag tag = mem_current_tag;
+    u64 old_size = 0;
+    if (ptr) {
+        header = (MemHeader *) ptr - 1;
+        if (header->magic != MEM_MAGIC) {
+            fprintf(stderr, "mem: realloc of a block that didn't come from mem_realloc\n");
+            abort();
+        }
+        tag = header->tag;
+        old_size = header->size;
+    }
+
+    mem_record_call(tag, size);
+    if (ins_atomic_u32_eval(&mem_steady_state)) {
+        mem_report_violation(tag, size);
+    }
+
+    header = realloc(header, sizeof(MemHeader) + size);
+    if (!header) return NULL;
+
+    header->size = size;
+    header->tag = tag;
+    header->magic = MEM_MAGIC;
+    // unsigned wraparound makes this a subtraction when the block shrinks
+    ins_atomic_u64_add_eval(&mem_counters[tag].live_bytes, (u64) size - old_size);
+    return header + 1;
+}
+
+void mem_free(void *ptr) {
+    if (!ptr) return;
+
+    MemHeader *header = (MemHeader *) ptr - 1;
+    if (header->magic != MEM_MAGIC) {
+        fprintf(stderr, "mem: free of a block that didn't come from mem_realloc\n");
+        abort();
+    }
+
+    MemTag tag = header->tag;
+    mem_record_call(tag, 0);
+    ins_atomic_u64_add_eval(&mem_counters[tag].live_bytes, (u64) 0 - header->size);
+
+    header->magic = 0;
+    free(header);
+}
+
+MemTag mem_set_tag(MemTag tag) {
+    MemTag prev = mem_current_tag;
+    mem_current_tag = tag;
+    return prev;
+}
+
+const char *mem_tag_name(MemTag tag) {
+    return (tag < MEM_TAG_COUNT) ? mem_tag_names[tag] : "invalid";
+}
+
+MemFrameStats mem_end_frame() {
+    MemFrameStats stats = {0};
+    for (u32 i = 0; i < MEM_TAG_COUNT; i++) {
+        stats.calls[i] = ins_atomic_u32_eval_assign(&mem_counters[i].frame_calls, 0);
+        stats.bytes[i] = ins_atomic_u64_eval_assign(&mem_counters[i].frame_bytes, 0);
+        stats.total_calls += stats.calls[i];
+        stats.total_bytes += stats.bytes[i];
+    }
+    return stats;
+}
+
+u64 mem_live_bytes(MemTag tag) {
+    return (tag < MEM_TAG_COUNT) ? ins_atomic_u64_eval(&mem_counters[tag].live_bytes) : 0;
+}
+
+void mem_set_steady_state(bool steady) {
+    ins_atomic_u32_eval_assign(&mem_steady_state, steady ? 1 : 0);
+}
+
+u32 mem_steady_state_violations() {
+    return ins_atomic_u32_eval(&mem_violations);
+}
@@ -0,0 +1,249 @@
+#include "game.h"
+
+// ----------------------------------------------------------------------------
+// Batched narrow phase, see game.h
+// every kernel processes NARROW_PHASE_BATCH pairs per iteration, as two 4-wide
+// halves with SSE2 or as a plain loop the compiler can vectorize otherwise,
+// and writes one hit bit per pair
+
+internal PairKind narrow_phase_pair_kind(Shape a, Shape b) {
+    if (a == SHAPE_CIRC && b == SHAPE_CIRC) return PAIR_CIRC_CIRC;
+    if (a == SHAPE_RECT && b == SHAPE_RECT) return PAIR_RECT_RECT;
+    return PAIR_CIRC_RECT;
+}
+
+internal u32 narrow_phase_padded_count(u32 count) {
+    return (count + NARROW_PHASE_BATCH - 1) & ~(NARROW_PHASE_BATCH - 1);
+}
+
+internal void narrow_phase_pad_bucket(PairBucket *bucket) {
+    // zero the unused lanes of the last batch so they never hold garbage floats
+    u32 padded = narrow_phase_padded_count(bucket->count);
+    for (u32 i = bucket->count; i < padded; i++) {
+        arrput(bucket->a_x, 0); arrput(bucket->a_y, 0); arrput(bucket->a_w, 0); arrput(bucket->a_h, 0);
+        arrput(bucket->b_x, 0); arrput(bucket->b_y, 0); arrput(bucket->b_w, 0); arrput(bucket->b_h, 0);
+    }
+    arrsetlen(bucket->hit_masks, padded / NARROW_PHASE_BATCH);
+}
+
+#if SIMD_SSE2
+internal __m128 narrow_phase_abs(__m128 x) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+#endif
+
+internal void narrow_phase_circ_circ(PairBucket *bucket) {
+    u32 num_batches = arrlen(bucket->hit_masks);
+    for (u32 batch = 0; batch < num_batches; batch++) {
+        u32 first = batch * NARROW_PHASE_BATCH;
+        u32 mask = 0;
+#if SIMD_SSE2
+        for (u32 half = 0; half < NARROW_PHASE_BATCH; half += 4) {
+            u32 i = first + half;
+            __m128 dx = _mm_sub_ps(_mm_loadu_ps(&bucket->b_x[i]), _mm_loadu_ps(&bucket->a_x[i]));
+            __m128 dy = _mm_sub_ps(_mm_loadu_ps(&bucket->b_y[i]), _mm_loadu_ps(&bucket->a_y[i]));
+            __m128 radii = _mm_add_ps(_mm_loadu_ps(&bucket->a_w[i]), _mm_loadu_ps(&bucket->b_w[i]));
+            __m128 dist_sq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            mask |= _mm_movemask_ps(_mm_cmple_ps(dist_sq, _mm_mul_ps(radii, radii))) << half;
+        }
+#else
+        for (u32 lane = 0; lane < NARROW_PHASE_BATCH; lane++) {
+            u32 i = first + lane;
+            f32 dx = bucket->b_x[i] - bucket->a_x[i];
+            f32 dy = bucket->b_y[i] - bucket->a_y[i];
+            f32 radii = bucket->a_w[i] + bucket->b_w[i];
+            mask |= (dx * dx + dy * dy <= radii * radii) << lane;
+        }
+#endif
+        bucket->hit_masks[batch] = (u8) mask;
+    }
+}
+
+internal void narrow_phase_circ_rect(PairBucket *bucket) {
+    u32 num_batches = arrlen(bucket->hit_masks);
+    for (u32 batch = 0; batch < num_batches; batch++) {
+        u32 first = batch * NARROW_PHASE_BATCH;
+        u32 mask = 0;
+#if SIMD_SSE2
+        const __m128 v_half = _mm_set1_ps(0.5f);
+        const __m128 v_zero = _mm_setzero_ps();
+        for (u32 half = 0; half < NARROW_PHASE_BATCH; half += 4) {
+            u32 i = first + half;
+            __m128 radius = _mm_loadu_ps(&bucket->a_w[i]);
+            __m128 half_w = _mm_mul_ps(_mm_loadu_ps(&bucket->b_w[i]), v_half);
+            __m128 half_h = _mm_mul_ps(_mm_loadu_ps(&bucket->b_h[i]), v_half);
+            __m128 dx = narrow_phase_abs(_mm_sub_ps(_mm_loadu_ps(&bucket->a_x[i]), _mm_add_ps(_mm_loadu_ps(&bucket->b_x[i]), half_w)));
+            __m128 dy = narrow_phase_abs(_mm_sub_ps(_mm_loadu_ps(&bucket->a_y[i]), _mm_add_ps(_mm_loadu_ps(&bucket->b_y[i]), half_h)));
+            __m128 corner_x = _mm_max_ps(_mm_sub_ps(dx, half_w), v_zero);
+            __m128 corner_y = _mm_max_ps(_mm_sub_ps(dy, half_h), v_zero);
+            __m128 corner_sq = _mm_add_ps(_mm_mul_ps(corner_x, corner_x), _mm_mul_ps(corner_y, corner_y));
+
+            __m128 hit = _mm_cmple_ps(dx, _mm_add_ps(half_w, radius));
+            hit = _mm_and_ps(hit, _mm_cmple_ps(dy, _mm_add_ps(half_h, radius)));
+            hit = _mm_and_ps(hit, _mm_cmple_ps(corner_sq, _mm_mul_ps(radius, radius)));
+            mask |= _mm_movemask_ps(hit) << half;
+        }
+#else
+        for (u32 lane = 0; lane < NARROW_PHASE_BATCH; lane++) {
+            u32 i = first + lane;
+            f32 radius = bucket->a_w[i];
+            f32 half_w = bucket->b_w[i] * 0.5f;
+            f32 half_h = bucket->b_h[i] * 0.5f;
+            f32 dx = fabsf(bucket->a_x[i] - (bucket->b_x[i] + half_w));
+            f32 dy = fabsf(bucket->a_y[i] - (bucket->b_y[i] + half_h));
+            f32 corner_x = calc_max(dx - half_w, 0);
+            f32 corner_y = calc_max(dy - half_h, 0);
+            bool hit = dx <= half_w + radius && dy <= half_h + radius
+                    && corner_x * corner_x + corner_y * corner_y <= radius * radius;
+            mask |= hit << lane;
+        }
+#endif
+        bucket->hit_masks[batch] = (u8) mask;
+    }
+}
+
+internal void narrow_phase_rect_rect(PairBucket *bucket) {
+    u32 num_batches = arrlen(bucket->hit_masks);
+    for (u32 batch = 0; batch < num_batches; batch++) {
+        u32 first = batch * NARROW_PHASE_BATCH;
+        u32 mask = 0;
+#if SIMD_SSE2
+        for (u32 half = 0; half < NARROW_PHASE_BATCH; half += 4) {
+            u32 i = first + half;
+            __m128 a_x = _mm_loadu_ps(&bucket->a_x[i]);
+            __m128 a_y = _mm_loadu_ps(&bucket->a_y[i]);
+            __m128 b_x = _mm_loadu_ps(&bucket->b_x[i]);
+            __m128 b_y = _mm_loadu_ps(&bucket->b_y[i]);
+
+            __m128 hit = _mm_cmplt_ps(a_x, _mm_add_ps(b_x, _mm_loadu_ps(&bucket->b_w[i])));
+            hit = _mm_and_ps(hit, _mm_cmpgt_ps(_mm_add_ps(a_x, _mm_loadu_ps(&bucket->a_w[i])), b_x));
+            hit = _mm_and_ps(hit, _mm_cmplt_ps(a_y, _mm_add_ps(b_y, _mm_loadu_ps(&bucket->b_h[i]))));
+            hit = _mm_and_ps(hit, _mm_cmpgt_ps(_mm_add_ps(a_y, _mm_loadu_ps(&bucket->a_h[i])), b_y));
+            mask |= _mm_movemask_ps(hit) << half;
+        }
+#else
+        for (u32 lane = 0; lane < NARROW_PHASE_BATCH; lane++) {
+            u32 i = first + lane;
+            bool hit = bucket->a_x[i] < bucket->b_x[i] + bucket->b_w[i] && bucket->a_x[i] + bucket->a_w[i] > bucket->b_x[i]
+                    && bucket->a_y[i] < bucket->b_y[i] + bucket->b_h[i] && bucket->a_y[i] + bucket->a_h[i] > bucket->b_y[i];
+            mask |= hit << lane;
+        }
+#endif
+        bucket->hit_masks[batch] = (u8) mask;
+    }
+}
+
+// candidate pairs a shape starts at once, a circle packed in a square grid overlaps the boxes of
+// its right, lower and both diagonal neighbours, with room left for whatever it's lying on
+internal const u32 NARROW_PHASE_PAIRS_PER_SHAPE = 6;
+
+internal void narrow_phase_reserve_bucket(PairBucket *bucket, u32 num_pairs) {
+    u32 padded = narrow_phase_padded_count(num_pairs);
+    arrsetcap(bucket->a, padded);
+    arrsetcap(bucket->b, padded);
+    arrsetcap(bucket->a_x, padded); arrsetcap(bucket->a_y, padded); arrsetcap(bucket->a_w, padded); arrsetcap(bucket->a_h, padded);
+    arrsetcap(bucket->b_x, padded); arrsetcap(bucket->b_y, padded); arrsetcap(bucket->b_w, padded); arrsetcap(bucket->b_h, padded);
+    arrsetcap(bucket->hit_masks, padded / NARROW_PHASE_BATCH);
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void narrow_phase_begin(NarrowPhase *narrow, f32 margin, u32 num_circles, u32 num_rects) {
+    narrow->margin = margin;
+
+    // only grows when colliders were added, every circle and rect pair has a circle in it
+    narrow_phase_reserve_bucket(&narrow->buckets[PAIR_CIRC_CIRC], num_circles * NARROW_PHASE_PAIRS_PER_SHAPE);
+    narrow_phase_reserve_bucket(&narrow->buckets[PAIR_CIRC_RECT], num_circles * NARROW_PHASE_PAIRS_PER_SHAPE);
+    narrow_phase_reserve_bucket(&narrow->buckets[PAIR_RECT_RECT], num_rects * NARROW_PHASE_PAIRS_PER_SHAPE);
+
+    for (u32 kind = 0; kind < PAIR_KIND_COUNT; kind++) {
+        PairBucket *bucket = &narrow->buckets[kind];
+        arrsetlen(bucket->a, 0);
+        arrsetlen(bucket->b, 0);
+        arrsetlen(bucket->a_x, 0); arrsetlen(bucket->a_y, 0); arrsetlen(bucket->a_w, 0); arrsetlen(bucket->a_h, 0);
+        arrsetlen(bucket->b_x, 0); arrsetlen(bucket->b_y, 0); arrsetlen(bucket->b_w, 0); arrsetlen(bucket->b_h, 0);
+        arrsetlen(bucket->hit_masks, 0);
+        bucket->count = 0;
+    }
+}
+
+void narrow_phase_add_pair(NarrowPhase *narrow, Entity a, Entity b) {
+    const ColliderBlock *block_a = &world->collider_blocks[a / COLLIDER_BLOCK_LANES];
+    const ColliderBlock *block_b = &world->collider_blocks[b / COLLIDER_BLOCK_LANES];
+    u32 lane_a = a % COLLIDER_BLOCK_LANES;
+    u32 lane_b = b % COLLIDER_BLOCK_LANES;
+    Shape shape_a = block_a->shape[lane_a];
+    Shape shape_b = block_b->shape[lane_b];
+    if (shape_a == SHAPE_NONE || shape_b == SHAPE_NONE) return;
+    if (shape_a == SHAPE_TILEMAP || shape_b == SHAPE_TILEMAP) return;
+    if (shape_a == SHAPE_RECT && shape_b == SHAPE_CIRC) {
+        Entity swap = a; a = b; b = swap;
+        const ColliderBlock *swap_block = block_a; block_a = block_b; block_b = swap_block;
+        u32 swap_lane = lane_a; lane_a = lane_b; lane_b = swap_lane;
+        shape_a = SHAPE_CIRC; shape_b = SHAPE_RECT;
+    }
+
+    PairBucket *bucket = &narrow->buckets[narrow_phase_pair_kind(shape_a, shape_b)];
+    bool a_is_circ = shape_a == SHAPE_CIRC;
+    bool b_is_circ = shape_b == SHAPE_CIRC;
+
+    // the blocks hold the corner of the bounds, circles are tested from their center
+    // and grow around it, rects grow on every side
+    const f32 margin = narrow->margin;
+    const f32 a_shift = a_is_circ ? -(f32) block_a->radius[lane_a] : margin;
+    const f32 b_shift = b_is_circ ? -(f32) block_b->radius[lane_b] : margin;
+    const f32 a_grow = a_is_circ ? margin : 2 * margin;
+    const f32 b_grow = b_is_circ ? margin : 2 * margin;
+
+    arrput(bucket->a, a);
+    arrput(bucket->b, b);
+    arrput(bucket->a_x, block_a->x[lane_a] - a_shift);
+    arrput(bucket->a_y, block_a->y[lane_a] - a_shift);
+    arrput(bucket->a_w, (a_is_circ ? block_a->radius[lane_a] : block_a->width[lane_a]) + a_grow);
+    arrput(bucket->a_h, (a_is_circ ? block_a->radius[lane_a] : block_a->height[lane_a]) + a_grow);
+    arrput(bucket->b_x, block_b->x[lane_b] - b_shift);
+    arrput(bucket->b_y, block_b->y[lane_b] - b_shift);
+    arrput(bucket->b_w, (b_is_circ ? block_b->radius[lane_b] : block_b->width[lane_b]) + b_grow);
+    arrput(bucket->b_h, (b_is_circ ? block_b->radius[lane_b] : block_b->height[lane_b]) + b_grow);
+    bucket->count++;
+}
+
+void narrow_phase_run(NarrowPhase *narrow) {
+    for (u32 kind = 0; kind < PAIR_KIND_COUNT; kind++) {
+        narrow_phase_pad_bucket(&narrow->buckets[kind]);
+    }
+
+    narrow_phase_circ_circ(&narrow->buckets[PAIR_CIRC_CIRC]);
+    narrow_phase_circ_rect(&narrow->buckets[PAIR_CIRC_RECT]);
+    narrow_phase_rect_rect(&narrow->buckets[PAIR_RECT_RECT]);
+
+    // empty padding pairs can read as touching, drop their bits
+    for (u32 kind = 0; kind < PAIR_KIND_COUNT; kind++) {
+        PairBucket *bucket = &narrow->buckets[kind];
+        u32 used_lanes = bucket->count % NARROW_PHASE_BATCH;
+        if (used_lanes != 0) {
+            bucket->hit_masks[bucket->count / NARROW_PHASE_BATCH] &= (1u << used_lanes) - 1;
+        }
+    }
+}
+
+u32 narrow_phase_pair_count(NarrowPhase *narrow) {
+    u32 count = 0;
+    for (u32 kind = 0; kind < PAIR_KIND_COUNT; kind++) {
+        count += narrow->buckets[kind].count;
+    }
+    return count;
+}
+
+void narrow_phase_free(NarrowPhase *narrow) {
+    for (u32 kind = 0; kind < PAIR_KIND_COUNT; kind++) {
+        PairBucket *bucket = &narrow->buckets[kind];
+        arrfree(bucket->a);
+        arrfree(bucket->b);
+        arrfree(bucket->a_x); arrfree(bucket->a_y); arrfree(bucket->a_w); arrfree(bucket->a_h);
+        arrfree(bucket->b_x); arrfree(bucket->b_y); arrfree(bucket->b_w); arrfree(bucket->b_h);
+        arrfree(bucket->hit_masks);
+    }
+    *narrow = (NarrowPhase) {0};
+}
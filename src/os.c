@@ -0,0 +1,684 @@
+#if !defined(_WIN32) && !defined(_GNU_SOURCE)
+// pthread_setaffinity_np() and the cpu_set_t macros
+#define _GNU_SOURCE
+#endif
+
+#include "os.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include <stdlib.h>
+
+// -----------------------------------------------------------------------------
+// Platform primitives
+
+#if defined(_WIN32)
+typedef CRITICAL_SECTION   OsMutex;
+typedef CONDITION_VARIABLE OsCond;
+
+internal void os_mutex_init(OsMutex *mutex)    { InitializeCriticalSection(mutex); }
+internal void os_mutex_destroy(OsMutex *mutex) { DeleteCriticalSection(mutex); }
+internal void os_mutex_lock(OsMutex *mutex)    { EnterCriticalSection(mutex); }
+internal void os_mutex_unlock(OsMutex *mutex)  { LeaveCriticalSection(mutex); }
+
+internal void os_cond_init(OsCond *cond)                    { InitializeConditionVariable(cond); }
+internal void os_cond_destroy(OsCond *cond)                 { (void) cond; }
+internal void os_cond_wait(OsCond *cond, OsMutex *mutex)    { SleepConditionVariableCS(cond, mutex, INFINITE); }
+internal void os_cond_broadcast(OsCond *cond)               { WakeAllConditionVariable(cond); }
+#else
+typedef pthread_mutex_t OsMutex;
+typedef pthread_cond_t  OsCond;
+
+internal void os_mutex_init(OsMutex *mutex)    { pthread_mutex_init(mutex, NULL); }
+internal void os_mutex_destroy(OsMutex *mutex) { pthread_mutex_destroy(mutex); }
+internal void os_mutex_lock(OsMutex *mutex)    { pthread_mutex_lock(mutex); }
+internal void os_mutex_unlock(OsMutex *mutex)  { pthread_mutex_unlock(mutex); }
+
+internal void os_cond_init(OsCond *cond)                    { pthread_cond_init(cond, NULL); }
+internal void os_cond_destroy(OsCond *cond)                 { pthread_cond_destroy(cond); }
+internal void os_cond_wait(OsCond *cond, OsMutex *mutex)    { pthread_cond_wait(cond, mutex); }
+internal void os_cond_broadcast(OsCond *cond)               { pthread_cond_broadcast(cond); }
+#endif
+
+typedef struct {
+    OsThreadFunc *func;
+    void *data;
+} OsThreadStart;
+
+#if defined(_WIN32)
+internal DWORD WINAPI os_thread_trampoline(LPVOID param) {
+#else
+internal void *os_thread_trampoline(void *param) {
+#endif
+    OsThreadStart start = *(OsThreadStart *) param;
+    free(param);
+    start.func(start.data);
+    return 0;
+}
+
+OsThread os_thread_create(OsThreadFunc *func, void *data) {
+    OsThreadStart *start = malloc(sizeof(OsThreadStart));
+    start->func = func;
+    start->data = data;
+
+    OsThread thread = {0};
+#if defined(_WIN32)
+    HANDLE handle = CreateThread(NULL, 0, os_thread_trampoline, start, 0, NULL);
+    thread.handle = (u64) (uintptr_t) handle;
+#else
+    pthread_t handle;
+    pthread_create(&handle, NULL, os_thread_trampoline, start);
+    thread.handle = (u64) (uintptr_t) handle;
+#endif
+    return thread;
+}
+
+void os_thread_join(OsThread thread) {
+#if defined(_WIN32)
+    HANDLE handle = (HANDLE) (uintptr_t) thread.handle;
+    WaitForSingleObject(handle, INFINITE);
+    CloseHandle(handle);
+#else
+    pthread_join((pthread_t) (uintptr_t) thread.handle, NULL);
+#endif
+}
+
+void os_thread_yield() {
+#if defined(_WIN32)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+void os_sleep_seconds(f64 seconds) {
+    if (seconds <= 0) return;
+#if defined(_WIN32)
+    // Sleep() only has millisecond granularity, round down and let the caller spin the rest
+    DWORD ms = (DWORD) (seconds * 1000);
+    if (ms > 0) Sleep(ms); else SwitchToThread();
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t) seconds;
+    ts.tv_nsec = (long) ((seconds - (f64) ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+u32 os_cpu_count() {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (u32) info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (u32) count : 1;
+#endif
+}
+
+f64 os_now_seconds() {
+#if defined(_WIN32)
+    local_persist f64 inv_frequency = 0;
+    if (inv_frequency == 0) {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        inv_frequency = 1.0 / (f64) frequency.QuadPart;
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (f64) counter.QuadPart * inv_frequency;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64) ts.tv_sec + (f64) ts.tv_nsec * 1e-9;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// NUMA topology
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+// linux lists every node's cpus as ranges, eg. "0-7,16-23"
+internal bool os_cpulist_contains(const char *path, u32 cpu) {
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+
+    bool found = false;
+    u32 first, last;
+    while (!found && fscanf(file, "%u", &first) == 1) {
+        last = first;
+        int c = fgetc(file);
+        if (c == '-') {
+            if (fscanf(file, "%u", &last) != 1) break;
+            c = fgetc(file);
+        }
+        found = cpu >= first && cpu <= last;
+        if (c != ',') break;
+    }
+    fclose(file);
+    return found;
+}
+#endif
+
+u32 os_numa_node_count() {
+#if defined(_WIN32)
+    ULONG highest = 0;
+    return GetNumaHighestNodeNumber(&highest) ? (u32) highest + 1 : 1;
+#elif defined(__APPLE__)
+    return 1;
+#else
+    u32 count = 0;
+    char path[64];
+    for (;;) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u", count);
+        if (access(path, F_OK) != 0) break;
+        count++;
+    }
+    return Max(count, 1);
+#endif
+}
+
+u32 os_numa_node_of_cpu(u32 cpu) {
+#if defined(_WIN32)
+    UCHAR node = 0;
+    return (cpu < 256 && GetNumaProcessorNode((UCHAR) cpu, &node) && node != 0xFF) ? node : 0;
+#elif defined(__APPLE__)
+    return 0;
+#else
+    char path[64];
+    u32 num_nodes = os_numa_node_count();
+    for (u32 node = 0; node < num_nodes; node++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+        if (os_cpulist_contains(path, cpu)) return node;
+    }
+    return 0;
+#endif
+}
+
+bool os_thread_pin(u32 cpu) {
+#if defined(_WIN32)
+    if (cpu >= 64) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu) != 0;
+#elif defined(__APPLE__)
+    return false;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
+
+bool os_thread_get_affinity(OsCpuMask *mask) {
+    *mask = (OsCpuMask) {0};
+#if defined(_WIN32)
+    // there's no getter for a thread, setting one hands back the mask it replaced
+    DWORD_PTR process_mask, system_mask;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) return false;
+    DWORD_PTR thread_mask = SetThreadAffinityMask(GetCurrentThread(), process_mask);
+    if (thread_mask == 0) return false;
+    SetThreadAffinityMask(GetCurrentThread(), thread_mask);
+    mask->bits[0] = (u64) thread_mask;
+    return true;
+#elif defined(__APPLE__)
+    return false;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) return false;
+    for (u32 cpu = 0; cpu < Min(CPU_SETSIZE, 64 * ArrayCount(mask->bits)); cpu++) {
+        if (CPU_ISSET(cpu, &set)) mask->bits[cpu / 64] |= 1ull << (cpu % 64);
+    }
+    return true;
+#endif
+}
+
+bool os_thread_set_affinity(const OsCpuMask *mask) {
+#if defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) mask->bits[0]) != 0;
+#elif defined(__APPLE__)
+    return false;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (u32 cpu = 0; cpu < Min(CPU_SETSIZE, 64 * ArrayCount(mask->bits)); cpu++) {
+        if (mask->bits[cpu / 64] & (1ull << (cpu % 64))) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Shared memory
+
+// posix names start with a slash, windows ones live in the session's local namespace
+internal void os_shared_memory_path(char *path, u32 path_size, const char *name) {
+#if defined(_WIN32)
+    snprintf(path, path_size, "Local\\%s", name);
+#else
+    snprintf(path, path_size, "/%s", name);
+#endif
+}
+
+bool os_shared_memory_create(OsSharedMemory *memory, const char *name, u64 size) {
+    *memory = (OsSharedMemory) {.size = size, .owner = true};
+    os_shared_memory_path(memory->name, sizeof(memory->name), name);
+
+#if defined(_WIN32)
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                        (DWORD) (size >> 32), (DWORD) size, memory->name);
+    if (!mapping) return false;
+    memory->base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!memory->base) {
+        CloseHandle(mapping);
+        return false;
+    }
+    memory->handle = (u64) (uintptr_t) mapping;
+    // a mapping that outlived its previous owner keeps its old contents
+    memset(memory->base, 0, size);
+#else
+    shm_unlink(memory->name);
+    int fd = shm_open(memory->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return false;
+    if (ftruncate(fd, (off_t) size) != 0) {
+        close(fd);
+        shm_unlink(memory->name);
+        return false;
+    }
+
+    // the mapping keeps the segment alive, the descriptor isn't needed past this point
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(memory->name);
+        return false;
+    }
+    memory->base = base;
+#endif
+    return true;
+}
+
+bool os_shared_memory_open(OsSharedMemory *memory, const char *name) {
+    *memory = (OsSharedMemory) {0};
+    os_shared_memory_path(memory->name, sizeof(memory->name), name);
+
+#if defined(_WIN32)
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, memory->name);
+    if (!mapping) return false;
+    memory->base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!memory->base) {
+        CloseHandle(mapping);
+        return false;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(memory->base, &info, sizeof(info));
+    memory->size = info.RegionSize;
+    memory->handle = (u64) (uintptr_t) mapping;
+#else
+    int fd = shm_open(memory->name, O_RDONLY, 0);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    void *base = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+    memory->base = base;
+    memory->size = (u64) info.st_size;
+#endif
+    return true;
+}
+
+void os_shared_memory_close(OsSharedMemory *memory) {
+    if (!memory->base) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(memory->base);
+    CloseHandle((HANDLE) (uintptr_t) memory->handle);
+#else
+    munmap(memory->base, memory->size);
+    if (memory->owner) shm_unlink(memory->name);
+#endif
+    *memory = (OsSharedMemory) {0};
+}
+
+// -----------------------------------------------------------------------------
+// Job pool
+
+typedef struct {
+    bool initialized;
+    bool quit;
+    u32 num_threads;
+    OsThread *threads;
+
+    // cpu and node of every worker while pinned, indexed by worker
+    bool pinned;
+    u32 *worker_cpus;
+    u32 *worker_nodes;
+    // what the thread that started the pool could run on before it became pinned worker 0
+    bool restore_caller;
+    OsCpuMask caller_affinity;
+
+    OsMutex lock;
+    OsCond wake;
+    u32 generation;
+
+    // the parallel_for currently in flight
+    JobRangeFunc *func;
+    void *data;
+    u32 count;
+    u32 batch_size;
+    u32 num_batches;
+    // one fixed range per worker instead of batches handed out first come first served
+    bool static_ranges;
+    volatile u32 next_batch;
+    volatile u32 busy_workers;
+} JobPool;
+
+global JobPool pool = {0};
+
+// nested parallel_for calls from inside a job run inline instead of deadlocking
+thread_static bool jobs_in_worker = false;
+
+internal void jobs_run_batches(u32 worker) {
+    if (pool.static_ranges) {
+        u32 begin = (u32) ((u64) pool.count * worker / pool.num_threads);
+        u32 end = (u32) ((u64) pool.count * (worker + 1) / pool.num_threads);
+        if (begin < end) pool.func(pool.data, begin, end, worker);
+        return;
+    }
+
+    for (;;) {
+        u32 batch = ins_atomic_u32_add_eval(&pool.next_batch, 1) - 1;
+        if (batch >= pool.num_batches) break;
+
+        u32 begin = batch * pool.batch_size;
+        u32 end = Min(begin + pool.batch_size, pool.count);
+        pool.func(pool.data, begin, end, worker);
+    }
+}
+
+internal void jobs_worker_main(void *data) {
+    u32 worker = (u32) (uintptr_t) data;
+    u32 seen_generation = 0;
+    jobs_in_worker = true;
+    if (pool.pinned) {
+        os_thread_pin(pool.worker_cpus[worker]);
+    }
+
+    for (;;) {
+        os_mutex_lock(&pool.lock);
+        while (pool.generation == seen_generation && !pool.quit) {
+            os_cond_wait(&pool.wake, &pool.lock);
+        }
+        bool quit = pool.quit;
+        seen_generation = pool.generation;
+        os_mutex_unlock(&pool.lock);
+
+        if (quit) break;
+
+        jobs_run_batches(worker);
+        ins_atomic_u32_add_eval(&pool.busy_workers, (u32) -1);
+    }
+}
+
+// worker w goes to node w % num_nodes, on that node's next unused cpu
+internal void jobs_place_workers() {
+    u32 num_cpus = os_cpu_count();
+    u32 num_nodes = os_numa_node_count();
+    u32 *cpu_nodes = NULL;
+    u32 *used_per_node = NULL;
+    arrsetlen(cpu_nodes, num_cpus);
+    arrsetlen(used_per_node, num_nodes);
+    for (u32 cpu = 0; cpu < num_cpus; cpu++) {
+        cpu_nodes[cpu] = os_numa_node_of_cpu(cpu);
+    }
+    memset(used_per_node, 0, num_nodes * sizeof(u32));
+
+    arrsetlen(pool.worker_cpus, pool.num_threads);
+    arrsetlen(pool.worker_nodes, pool.num_threads);
+    for (u32 worker = 0; worker < pool.num_threads; worker++) {
+        // the n-th cpu of the node, wrapping around once a node runs out, nodes without cpus give way
+        // to plain round robin over every cpu
+        u32 node = worker % num_nodes;
+        u32 wanted = used_per_node[node]++;
+        u32 node_cpus = 0;
+        for (u32 cpu = 0; cpu < num_cpus; cpu++) node_cpus += cpu_nodes[cpu] == node;
+
+        u32 chosen = worker % num_cpus;
+        if (node_cpus > 0) {
+            u32 skip = wanted % node_cpus;
+            for (u32 cpu = 0; cpu < num_cpus; cpu++) {
+                if (cpu_nodes[cpu] != node) continue;
+                if (skip-- == 0) {
+                    chosen = cpu;
+                    break;
+                }
+            }
+        }
+        pool.worker_cpus[worker] = chosen;
+        pool.worker_nodes[worker] = cpu_nodes[chosen];
+    }
+    arrfree(cpu_nodes);
+    arrfree(used_per_node);
+}
+
+internal void jobs_start(u32 num_threads, bool pinned) {
+    if (pool.initialized) {
+        jobs_shutdown();
+    }
+
+    pool = (JobPool) {0};
+    pool.initialized = true;
+    pool.num_threads = (num_threads > 0) ? num_threads : os_cpu_count();
+
+    os_mutex_init(&pool.lock);
+    os_cond_init(&pool.wake);
+
+    // the calling thread is worker 0, it's pinned right here and let go again by jobs_shutdown()
+    if (pinned) {
+        jobs_place_workers();
+        pool.pinned = true;
+        pool.restore_caller = os_thread_get_affinity(&pool.caller_affinity);
+        os_thread_pin(pool.worker_cpus[0]);
+    }
+
+    // worker 0 is whichever thread calls jobs_parallel_for(), only this one is pinned for it
+    for (u32 i = 1; i < pool.num_threads; i++) {
+        arrput(pool.threads, os_thread_create(jobs_worker_main, (void *) (uintptr_t) i));
+    }
+}
+
+void jobs_init(u32 num_threads) {
+    jobs_start(num_threads, false);
+}
+
+void jobs_init_pinned(u32 num_threads) {
+    jobs_start(num_threads, true);
+}
+
+void jobs_shutdown() {
+    if (!pool.initialized) return;
+
+    os_mutex_lock(&pool.lock);
+    pool.quit = true;
+    os_cond_broadcast(&pool.wake);
+    os_mutex_unlock(&pool.lock);
+
+    for (u32 i = 0; i < arrlen(pool.threads); i++) {
+        os_thread_join(pool.threads[i]);
+    }
+    arrfree(pool.threads);
+    arrfree(pool.worker_cpus);
+    arrfree(pool.worker_nodes);
+    if (pool.restore_caller) {
+        os_thread_set_affinity(&pool.caller_affinity);
+    }
+
+    os_cond_destroy(&pool.wake);
+    os_mutex_destroy(&pool.lock);
+    pool = (JobPool) {0};
+}
+
+u32 jobs_worker_count() {
+    return pool.initialized ? pool.num_threads : 1;
+}
+
+bool jobs_pinned() {
+    return pool.pinned;
+}
+
+u32 jobs_worker_node(u32 worker) {
+    return (pool.pinned && worker < pool.num_threads) ? pool.worker_nodes[worker] : 0;
+}
+
+void jobs_parallel_for(u32 count, u32 batch_size, JobRangeFunc *func, void *data) {
+    if (count == 0) return;
+    if (batch_size == 0) batch_size = 1;
+
+    // not worth waking anybody up, or we're already inside a job
+    bool run_inline = !pool.initialized || pool.num_threads == 1 || count <= batch_size || jobs_in_worker;
+    if (run_inline) {
+        func(data, 0, count, 0);
+        return;
+    }
+
+    os_mutex_lock(&pool.lock);
+    pool.func = func;
+    pool.data = data;
+    pool.count = count;
+    pool.batch_size = batch_size;
+    pool.num_batches = (count + batch_size - 1) / batch_size;
+    pool.static_ranges = false;
+    pool.next_batch = 0;
+    pool.busy_workers = pool.num_threads - 1;
+    pool.generation++;
+    os_cond_broadcast(&pool.wake);
+    os_mutex_unlock(&pool.lock);
+
+    jobs_in_worker = true;
+    jobs_run_batches(0);
+    jobs_in_worker = false;
+
+    // wait for stragglers, they have to check out before the job fields can be reused
+    while (ins_atomic_u32_eval(&pool.busy_workers) != 0) {
+        os_thread_yield();
+    }
+}
+
+void jobs_parallel_for_static(u32 count, JobRangeFunc *func, void *data) {
+    if (count == 0) return;
+
+    bool run_inline = !pool.initialized || pool.num_threads == 1 || jobs_in_worker;
+    if (run_inline) {
+        func(data, 0, count, 0);
+        return;
+    }
+
+    os_mutex_lock(&pool.lock);
+    pool.func = func;
+    pool.data = data;
+    pool.count = count;
+    pool.batch_size = 0;
+    pool.num_batches = 0;
+    pool.static_ranges = true;
+    pool.next_batch = 0;
+    pool.busy_workers = pool.num_threads - 1;
+    pool.generation++;
+    os_cond_broadcast(&pool.wake);
+    os_mutex_unlock(&pool.lock);
+
+    jobs_in_worker = true;
+    jobs_run_batches(0);
+    jobs_in_worker = false;
+
+    while (ins_atomic_u32_eval(&pool.busy_workers) != 0) {
+        os_thread_yield();
+    }
+}
+
+// shared by the executors of one jobs_run_graph() call, everything below the lock is guarded by it
+typedef struct {
+    OsMutex lock;
+    OsCond ready;
+    u32 num_tasks;
+    u32 finished;
+    const u32 *order;
+    const u32 *dependent_offsets;
+    const u32 *dependents;
+    u32 *pending;
+    JobTaskFunc *func;
+    void *data;
+} JobGraph;
+
+#define JOB_GRAPH_CLAIMED 0xFFFFFFFF
+
+internal void jobs_graph_executor(void *data, u32 begin, u32 end, u32 worker) {
+    JobGraph *graph = data;
+
+    os_mutex_lock(&graph->lock);
+    while (graph->finished < graph->num_tasks) {
+        u32 task = JOB_GRAPH_CLAIMED;
+        for (u32 i = 0; i < graph->num_tasks; i++) {
+            if (graph->pending[graph->order[i]] == 0) {
+                task = graph->order[i];
+                break;
+            }
+        }
+
+        // everything left waits on tasks other executors are still running, sleep until one finishes
+        if (task == JOB_GRAPH_CLAIMED) {
+            os_cond_wait(&graph->ready, &graph->lock);
+            continue;
+        }
+
+        graph->pending[task] = JOB_GRAPH_CLAIMED;
+        os_mutex_unlock(&graph->lock);
+        graph->func(graph->data, task, worker);
+        os_mutex_lock(&graph->lock);
+
+        for (u32 d = graph->dependent_offsets[task]; d < graph->dependent_offsets[task + 1]; d++) {
+            graph->pending[graph->dependents[d]]--;
+        }
+        graph->finished++;
+        os_cond_broadcast(&graph->ready);
+    }
+    os_mutex_unlock(&graph->lock);
+}
+
+void jobs_run_graph(u32 num_tasks, const u32 *order, const u32 *dependent_offsets, const u32 *dependents,
+                    u32 *pending, JobTaskFunc *func, void *data) {
+    if (num_tasks == 0) return;
+
+    JobGraph graph = {
+        .num_tasks = num_tasks,
+        .order = order,
+        .dependent_offsets = dependent_offsets,
+        .dependents = dependents,
+        .pending = pending,
+        .func = func,
+        .data = data,
+    };
+    os_mutex_init(&graph.lock);
+    os_cond_init(&graph.ready);
+
+    // one executor per worker, no more than there are tasks. a single executor,
+    // or one started from inside a job, just runs the tasks in order
+    jobs_parallel_for(Min(jobs_worker_count(), num_tasks), 1, jobs_graph_executor, &graph);
+
+    os_cond_destroy(&graph.ready);
+    os_mutex_destroy(&graph.lock);
+}
@@ -0,0 +1,177 @@
+#include "game.h"
+#include "rlgl.h"
+
+// ----------------------------------------------------------------------------
+// Particle pool, every column is allocated up front at full capacity
+// so emitting and updating never allocate, emits past capacity are dropped
+
+// a burst draws its randoms a chunk at a time, angle, speed and lifetime side by side
+#define PARTICLES_BURST_CHUNK 64
+
+internal const u64 PARTICLES_RNG_SEED = 0x9E3779B9;
+
+internal void particles_swap_remove(ParticleSystem *ps, u32 index) {
+    u32 last = --ps->count;
+    ps->x[index]            = ps->x[last];
+    ps->y[index]            = ps->y[last];
+    ps->vel_x[index]        = ps->vel_x[last];
+    ps->vel_y[index]        = ps->vel_y[last];
+    ps->life[index]         = ps->life[last];
+    ps->inv_lifetime[index] = ps->inv_lifetime[last];
+    ps->fade[index]         = ps->fade[last];
+    ps->size[index]         = ps->size[last];
+    ps->color[index]        = ps->color[last];
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void particles_init(ParticleSystem *ps, u32 capacity) {
+    *ps = (ParticleSystem) {0};
+    ps->capacity = (capacity + 3) & ~3u;
+    rng_seed(&ps->rng, PARTICLES_RNG_SEED);
+    ps->gravity = -200;
+    ps->drag = 1.5f;
+
+    MemTag prev_tag = mem_set_tag(MEM_TAG_PARTICLES);
+    arrsetlen(ps->x,            ps->capacity);
+    arrsetlen(ps->y,            ps->capacity);
+    arrsetlen(ps->vel_x,        ps->capacity);
+    arrsetlen(ps->vel_y,        ps->capacity);
+    arrsetlen(ps->life,         ps->capacity);
+    arrsetlen(ps->inv_lifetime, ps->capacity);
+    arrsetlen(ps->fade,         ps->capacity);
+    arrsetlen(ps->size,         ps->capacity);
+    arrsetlen(ps->color,        ps->capacity);
+    mem_set_tag(prev_tag);
+}
+
+void particles_free(ParticleSystem *ps) {
+    arrfree(ps->x);
+    arrfree(ps->y);
+    arrfree(ps->vel_x);
+    arrfree(ps->vel_y);
+    arrfree(ps->life);
+    arrfree(ps->inv_lifetime);
+    arrfree(ps->fade);
+    arrfree(ps->size);
+    arrfree(ps->color);
+    *ps = (ParticleSystem) {0};
+}
+
+void particles_clear(ParticleSystem *ps) {
+    ps->count = 0;
+}
+
+void particles_emit(ParticleSystem *ps, f32 x, f32 y, f32 vel_x, f32 vel_y, f32 lifetime, f32 size, Color color) {
+    if (ps->count >= ps->capacity || lifetime <= 0) return;
+
+    u32 i = ps->count++;
+    ps->x[i] = x;
+    ps->y[i] = y;
+    ps->vel_x[i] = vel_x;
+    ps->vel_y[i] = vel_y;
+    ps->life[i] = lifetime;
+    ps->inv_lifetime[i] = 1.0f / lifetime;
+    ps->fade[i] = 1.0f;
+    ps->size[i] = size;
+    ps->color[i] = color;
+}
+
+void particles_emit_burst(ParticleSystem *ps, f32 x, f32 y, u32 count, f32 speed, f32 lifetime, f32 size, Color color) {
+    f32 randoms[3 * PARTICLES_BURST_CHUNK];
+    for (u32 begin = 0; begin < count; begin += PARTICLES_BURST_CHUNK) {
+        u32 chunk = Min(count - begin, PARTICLES_BURST_CHUNK);
+        rng_fill_unit(&ps->rng, randoms, 3 * chunk);
+
+        const f32 *angles = randoms;
+        const f32 *speeds = randoms + chunk;
+        const f32 *lifetimes = randoms + 2 * chunk;
+        for (u32 i = 0; i < chunk; i++) {
+            f32 angle = angles[i] * 2 * PI_32;
+            f32 particle_speed = speed * (0.25f + 0.75f * speeds[i]);
+            f32 particle_lifetime = lifetime * (0.5f + 0.5f * lifetimes[i]);
+            particles_emit(ps, x, y, cosf(angle) * particle_speed, sinf(angle) * particle_speed, particle_lifetime, size, color);
+        }
+    }
+}
+
+void particles_update(ParticleSystem *ps, f32 dt) {
+    const f32 damping = calc_max(0, 1 - ps->drag * dt);
+    const f32 gravity_dt = ps->gravity * dt;
+
+    // integrate everything in lanes of 4, the padding lanes past count are garbage but harmless
+    u32 count = (ps->count + 3) & ~3u;
+#if SIMD_SSE2
+    const __m128 v_dt = _mm_set1_ps(dt);
+    const __m128 v_damping = _mm_set1_ps(damping);
+    const __m128 v_gravity_dt = _mm_set1_ps(gravity_dt);
+    const __m128 v_zero = _mm_setzero_ps();
+    for (u32 i = 0; i < count; i += 4) {
+        __m128 vel_x = _mm_mul_ps(_mm_loadu_ps(&ps->vel_x[i]), v_damping);
+        __m128 vel_y = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&ps->vel_y[i]), v_gravity_dt), v_damping);
+        __m128 x = _mm_add_ps(_mm_loadu_ps(&ps->x[i]), _mm_mul_ps(vel_x, v_dt));
+        __m128 y = _mm_add_ps(_mm_loadu_ps(&ps->y[i]), _mm_mul_ps(vel_y, v_dt));
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(&ps->life[i]), v_dt);
+        __m128 fade = _mm_mul_ps(_mm_max_ps(life, v_zero), _mm_loadu_ps(&ps->inv_lifetime[i]));
+
+        _mm_storeu_ps(&ps->vel_x[i], vel_x);
+        _mm_storeu_ps(&ps->vel_y[i], vel_y);
+        _mm_storeu_ps(&ps->x[i], x);
+        _mm_storeu_ps(&ps->y[i], y);
+        _mm_storeu_ps(&ps->life[i], life);
+        _mm_storeu_ps(&ps->fade[i], fade);
+    }
+#else
+    for (u32 i = 0; i < count; i++) {
+        ps->vel_x[i] = ps->vel_x[i] * damping;
+        ps->vel_y[i] = (ps->vel_y[i] + gravity_dt) * damping;
+        ps->x[i] += ps->vel_x[i] * dt;
+        ps->y[i] += ps->vel_y[i] * dt;
+        ps->life[i] -= dt;
+        ps->fade[i] = calc_max(ps->life[i], 0) * ps->inv_lifetime[i];
+    }
+#endif
+
+    // remove the dead by swapping the last live particle into their slot,
+    // the swapped in particle still needs checking so don't advance past it
+    for (u32 i = 0; i < ps->count;) {
+        if (ps->life[i] <= 0) {
+            particles_swap_remove(ps, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+void particles_draw(ParticleSystem *ps, Rectangle view) {
+    if (ps->count == 0) return;
+
+    // submit every visible particle as a quad in a single batch,
+    // flushing only when the batch buffer fills up
+    const u32 chunk_size = 1024;
+    const f32 view_x1 = view.x + view.width;
+    const f32 view_y1 = view.y + view.height;
+
+    rlSetTexture(rlGetTextureIdDefault());
+    rlBegin(RL_QUADS);
+    for (u32 i = 0; i < ps->count; i++) {
+        if ((i % chunk_size) == 0) {
+            rlCheckRenderBatchLimit(4 * chunk_size);
+        }
+
+        f32 half = ps->size[i] * 0.5f;
+        f32 x0 = ps->x[i] - half, x1 = ps->x[i] + half;
+        f32 y0 = ps->y[i] - half, y1 = ps->y[i] + half;
+        if (x1 < view.x || x0 > view_x1 || y1 < view.y || y0 > view_y1) continue;
+
+        Color color = ps->color[i];
+        rlColor4ub(color.r, color.g, color.b, (u8) (color.a * ps->fade[i]));
+        rlVertex2f(x0, y0);
+        rlVertex2f(x0, y1);
+        rlVertex2f(x1, y1);
+        rlVertex2f(x1, y0);
+    }
+    rlEnd();
+    rlSetTexture(0);
+}
@@ -0,0 +1,129 @@
+#include "game.h"
+#include "raygui.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Performance rings and overlay, see game.h
+
+internal const f32 PERF_ROW_HEIGHT = 20;
+internal const f32 PERF_HISTOGRAM_HEIGHT = 48;
+internal const f32 PERF_PANEL_WIDTH = 380;
+internal const f32 PERF_PADDING = 8;
+
+internal int perf_compare_samples(const void *a, const void *b) {
+    f32 x = *(const f32 *) a;
+    f32 y = *(const f32 *) b;
+    return (x > y) - (x < y);
+}
+
+// copy the most recent samples out of the ring, oldest first
+internal u32 perf_ring_read(PerfRing *ring, f32 *out) {
+    u32 head = ins_atomic_u32_eval(&ring->head);
+    u32 count = Min(head, PERF_RING_SIZE);
+    for (u32 i = 0; i < count; i++) {
+        out[i] = ring->samples[(head - count + i) % PERF_RING_SIZE];
+    }
+    return count;
+}
+
+internal void perf_draw_row(PerfStats *perf, Rectangle *row, const char *label, PerfMetric metric, f32 scale, const char *unit) {
+    PerfSummary summary = perf_summarize(perf, metric);
+    GuiLabel(*row, TextFormat("%-10s p50 %6.2f  p95 %6.2f  p99 %6.2f  max %6.2f %s", label,
+                              summary.p50 * scale, summary.p95 * scale, summary.p99 * scale, summary.max * scale, unit));
+    row->y += PERF_ROW_HEIGHT;
+}
+
+// one bar per sample, scaled to the slowest frame in the window, the line marks the target frame time
+internal void perf_draw_histogram(PerfStats *perf, Rectangle bounds) {
+    local_persist f32 samples[PERF_RING_SIZE];
+    u32 count = perf_ring_read(&perf->rings[PERF_FRAME], samples);
+
+    const f32 target = 1.0f / Max(state.window.target_fps, 1);
+    f32 max_sample = target;
+    for (u32 i = 0; i < count; i++) {
+        max_sample = Max(max_sample, samples[i]);
+    }
+
+    DrawRectangleRec(bounds, Fade(BLACK, 0.5f));
+    const f32 bar_width = bounds.width / PERF_RING_SIZE;
+    for (u32 i = 0; i < count; i++) {
+        f32 height = bounds.height * (samples[i] / max_sample);
+        f32 x = bounds.x + (PERF_RING_SIZE - count + i) * bar_width;
+        Color color = (samples[i] > target * 1.1f) ? RED : LIME;
+        DrawRectangleRec((Rectangle) {x, bounds.y + bounds.height - height, Max(bar_width, 1), height}, color);
+    }
+
+    f32 target_y = bounds.y + bounds.height * (1 - target / max_sample);
+    DrawLine(bounds.x, target_y, bounds.x + bounds.width, target_y, YELLOW);
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void perf_push(PerfStats *perf, PerfMetric metric, f32 sample) {
+    // single writer per ring: fill the slot, then publish it by bumping the head
+    PerfRing *ring = &perf->rings[metric];
+    u32 head = ring->head;
+    ring->samples[head % PERF_RING_SIZE] = sample;
+    ins_atomic_u32_eval_assign(&ring->head, head + 1);
+}
+
+PerfSummary perf_summarize(PerfStats *perf, PerfMetric metric) {
+    f32 samples[PERF_RING_SIZE];
+    u32 count = perf_ring_read(&perf->rings[metric], samples);
+    if (count == 0) return (PerfSummary) {0};
+
+    qsort(samples, count, sizeof(f32), perf_compare_samples);
+    return (PerfSummary) {
+        .p50 = samples[(count - 1) * 50 / 100],
+        .p95 = samples[(count - 1) * 95 / 100],
+        .p99 = samples[(count - 1) * 99 / 100],
+        .max = samples[count - 1],
+    };
+}
+
+void perf_draw_overlay(PerfStats *perf, Vector2 position) {
+    // title bar, 10 rows of text and the histogram
+    const u32 num_rows = 10;
+    Rectangle panel = {
+        position.x, position.y,
+        PERF_PANEL_WIDTH,
+        PERF_ROW_HEIGHT * (num_rows + 1) + PERF_HISTOGRAM_HEIGHT + 2.5f * PERF_PADDING
+    };
+    GuiPanel(panel, "perf");
+
+    Rectangle row = {
+        panel.x + PERF_PADDING,
+        panel.y + PERF_ROW_HEIGHT + PERF_PADDING,
+        panel.width - 2 * PERF_PADDING,
+        PERF_ROW_HEIGHT
+    };
+
+    perf_draw_row(perf, &row, "frame", PERF_FRAME, 1000, "ms");
+    perf_draw_histogram(perf, (Rectangle) {row.x, row.y, row.width, PERF_HISTOGRAM_HEIGHT});
+    row.y += PERF_HISTOGRAM_HEIGHT + PERF_PADDING / 2;
+
+    perf_draw_row(perf, &row, "sim tick", PERF_SIM_TICK, 1000, "ms");
+    perf_draw_row(perf, &row, "  move", PERF_SIM_MOVE, 1000, "ms");
+    perf_draw_row(perf, &row, "  overlap", PERF_SIM_OVERLAP, 1000, "ms");
+    perf_draw_row(perf, &row, "  events", PERF_SIM_EVENTS, 1000, "ms");
+    perf_draw_row(perf, &row, "checks", PERF_COLLISION_CHECKS, 1, "/tick");
+    perf_draw_row(perf, &row, "allocs", PERF_ALLOCATIONS, 1, "/frame");
+
+    u64 live_bytes = 0;
+    for (u32 tag = 0; tag < MEM_TAG_COUNT; tag++) {
+        live_bytes += mem_live_bytes(tag);
+    }
+    GuiLabel(row, TextFormat("live %.1f KB  steady state violations %u", live_bytes / 1024.0, mem_steady_state_violations()));
+    row.y += PERF_ROW_HEIGHT;
+
+    GuiLabel(row, TextFormat("entities %u  colliders %u",
+                             ins_atomic_u32_eval(&perf->num_entities), ins_atomic_u32_eval(&perf->num_colliders)));
+    row.y += PERF_ROW_HEIGHT;
+
+    const struct Resolution *resolution = &state.resolution;
+    GuiLabel(row, TextFormat("render scale %.2f  %dx%d  %s", resolution->scale,
+                             (i32) roundf(state.window.width * resolution->scale), (i32) roundf(state.window.height * resolution->scale),
+                             resolution->dynamic ? "dynamic" : "fixed"));
+}
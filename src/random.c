@@ -0,0 +1,156 @@
+#include "game.h"
+
+// ----------------------------------------------------------------------------
+// Random numbers, see game.h
+
+// streams of threads that never seed their own are told apart by the order they first asked for one
+internal const u64 RNG_THREAD_SEED = 0x5052304E47ull;
+global volatile u32 rng_threads_seeded = 0;
+
+thread_static Rng rng_thread_state;
+thread_static bool rng_thread_seeded = false;
+
+internal u64 rng_splitmix(u64 *x) {
+    u64 z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+#if SIMD_SSE2
+// one xoshiro128+ step of every lane, kept in registers for the length of a batch fill
+internal inline __m128i rng_step_lanes(__m128i *s0, __m128i *s1, __m128i *s2, __m128i *s3) {
+    __m128i result = _mm_add_epi32(*s0, *s3);
+    __m128i t = _mm_slli_epi32(*s1, 9);
+    *s2 = _mm_xor_si128(*s2, *s0);
+    *s3 = _mm_xor_si128(*s3, *s1);
+    *s1 = _mm_xor_si128(*s1, *s2);
+    *s0 = _mm_xor_si128(*s0, *s3);
+    *s2 = _mm_xor_si128(*s2, t);
+    *s3 = _mm_or_si128(_mm_slli_epi32(*s3, 11), _mm_srli_epi32(*s3, 21));
+    return result;
+}
+#endif
+
+// one step of every lane, the values come out in lane order
+internal void rng_step(Rng *rng, u32 *out) {
+#if SIMD_SSE2
+    __m128i s0 = _mm_loadu_si128((const __m128i *) rng->state[0]);
+    __m128i s1 = _mm_loadu_si128((const __m128i *) rng->state[1]);
+    __m128i s2 = _mm_loadu_si128((const __m128i *) rng->state[2]);
+    __m128i s3 = _mm_loadu_si128((const __m128i *) rng->state[3]);
+    _mm_storeu_si128((__m128i *) out, rng_step_lanes(&s0, &s1, &s2, &s3));
+    _mm_storeu_si128((__m128i *) rng->state[0], s0);
+    _mm_storeu_si128((__m128i *) rng->state[1], s1);
+    _mm_storeu_si128((__m128i *) rng->state[2], s2);
+    _mm_storeu_si128((__m128i *) rng->state[3], s3);
+#else
+    for (u32 lane = 0; lane < RNG_LANES; lane++) {
+        u32 s0 = rng->state[0][lane];
+        u32 s1 = rng->state[1][lane];
+        u32 s2 = rng->state[2][lane];
+        u32 s3 = rng->state[3][lane];
+        out[lane] = s0 + s3;
+
+        u32 t = s1 << 9;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = (s3 << 11) | (s3 >> 21);
+
+        rng->state[0][lane] = s0;
+        rng->state[1][lane] = s1;
+        rng->state[2][lane] = s2;
+        rng->state[3][lane] = s3;
+    }
+#endif
+}
+
+// the top 24 bits, exactly representable as a float, scaled by `scale` and moved by `bias`
+internal void rng_fill(Rng *rng, f32 *out, u32 count, f32 scale, f32 bias) {
+    const f32 unit = scale / (f32) (1 << 24);
+    u32 i = 0;
+#if SIMD_SSE2
+    const __m128 v_unit = _mm_set1_ps(unit);
+    const __m128 v_bias = _mm_set1_ps(bias);
+    __m128i s0 = _mm_loadu_si128((const __m128i *) rng->state[0]);
+    __m128i s1 = _mm_loadu_si128((const __m128i *) rng->state[1]);
+    __m128i s2 = _mm_loadu_si128((const __m128i *) rng->state[2]);
+    __m128i s3 = _mm_loadu_si128((const __m128i *) rng->state[3]);
+    for (; i + RNG_LANES <= count; i += RNG_LANES) {
+        __m128i bits = _mm_srli_epi32(rng_step_lanes(&s0, &s1, &s2, &s3), 8);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(bits), v_unit), v_bias));
+    }
+    _mm_storeu_si128((__m128i *) rng->state[0], s0);
+    _mm_storeu_si128((__m128i *) rng->state[1], s1);
+    _mm_storeu_si128((__m128i *) rng->state[2], s2);
+    _mm_storeu_si128((__m128i *) rng->state[3], s3);
+#else
+    u32 values[RNG_LANES];
+    for (; i + RNG_LANES <= count; i += RNG_LANES) {
+        rng_step(rng, values);
+        for (u32 lane = 0; lane < RNG_LANES; lane++) {
+            out[i + lane] = (f32) (values[lane] >> 8) * unit + bias;
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = (f32) (rng_next_u32(rng) >> 8) * unit + bias;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void rng_seed(Rng *rng, u64 seed) {
+    *rng = (Rng) {0};
+    for (u32 lane = 0; lane < RNG_LANES; lane++) {
+        u64 a = rng_splitmix(&seed);
+        u64 b = rng_splitmix(&seed);
+        rng->state[0][lane] = (u32) a;
+        rng->state[1][lane] = (u32) (a >> 32);
+        rng->state[2][lane] = (u32) b;
+        rng->state[3][lane] = (u32) (b >> 32);
+
+        // xoshiro never leaves an all zero state
+        if ((a | b) == 0) rng->state[0][lane] = 1;
+    }
+}
+
+u32 rng_next_u32(Rng *rng) {
+    if (rng->num_buffered == 0) {
+        rng_step(rng, rng->buffered);
+        rng->num_buffered = RNG_LANES;
+    }
+    return rng->buffered[RNG_LANES - rng->num_buffered--];
+}
+
+f32 rng_unit(Rng *rng) {
+    return (f32) (rng_next_u32(rng) >> 8) / (f32) (1 << 24);
+}
+
+f32 rng_signed(Rng *rng) {
+    return (f32) (rng_next_u32(rng) >> 8) / (f32) (1 << 23) - 1.0f;
+}
+
+void rng_fill_unit(Rng *rng, f32 *out, u32 count) {
+    rng_fill(rng, out, count, 1.0f, 0.0f);
+}
+
+void rng_fill_signed(Rng *rng, f32 *out, u32 count) {
+    rng_fill(rng, out, count, 2.0f, -1.0f);
+}
+
+Rng *rng_thread() {
+    if (!rng_thread_seeded) {
+        rng_seed_thread(RNG_THREAD_SEED + ins_atomic_u32_add_eval(&rng_threads_seeded, 1));
+    }
+    return &rng_thread_state;
+}
+
+void rng_seed_thread(u64 seed) {
+    rng_seed(&rng_thread_state, seed);
+    rng_thread_seeded = true;
+}
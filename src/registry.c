@@ -0,0 +1,195 @@
+#include "game.h"
+
+// ----------------------------------------------------------------------------
+// Runtime component registry, every registered component lives in its own sparse set:
+// - a paged sparse array maps entity -> dense index, pages only exist where entities have the component
+// - dense arrays pack the owning entities and their data back to back for iteration
+// removing a component swaps the last dense element into the hole so the dense arrays stay packed
+
+internal ComponentStore *registry_store(ComponentId id) {
+    bool is_registered = id >= COMPONENT_BUILTIN_COUNT && (id - COMPONENT_BUILTIN_COUNT) < arrlen(world->registry.stores);
+    return is_registered ? &world->registry.stores[id - COMPONENT_BUILTIN_COUNT] : NULL;
+}
+
+internal u32 *registry_sparse_slot(ComponentStore *store, Entity entity, bool create) {
+    u32 page = entity / SPARSE_PAGE_SIZE;
+    u32 slot = entity % SPARSE_PAGE_SIZE;
+
+    if (page >= arrlen(store->sparse_pages)) {
+        if (!create) return NULL;
+
+        u32 prev_num_pages = arrlen(store->sparse_pages);
+        arrsetlen(store->sparse_pages, page + 1);
+        for (u32 i = prev_num_pages; i <= page; i++) {
+            store->sparse_pages[i] = NULL;
+        }
+    }
+
+    if (store->sparse_pages[page] == NULL) {
+        if (!create) return NULL;
+
+        arrsetlen(store->sparse_pages[page], SPARSE_PAGE_SIZE);
+        memset(store->sparse_pages[page], 0, SPARSE_PAGE_SIZE * sizeof(u32));
+    }
+
+    return &store->sparse_pages[page][slot];
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void world_remap_registry(const Entity *remap) {
+    // dense order is kept, only the ids and the sparse lookups change
+    MemTag prev_tag = mem_set_tag(MEM_TAG_REGISTRY);
+    for (u32 s = 0; s < arrlen(world->registry.stores); s++) {
+        ComponentStore *store = &world->registry.stores[s];
+        for (u32 page = 0; page < arrlen(store->sparse_pages); page++) {
+            if (store->sparse_pages[page]) {
+                memset(store->sparse_pages[page], 0, SPARSE_PAGE_SIZE * sizeof(u32));
+            }
+        }
+        for (u32 i = 0; i < store->count; i++) {
+            Entity entity = remap[store->dense_entities[i]];
+            store->dense_entities[i] = entity;
+            *registry_sparse_slot(store, entity, true) = i + 1;
+        }
+    }
+    mem_set_tag(prev_tag);
+}
+
+ComponentId world_register_component(const char *name, u32 element_size) {
+    ComponentId existing = world_find_component(name);
+    if (existing != COMPONENT_ID_INVALID) {
+        return existing;
+    }
+
+    ComponentId id = COMPONENT_BUILTIN_COUNT + arrlen(world->registry.stores);
+    if (id >= COMPONENT_MAX) {
+        TraceLog(LOG_ERROR, "registry: can't register component '%s', all %d component ids are in use", name, COMPONENT_MAX);
+        return COMPONENT_ID_INVALID;
+    }
+
+    ComponentStore store = {
+        .name = name,
+        .element_size = element_size,
+    };
+    MemTag prev_tag = mem_set_tag(MEM_TAG_REGISTRY);
+    arrput(world->registry.stores, store);
+    mem_set_tag(prev_tag);
+    return id;
+}
+
+ComponentId world_find_component(const char *name) {
+    for (u32 i = 0; i < arrlen(world->registry.stores); i++) {
+        if (strcmp(world->registry.stores[i].name, name) == 0) {
+            return COMPONENT_BUILTIN_COUNT + i;
+        }
+    }
+    return COMPONENT_ID_INVALID;
+}
+
+u32 world_component_count(ComponentId id) {
+    ComponentStore *store = registry_store(id);
+    return store ? store->count : 0;
+}
+
+Entity *world_component_entities(ComponentId id) {
+    ComponentStore *store = registry_store(id);
+    return store ? store->dense_entities : NULL;
+}
+
+void *world_component_data(ComponentId id) {
+    ComponentStore *store = registry_store(id);
+    return store ? store->dense_data : NULL;
+}
+
+void *entity_add_component(Entity entity, ComponentId id) {
+    // a stale or made up handle would get a sparse page and a signature write past the columns
+    if (entity == ENTITY_NONE || entity >= world->num_entities || !world->infos.in_use[entity]) return NULL;
+
+    ComponentStore *store = registry_store(id);
+    if (!store) return NULL;
+
+    MemTag prev_tag = mem_set_tag(MEM_TAG_REGISTRY);
+
+    // adding a component the entity already has just hands back the existing data
+    u32 *slot = registry_sparse_slot(store, entity, true);
+    if (*slot != 0) {
+        mem_set_tag(prev_tag);
+        return store->dense_data + (*slot - 1) * store->element_size;
+    }
+
+    u32 index = store->count++;
+    arrput(store->dense_entities, entity);
+    u8 *data = arraddnptr(store->dense_data, store->element_size);
+    memset(data, 0, store->element_size);
+    mem_set_tag(prev_tag);
+
+    *slot = index + 1;
+    signature_set(&world->infos.signatures[entity], id);
+    return data;
+}
+
+void *entity_get_component(Entity entity, ComponentId id) {
+    ComponentStore *store = registry_store(id);
+    if (!store) return NULL;
+
+    u32 *slot = registry_sparse_slot(store, entity, false);
+    if (!slot || *slot == 0) return NULL;
+
+    return store->dense_data + (*slot - 1) * store->element_size;
+}
+
+void entity_remove_component(Entity entity, ComponentId id) {
+    ComponentStore *store = registry_store(id);
+    if (!store) return;
+
+    u32 *slot = registry_sparse_slot(store, entity, false);
+    if (!slot || *slot == 0) return;
+
+    // swap the last element into the removed one's place
+    u32 index = *slot - 1;
+    u32 last = store->count - 1;
+    if (index != last) {
+        Entity moved = store->dense_entities[last];
+        store->dense_entities[index] = moved;
+        memcpy(store->dense_data + index * store->element_size,
+               store->dense_data + last * store->element_size,
+               store->element_size);
+        *registry_sparse_slot(store, moved, false) = index + 1;
+    }
+
+    *slot = 0;
+    store->count--;
+    arrsetlen(store->dense_entities, store->count);
+    arrsetlen(store->dense_data, store->count * store->element_size);
+    signature_clear(&world->infos.signatures[entity], id);
+}
+
+bool entity_has_component(Entity entity, ComponentId id) {
+    if (entity >= world->num_entities || id >= COMPONENT_MAX) return false;
+    return signature_test(&world->infos.signatures[entity], id);
+}
+
+bool entity_has_signature(Entity entity, const ComponentSignature *signature) {
+    if (entity >= world->num_entities) return false;
+
+    const ComponentSignature *has = &world->infos.signatures[entity];
+    for (u32 i = 0; i < ArrayCount(signature->bits); i++) {
+        if ((has->bits[i] & signature->bits[i]) != signature->bits[i]) return false;
+    }
+    return true;
+}
+
+void world_cleanup_registry() {
+    for (u32 i = 0; i < arrlen(world->registry.stores); i++) {
+        ComponentStore *store = &world->registry.stores[i];
+        for (u32 page = 0; page < arrlen(store->sparse_pages); page++) {
+            arrfree(store->sparse_pages[page]);
+        }
+        arrfree(store->sparse_pages);
+        arrfree(store->dense_entities);
+        arrfree(store->dense_data);
+    }
+    arrfree(world->registry.stores);
+}
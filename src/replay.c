@@ -0,0 +1,732 @@
+#include "game.h"
+#include "os.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Replay runner, steps the arena through a scripted input stream without a window
+// and checksums the world after every tick, for desync and regression checks
+// usage: prong_replay [num_ticks] [seed]                  run the replay twice, both runs must match and
+//                                                          neither may allocate once warmed up, see mem.h
+//        prong_replay [num_ticks] [seed] record <file>    save the per-tick checksums
+//        prong_replay [num_ticks] [seed] verify <file>    compare against a saved run, eg. from another build
+//        prong_replay [num_ticks] [seed] pile             drop a pile of balls into a box, see pile_run()
+//        prong_replay [num_ticks] [seed] queries          spatial queries against a scan of every entity, see queries_run()
+//        prong_replay [num_ticks] [seed] compact          compact the entities every couple of seconds, see
+//                                                          replay_compact()
+
+#define REPLAY_MAGIC 0x4B435250 // 'PRCK'
+#define REPLAY_VERSION 1
+
+internal const f32 REPLAY_DT = 1.0f / 60;
+internal const i32 REPLAY_ARENA_WIDTH = 1280;
+internal const i32 REPLAY_ARENA_HEIGHT = 720;
+// loose balls dropped into the arena so contacts and sleeping are part of the replay too
+internal const u32 REPLAY_NUM_BALLS = 64;
+// the same warmup the game gives gameplay before it flags a steady state
+internal const u32 REPLAY_WARMUP_TICKS = 120;
+// shorter than the game's so a run goes through plenty of passes, but past the warmup so the first
+// one is like compaction being switched on mid game
+internal const u32 REPLAY_COMPACT_INTERVAL_TICKS = 131;
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 num_ticks;
+    u32 num_columns;
+    u64 seed;
+} ReplayHeader;
+
+typedef struct {
+    World world;
+    Arena arena;
+    u64 rng;
+    // one per tick, after that tick's world_update()
+    WorldChecksum *checksums;
+    // the same, but blind to which id each entity has, see replay_state_hash()
+    u64 *state_hashes;
+    // compaction passes that changed an entity or lost track of one of the arena's
+    u32 compaction_failures;
+} Replay;
+
+// what an entity is, without which id it's at
+typedef struct {
+    ComponentMask components;
+    i32 x;
+    i32 y;
+    f32 vel_x;
+    f32 vel_y;
+    f32 remainder_x;
+    f32 remainder_y;
+    f32 sleep_seconds;
+    u32 radius;
+    bool asleep;
+} ReplayEntityState;
+
+// xorshift64*, the same stream for a given seed on every platform
+internal u32 replay_random(Replay *replay, u32 range) {
+    u64 x = replay->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    replay->rng = x;
+    return (u32) ((x * 0x2545F4914F6CDD1Dull) >> 32) % range;
+}
+
+internal void ReplayBallHitX(Entity entity, Entity collided_with) {
+    world->movements.vel_x[entity] *= -1;
+    world->movements.remainder_x[entity] = 0;
+}
+
+internal void ReplayBallHitY(Entity entity, Entity collided_with) {
+    world->movements.vel_y[entity] *= -1;
+    world->movements.remainder_y[entity] = 0;
+}
+
+internal u64 replay_entity_hash(Entity entity) {
+    // zeroed so the padding hashes the same every time
+    ReplayEntityState state;
+    memset(&state, 0, sizeof(state));
+    state.components = world->infos.components[entity];
+    if (state.components & COMPONENT_POSITION) {
+        state.x = world->positions.x[entity];
+        state.y = world->positions.y[entity];
+    }
+    if (state.components & COMPONENT_MOVEMENT) {
+        state.vel_x = world->movements.vel_x[entity];
+        state.vel_y = world->movements.vel_y[entity];
+        state.remainder_x = world->movements.remainder_x[entity];
+        state.remainder_y = world->movements.remainder_y[entity];
+        state.sleep_seconds = world->movements.sleep_seconds[entity];
+        state.asleep = world->movements.asleep[entity];
+    }
+    if (state.components & COMPONENT_COLLIDER) {
+        state.radius = world->colliders.radius[entity];
+    }
+    return checksum_bytes(&state, sizeof(state), 0);
+}
+
+// a sum of per entity hashes, so it doesn't change when the entities only swap ids
+internal u64 replay_state_hash() {
+    u64 hash = 0;
+    for (Entity entity = 1; entity < world->num_entities; entity++) {
+        if (world->infos.in_use[entity]) hash += replay_entity_hash(entity);
+    }
+    return hash;
+}
+
+// the arena's entities in a fixed order, whatever ids they're at
+internal u64 replay_arena_hash(const Arena *arena) {
+    Entity entities[] = {arena->ball, arena->paddle, arena->bounds_l, arena->bounds_r, arena->bounds_t, arena->bounds_b};
+    u64 hashes[ArrayCount(entities)];
+    for (u32 i = 0; i < ArrayCount(entities); i++) {
+        hashes[i] = replay_entity_hash(entities[i]);
+    }
+    return checksum_bytes(hashes, sizeof(hashes), 0);
+}
+
+// a pass between updates, like the game's compaction system. it may move entities to new ids
+// but can't change anything about them
+internal void replay_compact(Replay *replay, u32 tick) {
+    u64 state_before = replay_state_hash();
+    u64 arena_before = replay_arena_hash(&replay->arena);
+    if (world_compact_entities()) {
+        arena_remap(&replay->arena);
+    }
+
+    if (replay_state_hash() != state_before) {
+        printf("compaction at tick %u changed the entities\n", tick);
+        replay->compaction_failures++;
+    } else if (replay_arena_hash(&replay->arena) != arena_before) {
+        printf("compaction at tick %u lost track of the arena's entities\n", tick);
+        replay->compaction_failures++;
+    }
+}
+
+// compact_interval 0 never compacts
+internal void replay_run(Replay *replay, u32 num_ticks, u64 seed, u32 compact_interval) {
+    *replay = (Replay) {0};
+    replay->rng = seed ? seed : 1;
+    arrsetcap(replay->checksums, num_ticks);
+    arrsetcap(replay->state_hashes, num_ticks);
+
+    world = &replay->world;
+    world_init();
+    world->collect_checksums = true;
+
+    arena_create(&replay->arena, REPLAY_ARENA_WIDTH, REPLAY_ARENA_HEIGHT);
+    world->colliders.on_hit_x[replay->arena.ball] = ReplayBallHitX;
+    world->colliders.on_hit_y[replay->arena.ball] = ReplayBallHitY;
+    arena_reset(&replay->arena, (f32) replay_random(replay, 600) - 300, -200 - (f32) replay_random(replay, 100));
+
+    for (u32 i = 0; i < REPLAY_NUM_BALLS; i++) {
+        Entity ball = world_create_entity();
+        entity_add_position(ball, (i32) replay_random(replay, REPLAY_ARENA_WIDTH - 100) - REPLAY_ARENA_WIDTH / 2 + 50,
+                                  (i32) replay_random(replay, REPLAY_ARENA_HEIGHT / 2));
+        entity_add_velocity(ball, (f32) replay_random(replay, 200) - 100, 0, 0, -400);
+        entity_set_body(ball, 1, 0.3f, 0.5f);
+        entity_add_collider_circ(ball, MASK_BALL, 0, 0, 6 + replay_random(replay, 10));
+    }
+
+    // the input script: hold a random direction for a random number of ticks
+    u32 action = 0;
+    u32 action_ticks = 0;
+    for (u32 tick = 0; tick < num_ticks; tick++) {
+        if (action_ticks == 0) {
+            action = replay_random(replay, 3);
+            action_ticks = 1 + replay_random(replay, 30);
+        }
+        action_ticks--;
+
+        mem_set_steady_state(tick >= REPLAY_WARMUP_TICKS);
+        arena_update_paddle(&replay->arena, action == 1, action == 2, REPLAY_DT);
+        world_update(REPLAY_DT);
+
+        if (compact_interval > 0) {
+            world_reserve_compaction();
+            if (tick % compact_interval == compact_interval - 1) replay_compact(replay, tick);
+        }
+        arrput(replay->checksums, world->checksum);
+        arrput(replay->state_hashes, replay_state_hash());
+    }
+    mem_set_steady_state(false);
+}
+
+// ----------------------------------------------------------------------------
+// Pile scenario, the contact solver's resting behaviour: balls are dropped into a narrow box
+// and have to end up asleep without having sunk into each other or the floor. The floor is
+// two overlapping tilemap layers, so every ball on it touches the same cell index of two maps
+
+internal const u32 PILE_NUM_BALLS = 200;
+internal const u32 PILE_BALLS_PER_ROW = 16;
+internal const i32 PILE_WIDTH = 320;
+internal const i32 PILE_HEIGHT = 640;
+internal const i32 PILE_WALL_SIZE = 32;
+internal const u32 PILE_CELL_SIZE = 16;
+internal const u32 PILE_BALL_RADIUS = 8;
+// pass thresholds, the pile has to be asleep by the end and can't be sunk in further than this
+internal const f32 PILE_MAX_OVERLAP = 6;
+
+// how far a circle reaches into a rect, negative when they're apart
+internal f32 pile_circle_rect_overlap(Rectangle circle, Rectangle rect) {
+    f32 radius = circle.width / 2;
+    f32 center_x = circle.x + radius;
+    f32 center_y = circle.y + radius;
+    f32 dx = center_x - Clamp(rect.x, center_x, rect.x + rect.width);
+    f32 dy = center_y - Clamp(rect.y, center_y, rect.y + rect.height);
+    return radius - sqrtf(dx * dx + dy * dy);
+}
+
+internal void pile_add_floor_layer(i32 x, i32 y, u32 cols) {
+    Entity layer = world_create_entity();
+    entity_add_position(layer, x, y);
+    entity_add_collider_tilemap(layer, MASK_BOUNDS, 0, 0, PILE_CELL_SIZE, cols, 2);
+    for (u32 col = 0; col < cols; col++) {
+        entity_set_tile(layer, col, 0, true);
+        entity_set_tile(layer, col, 1, true);
+    }
+}
+
+internal void pile_add_wall(i32 center_x) {
+    Entity wall = world_create_entity();
+    entity_add_position(wall, center_x, 0);
+    entity_add_collider_rect(wall, MASK_BOUNDS, -PILE_WALL_SIZE / 2, -PILE_HEIGHT, PILE_WALL_SIZE, 2 * PILE_HEIGHT);
+}
+
+// returns whether the pile came to rest within num_ticks, without sinking in past PILE_MAX_OVERLAP
+internal bool pile_run(Replay *replay, u32 num_ticks, u64 seed) {
+    *replay = (Replay) {0};
+    replay->rng = seed ? seed : 1;
+
+    world = &replay->world;
+    world_init();
+
+    // the interior is centered on x = 0 and its floor is at y = -PILE_HEIGHT / 2, gravity pulls towards it
+    const i32 floor_y = -PILE_HEIGHT / 2;
+    const u32 floor_cols = (PILE_WIDTH + 2 * PILE_WALL_SIZE) / PILE_CELL_SIZE;
+    pile_add_floor_layer(-PILE_WIDTH / 2 - PILE_WALL_SIZE, floor_y - 2 * (i32) PILE_CELL_SIZE, floor_cols);
+    pile_add_floor_layer(-PILE_WIDTH / 2 - PILE_WALL_SIZE, floor_y - 2 * (i32) PILE_CELL_SIZE, floor_cols);
+    pile_add_wall(-PILE_WIDTH / 2 - PILE_WALL_SIZE / 2);
+    pile_add_wall(PILE_WIDTH / 2 + PILE_WALL_SIZE / 2);
+
+    const i32 spacing = PILE_WIDTH / PILE_BALLS_PER_ROW;
+    Entity first_ball = world->num_entities;
+    for (u32 i = 0; i < PILE_NUM_BALLS; i++) {
+        u32 col = i % PILE_BALLS_PER_ROW;
+        u32 row = i / PILE_BALLS_PER_ROW;
+        Entity ball = world_create_entity();
+        entity_add_position(ball, -PILE_WIDTH / 2 + spacing / 2 + col * spacing + (i32) replay_random(replay, 3) - 1,
+                                  floor_y + 2 * (i32) PILE_BALL_RADIUS + row * (spacing + 4));
+        entity_add_velocity(ball, (f32) replay_random(replay, 40) - 20, 0, 0, -400);
+        entity_set_body(ball, 1, 0.2f, 0.5f);
+        entity_add_collider_circ(ball, MASK_BALL, 0, 0, PILE_BALL_RADIUS);
+    }
+    Entity end_ball = first_ball + PILE_NUM_BALLS;
+
+    // the first tick from which every ball stayed asleep to the end
+    u32 settled_tick = num_ticks;
+    for (u32 tick = 0; tick < num_ticks; tick++) {
+        world_update(REPLAY_DT);
+
+        bool all_asleep = true;
+        for (Entity ball = first_ball; ball < end_ball && all_asleep; ball++) {
+            all_asleep = world->movements.asleep[ball];
+        }
+        if (!all_asleep) settled_tick = num_ticks;
+        else if (settled_tick == num_ticks) settled_tick = tick;
+    }
+
+    // worst overlap left between any two balls, or a ball and the box
+    f32 worst_overlap = 0;
+    for (Entity ball = first_ball; ball < end_ball; ball++) {
+        Rectangle bounds = {0};
+        entity_get_bounds(ball, &bounds);
+        for (Entity other = 1; other < end_ball; other++) {
+            if (other == ball) continue;
+
+            Rectangle other_bounds = {0};
+            entity_get_bounds(other, &other_bounds);
+            f32 overlap = 0;
+            if (other >= first_ball) {
+                f32 dx = (bounds.x + bounds.width / 2) - (other_bounds.x + other_bounds.width / 2);
+                f32 dy = (bounds.y + bounds.height / 2) - (other_bounds.y + other_bounds.height / 2);
+                overlap = (bounds.width + other_bounds.width) / 2 - sqrtf(dx * dx + dy * dy);
+            } else {
+                // the floor layers are solid all the way through, so their bounds are their cells
+                overlap = pile_circle_rect_overlap(bounds, other_bounds);
+            }
+            worst_overlap = Max(worst_overlap, overlap);
+        }
+    }
+
+    bool settled = settled_tick < num_ticks;
+    if (settled) {
+        printf("pile: %u balls asleep after %.2f s, worst overlap %.2f px\n",
+               PILE_NUM_BALLS, (settled_tick + 1) * REPLAY_DT, worst_overlap);
+    } else {
+        printf("pile: still awake after %.2f s, worst overlap %.2f px\n", num_ticks * REPLAY_DT, worst_overlap);
+    }
+    return settled && worst_overlap <= PILE_MAX_OVERLAP;
+}
+
+internal void replay_free(Replay *replay) {
+    world = &replay->world;
+    world_cleanup();
+    arrfree(replay->checksums);
+    arrfree(replay->state_hashes);
+}
+
+// ----------------------------------------------------------------------------
+// Spatial query scenario, the batched queries (see world_query_aabb()) against a scan of every
+// entity. The replay is stopped at a few points on its way to num_ticks and every kind of query is
+// thrown at the world from random places, a third of them on whole pixels and rays on whole pixels
+// going along an axis, so edges that only just touch come up as often as they do in the game
+
+internal const u32 QUERIES_CHECKPOINTS = 4;
+internal const u32 QUERIES_PER_KIND = 2048;
+// small enough for crowded queries to overflow, so what gets dropped is checked too
+internal const u32 QUERIES_MAX_RESULTS = 8;
+// the scan's ray tests are its own and round differently, distances only have to be this close
+internal const f32 QUERIES_DISTANCE_TOLERANCE = 1e-3f;
+// anywhere over the arena and a bit past its bounds
+internal const f32 QUERIES_EXTENT = 720;
+
+typedef struct {
+    Entity entity;
+    f32 distance;
+} QueriesRayHit;
+
+internal f32 queries_random(Replay *replay, f32 min, f32 max) {
+    return min + (max - min) * (f32) replay_random(replay, 1 << 16) / (f32) (1 << 16);
+}
+
+internal f32 queries_coordinate(Replay *replay, bool snap) {
+    f32 v = queries_random(replay, -QUERIES_EXTENT, QUERIES_EXTENT);
+    return snap ? floorf(v) : v;
+}
+
+internal CollisionMask queries_mask(Replay *replay) {
+    return (CollisionMask) (1 + replay_random(replay, MASK_BALL | MASK_PADDLE | MASK_BOUNDS));
+}
+
+internal Entity queries_ignore(Replay *replay) {
+    return (replay_random(replay, 4) == 0) ? 1 + replay_random(replay, world->num_entities - 1) : ENTITY_NONE;
+}
+
+internal bool queries_circle_rect(Vector2 center, f32 radius, f32 x0, f32 y0, f32 x1, f32 y1) {
+    f32 dx = center.x - Clamp(x0, center.x, x1);
+    f32 dy = center.y - Clamp(y0, center.y, y1);
+    return dx * dx + dy * dy <= radius * radius;
+}
+
+// whether a shape query finds the entity, by the rules in game.h: touching counts and circles are
+// positioned by their center. the replay world only has circles and rects
+internal bool queries_scan_shape(Entity entity, CollisionMask mask, Entity ignore, bool is_circle, Vector2 center, f32 radius,
+                                 f32 x0, f32 y0, f32 x1, f32 y1) {
+    if (entity == ignore || !entity_has_components(entity, COMPONENT_POSITION | COMPONENT_COLLIDER)) return false;
+    if ((world->colliders.mask[entity] & mask) == 0) return false;
+
+    f32 x = world->positions.x[entity] + world->colliders.offset_x[entity];
+    f32 y = world->positions.y[entity] + world->colliders.offset_y[entity];
+    if (world->colliders.shape[entity] == SHAPE_CIRC) {
+        f32 r = world->colliders.radius[entity];
+        if (!is_circle) return queries_circle_rect((Vector2) {x, y}, r, x0, y0, x1, y1);
+
+        f32 dx = x - center.x;
+        f32 dy = y - center.y;
+        return dx * dx + dy * dy <= (r + radius) * (r + radius);
+    }
+
+    f32 w = world->colliders.width[entity];
+    f32 h = world->colliders.height[entity];
+    if (x > x1 || x + w < x0 || y > y1 || y + h < y0) return false;
+    return !is_circle || queries_circle_rect(center, radius, x, y, x + w, y + h);
+}
+
+// where a normalized ray first meets the entity, 0 when it starts inside
+internal bool queries_scan_ray(Entity entity, const RayQuery *ray, Vector2 dir, f32 *distance) {
+    if (entity == ray->ignore || !entity_has_components(entity, COMPONENT_POSITION | COMPONENT_COLLIDER)) return false;
+    if ((world->colliders.mask[entity] & ray->mask) == 0) return false;
+
+    f32 x = world->positions.x[entity] + world->colliders.offset_x[entity];
+    f32 y = world->positions.y[entity] + world->colliders.offset_y[entity];
+    if (world->colliders.shape[entity] == SHAPE_CIRC) {
+        f32 r = world->colliders.radius[entity];
+        f32 mx = ray->origin.x - x;
+        f32 my = ray->origin.y - y;
+        if (mx * mx + my * my <= r * r) {
+            *distance = 0;
+            return true;
+        }
+        f32 b = mx * dir.x + my * dir.y;
+        f32 hx = mx - b * dir.x;
+        f32 hy = my - b * dir.y;
+        f32 disc = r * r - (hx * hx + hy * hy);
+        if (b > 0 || disc < 0) return false;
+        *distance = -b - sqrtf(disc);
+        return *distance <= ray->max_distance;
+    }
+
+    // slabs, a ray running along an edge is on the box
+    const f32 o[2] = {ray->origin.x, ray->origin.y};
+    const f32 d[2] = {dir.x, dir.y};
+    const f32 lo[2] = {x, y};
+    const f32 hi[2] = {x + world->colliders.width[entity], y + world->colliders.height[entity]};
+    f32 t_near = 0;
+    f32 t_far = ray->max_distance;
+    for (u32 axis = 0; axis < 2; axis++) {
+        if (d[axis] == 0) {
+            if (o[axis] < lo[axis] || o[axis] > hi[axis]) return false;
+            continue;
+        }
+        f32 t0 = (lo[axis] - o[axis]) / d[axis];
+        f32 t1 = (hi[axis] - o[axis]) / d[axis];
+        t_near = Max(t_near, Min(t0, t1));
+        t_far = Min(t_far, Max(t0, t1));
+    }
+    *distance = t_near;
+    return t_near <= t_far;
+}
+
+// the index's answer to one shape query against the scan's, `found` holds counts[i] entities
+internal bool queries_check_shape(const char *kind, u32 query, const Entity *found, u32 count,
+                                  const Entity *expected, u32 num_expected) {
+    bool ok = count == Min(num_expected, QUERIES_MAX_RESULTS);
+    for (u32 i = 0; i < count && ok; i++) {
+        // every entity once, and only ones the scan found too
+        bool listed = false;
+        for (u32 j = 0; j < num_expected && !listed; j++) listed = expected[j] == found[i];
+        for (u32 j = 0; j < i && ok; j++) ok = found[j] != found[i];
+        ok = ok && listed;
+    }
+    if (!ok) {
+        printf("queries: %s query %u found %u entities, the scan %u\n", kind, query, count, num_expected);
+    }
+    return ok;
+}
+
+internal bool queries_check_world(Replay *replay) {
+    const u32 n = QUERIES_PER_KIND;
+    const u32 max = QUERIES_MAX_RESULTS;
+    AabbQuery *boxes = calloc(n, sizeof(AabbQuery));
+    CircleQuery *circles = calloc(n, sizeof(CircleQuery));
+    RayQuery *rays = calloc(n, sizeof(RayQuery));
+    Entity *results = calloc((u64) n * max, sizeof(Entity));
+    RayHit *hits = calloc((u64) n * max, sizeof(RayHit));
+    RayHit *nearest = calloc(n, sizeof(RayHit));
+    u32 *counts = calloc(n, sizeof(u32));
+    Entity *expected = calloc(world->num_entities, sizeof(Entity));
+    QueriesRayHit *expected_hits = calloc(world->num_entities, sizeof(QueriesRayHit));
+
+    for (u32 i = 0; i < n; i++) {
+        bool snap = replay_random(replay, 3) == 0;
+        f32 x = queries_coordinate(replay, snap);
+        f32 y = queries_coordinate(replay, snap);
+        f32 w = queries_random(replay, 0, 200);
+        f32 h = queries_random(replay, 0, 200);
+        boxes[i] = (AabbQuery) {{x, y, snap ? floorf(w) : w, snap ? floorf(h) : h}, queries_mask(replay), queries_ignore(replay)};
+
+        f32 r = queries_random(replay, 0, 150);
+        circles[i] = (CircleQuery) {{queries_coordinate(replay, snap), queries_coordinate(replay, snap)}, snap ? floorf(r) : r,
+                                    queries_mask(replay), queries_ignore(replay)};
+
+        f32 angle = queries_random(replay, 0, 2 * PI);
+        Vector2 direction = {cosf(angle), sinf(angle)};
+        if (snap) {
+            u32 axis = replay_random(replay, 4);
+            direction = (Vector2) {(axis == 0) - (axis == 1), (axis == 2) - (axis == 3)};
+        }
+        rays[i] = (RayQuery) {{queries_coordinate(replay, snap), queries_coordinate(replay, snap)}, direction,
+                              queries_random(replay, 0, 1500), queries_mask(replay), queries_ignore(replay)};
+    }
+
+    u32 failures = 0;
+    u32 expected_overflows = 0;
+    u32 overflows = world_query_aabb(boxes, n, results, max, counts);
+    for (u32 i = 0; i < n; i++) {
+        Rectangle b = boxes[i].bounds;
+        u32 num_expected = 0;
+        for (Entity entity = 1; entity < world->num_entities; entity++) {
+            if (queries_scan_shape(entity, boxes[i].mask, boxes[i].ignore, false, (Vector2) {0}, 0, b.x, b.y, b.x + b.width, b.y + b.height)) {
+                expected[num_expected++] = entity;
+            }
+        }
+        expected_overflows += num_expected > max;
+        failures += !queries_check_shape("aabb", i, results + (u64) i * max, counts[i], expected, num_expected);
+    }
+    if (overflows != expected_overflows) {
+        printf("queries: %u aabb queries overflowed, the scan says %u\n", overflows, expected_overflows);
+        failures++;
+    }
+
+    expected_overflows = 0;
+    overflows = world_query_circle(circles, n, results, max, counts);
+    for (u32 i = 0; i < n; i++) {
+        Vector2 c = circles[i].center;
+        f32 r = circles[i].radius;
+        u32 num_expected = 0;
+        for (Entity entity = 1; entity < world->num_entities; entity++) {
+            if (queries_scan_shape(entity, circles[i].mask, circles[i].ignore, true, c, r, c.x - r, c.y - r, c.x + r, c.y + r)) {
+                expected[num_expected++] = entity;
+            }
+        }
+        expected_overflows += num_expected > max;
+        failures += !queries_check_shape("circle", i, results + (u64) i * max, counts[i], expected, num_expected);
+    }
+    if (overflows != expected_overflows) {
+        printf("queries: %u circle queries overflowed, the scan says %u\n", overflows, expected_overflows);
+        failures++;
+    }
+
+    // every hit of a ray, nearest first, and the nearest one on its own has to be the first of them
+    expected_overflows = 0;
+    overflows = world_raycast_all(rays, n, hits, max, counts);
+    world_raycast(rays, n, nearest);
+    for (u32 i = 0; i < n; i++) {
+        f32 length = sqrtf(rays[i].direction.x * rays[i].direction.x + rays[i].direction.y * rays[i].direction.y);
+        Vector2 dir = {rays[i].direction.x / length, rays[i].direction.y / length};
+        u32 num_expected = 0;
+        for (Entity entity = 1; entity < world->num_entities; entity++) {
+            f32 distance;
+            if (queries_scan_ray(entity, &rays[i], dir, &distance)) {
+                expected_hits[num_expected++] = (QueriesRayHit) {entity, distance};
+            }
+        }
+        expected_overflows += num_expected > max;
+
+        const RayHit *found = hits + (u64) i * max;
+        bool ok = counts[i] == Min(num_expected, max);
+        for (u32 h = 0; h < counts[i] && ok; h++) {
+            bool listed = false;
+            for (u32 j = 0; j < num_expected && !listed; j++) {
+                listed = expected_hits[j].entity == found[h].entity
+                      && fabsf(expected_hits[j].distance - found[h].distance) <= QUERIES_DISTANCE_TOLERANCE;
+            }
+            for (u32 j = 0; j < h && ok; j++) ok = found[j].entity != found[h].entity;
+            ok = ok && listed && (h == 0 || found[h - 1].distance <= found[h].distance);
+        }
+        if (!ok) printf("queries: ray %u hit %u entities, the scan %u\n", i, counts[i], num_expected);
+
+        bool same_nearest = (counts[i] == 0) ? nearest[i].entity == ENTITY_NONE
+                          : nearest[i].entity == found[0].entity && nearest[i].distance == found[0].distance;
+        if (!same_nearest) printf("queries: ray %u's nearest hit is %u, not the first of all its hits\n", i, nearest[i].entity);
+        failures += !ok || !same_nearest;
+    }
+    if (overflows != expected_overflows) {
+        printf("queries: %u rays overflowed, the scan says %u\n", overflows, expected_overflows);
+        failures++;
+    }
+
+    free(boxes);
+    free(circles);
+    free(rays);
+    free(results);
+    free(hits);
+    free(nearest);
+    free(counts);
+    free(expected);
+    free(expected_hits);
+    return failures == 0;
+}
+
+// returns whether the index agreed with the scan at every checkpoint
+internal bool queries_run(Replay *replay, u32 num_ticks, u64 seed) {
+    bool passed = true;
+    for (u32 checkpoint = 1; checkpoint <= QUERIES_CHECKPOINTS; checkpoint++) {
+        // the replay is deterministic, so running it again to the next checkpoint
+        // gets the world a single run would have gone through
+        replay_free(replay);
+        u32 ticks = (u32) ((u64) num_ticks * checkpoint / QUERIES_CHECKPOINTS);
+        replay_run(replay, ticks, seed, 0);
+
+        world_build_spatial_index();
+        bool agreed = queries_check_world(replay);
+        printf("queries: tick %u, %u of each kind %s\n", ticks, QUERIES_PER_KIND, agreed ? "match the scan" : "differ from the scan");
+        passed = passed && agreed;
+    }
+    return passed;
+}
+
+// returns the first tick whose checksums differ, or num_ticks when the runs agree
+internal u32 replay_compare(const WorldChecksum *expected, const WorldChecksum *actual, u32 num_ticks) {
+    for (u32 tick = 0; tick < num_ticks; tick++) {
+        if (expected[tick].combined != actual[tick].combined) {
+            ChecksumColumn column = world_checksum_compare(&expected[tick], &actual[tick]);
+            printf("mismatch at tick %u, first differing column '%s' (%016llx != %016llx)\n",
+                   tick, checksum_column_name(column),
+                   (unsigned long long) expected[tick].columns[Min(column, CHECKSUM_COLUMN_COUNT - 1)],
+                   (unsigned long long) actual[tick].columns[Min(column, CHECKSUM_COLUMN_COUNT - 1)]);
+            return tick;
+        }
+    }
+    return num_ticks;
+}
+
+// the same for the state hashes, which can only say that something differs
+internal u32 replay_compare_states(const u64 *expected, const u64 *actual, u32 num_ticks) {
+    for (u32 tick = 0; tick < num_ticks; tick++) {
+        if (expected[tick] != actual[tick]) {
+            printf("mismatch at tick %u, entity states differ (%016llx != %016llx)\n",
+                   tick, (unsigned long long) expected[tick], (unsigned long long) actual[tick]);
+            return tick;
+        }
+    }
+    return num_ticks;
+}
+
+internal bool replay_record(const char *path, const Replay *replay, u32 num_ticks, u64 seed) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "replay: couldn't open '%s' for writing\n", path);
+        return false;
+    }
+
+    ReplayHeader header = {REPLAY_MAGIC, REPLAY_VERSION, num_ticks, CHECKSUM_COLUMN_COUNT, seed};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(replay->checksums, sizeof(WorldChecksum), num_ticks, file) == num_ticks;
+    fclose(file);
+    if (!ok) fprintf(stderr, "replay: failed writing '%s'\n", path);
+    return ok;
+}
+
+internal WorldChecksum *replay_load(const char *path, u32 num_ticks, u64 seed) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "replay: couldn't open '%s'\n", path);
+        return NULL;
+    }
+
+    ReplayHeader header = {0};
+    WorldChecksum *checksums = NULL;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION) {
+        fprintf(stderr, "replay: '%s' isn't a checksum recording\n", path);
+    } else if (header.num_columns != CHECKSUM_COLUMN_COUNT || header.num_ticks != num_ticks || header.seed != seed) {
+        fprintf(stderr, "replay: '%s' was recorded with %u ticks, seed %llu and %u columns, expected %u, %llu and %u\n",
+                path, header.num_ticks, (unsigned long long) header.seed, header.num_columns,
+                num_ticks, (unsigned long long) seed, CHECKSUM_COLUMN_COUNT);
+    } else {
+        checksums = calloc(num_ticks, sizeof(WorldChecksum));
+        if (fread(checksums, sizeof(WorldChecksum), num_ticks, file) != num_ticks) {
+            fprintf(stderr, "replay: '%s' is truncated\n", path);
+            free(checksums);
+            checksums = NULL;
+        }
+    }
+    fclose(file);
+    return checksums;
+}
+
+int main(int argc, char **argv) {
+    u32 num_ticks = (argc > 1) ? (u32) atoi(argv[1]) : 3600;
+    u64 seed      = (argc > 2) ? (u64) atoll(argv[2]) : 1234;
+    const char *mode = (argc > 3) ? argv[3] : NULL;
+    const char *path = (argc > 4) ? argv[4] : NULL;
+
+    static Replay replay;
+    if (mode && strcmp(mode, "pile") == 0) {
+        bool passed = pile_run(&replay, num_ticks, seed);
+        replay_free(&replay);
+        return passed ? 0 : 1;
+    }
+    if (mode && strcmp(mode, "queries") == 0) {
+        bool passed = queries_run(&replay, num_ticks, seed);
+        replay_free(&replay);
+        return passed ? 0 : 1;
+    }
+    if (mode && !path && strcmp(mode, "compact") != 0) {
+        fprintf(stderr, "replay: '%s' needs a file\n", mode);
+        return 1;
+    }
+
+    f64 start = os_now_seconds();
+    replay_run(&replay, num_ticks, seed, 0);
+    f64 elapsed = os_now_seconds() - start;
+
+    printf("ticks: %u, seed: %llu, entities: %u, elapsed: %.3f s\n",
+           num_ticks, (unsigned long long) seed, replay.world.num_entities, elapsed);
+    if (num_ticks > 0) {
+        printf("final checksum: %016llx\n", (unsigned long long) replay.checksums[num_ticks - 1].combined);
+    }
+
+    int result = 0;
+    if (mode && strcmp(mode, "record") == 0) {
+        result = replay_record(path, &replay, num_ticks, seed) ? 0 : 1;
+        if (result == 0) printf("recorded to '%s'\n", path);
+    } else if (mode && strcmp(mode, "verify") == 0) {
+        WorldChecksum *expected = replay_load(path, num_ticks, seed);
+        result = (expected && replay_compare(expected, replay.checksums, num_ticks) == num_ticks) ? 0 : 1;
+        if (result == 0) printf("matches '%s'\n", path);
+        free(expected);
+    } else if (mode && strcmp(mode, "compact") == 0) {
+        // every pass is checked on its own, see replay_compact(). the runs only agree entity for entity
+        // up to the first pass: the solver works through touching pairs in id order, so a pile resolves
+        // a little differently once its ids are shuffled. past that, two compacted runs have to match
+        static Replay compacted;
+        static Replay rerun;
+        replay_run(&compacted, num_ticks, seed, REPLAY_COMPACT_INTERVAL_TICKS);
+        replay_run(&rerun, num_ticks, seed, REPLAY_COMPACT_INTERVAL_TICKS);
+        u32 first_pass = Min(REPLAY_COMPACT_INTERVAL_TICKS, num_ticks);
+        result = (compacted.compaction_failures == 0
+                  && replay_compare_states(replay.state_hashes, compacted.state_hashes, first_pass) == first_pass
+                  && replay_compare(compacted.checksums, rerun.checksums, num_ticks) == num_ticks) ? 0 : 1;
+        if (result == 0) printf("compacted %u times: every pass kept every entity, both runs match\n", compacted.world.compaction.passes);
+        replay_free(&compacted);
+        replay_free(&rerun);
+    } else {
+        // same input twice in one process, anything that differs is nondeterminism
+        static Replay rerun;
+        replay_run(&rerun, num_ticks, seed, 0);
+        result = (replay_compare(replay.checksums, rerun.checksums, num_ticks) == num_ticks) ? 0 : 1;
+        if (result == 0) printf("deterministic: both runs match\n");
+        replay_free(&rerun);
+    }
+
+    u32 violations = mem_steady_state_violations();
+    if (violations > 0) {
+        fprintf(stderr, "replay: %u allocations after the %u tick warmup\n", violations, REPLAY_WARMUP_TICKS);
+        result = 1;
+    }
+
+    replay_free(&replay);
+    return result;
+}
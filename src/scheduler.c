@@ -0,0 +1,117 @@
+#include "game.h"
+
+// ----------------------------------------------------------------------------
+// System scheduler, see game.h
+// the graph is at most a few dozen systems, so it's simply rebuilt from the declarations
+// on every run, enabling or disabling a system needs no bookkeeping
+
+internal bool scheduler_conflicts(const System *a, const System *b) {
+    if (a->exclusive || b->exclusive) return true;
+    return signature_intersects(&a->writes, &b->writes)
+        || signature_intersects(&a->writes, &b->reads)
+        || signature_intersects(&a->reads, &b->writes);
+}
+
+internal void scheduler_build(Scheduler *scheduler) {
+    u32 num_systems = arrlen(scheduler->systems);
+
+    MemTag prev_tag = mem_set_tag(MEM_TAG_WORLD);
+    arrsetlen(scheduler->order, 0);
+    arrsetlen(scheduler->dependents, 0);
+    arrsetlen(scheduler->dependent_offsets, num_systems + 1);
+    arrsetlen(scheduler->chain_lengths, num_systems);
+    arrsetlen(scheduler->pending, num_systems);
+    arrsetlen(scheduler->seconds, num_systems);
+
+    // edges only ever point from an earlier system to a later one, so registration order is
+    // already a topological order. disabled systems are left out, their dependents don't wait on them
+    for (u32 i = 0; i < num_systems; i++) {
+        const System *system = &scheduler->systems[i];
+        scheduler->dependent_offsets[i] = arrlen(scheduler->dependents);
+        scheduler->pending[i] = 0;
+        scheduler->seconds[i] = 0;
+        if (system->disabled) continue;
+
+        arrput(scheduler->order, i);
+        for (u32 j = i + 1; j < num_systems; j++) {
+            const System *later = &scheduler->systems[j];
+            if (!later->disabled && scheduler_conflicts(system, later)) {
+                arrput(scheduler->dependents, j);
+            }
+        }
+    }
+    scheduler->dependent_offsets[num_systems] = arrlen(scheduler->dependents);
+    mem_set_tag(prev_tag);
+
+    for (u32 d = 0; d < arrlen(scheduler->dependents); d++) {
+        scheduler->pending[scheduler->dependents[d]]++;
+    }
+
+    // longest chain from each system to the end of the graph, walked backwards so dependents are known first
+    scheduler->critical_path = 0;
+    for (u32 i = num_systems; i-- > 0;) {
+        u32 longest = 0;
+        for (u32 d = scheduler->dependent_offsets[i]; d < scheduler->dependent_offsets[i + 1]; d++) {
+            longest = Max(longest, scheduler->chain_lengths[scheduler->dependents[d]]);
+        }
+        scheduler->chain_lengths[i] = scheduler->systems[i].disabled ? 0 : longest + 1;
+        scheduler->critical_path = Max(scheduler->critical_path, scheduler->chain_lengths[i]);
+    }
+
+    // stable insertion sort, longest chains first and registration order among equals
+    for (u32 i = 1; i < arrlen(scheduler->order); i++) {
+        u32 system = scheduler->order[i];
+        u32 j = i;
+        for (; j > 0 && scheduler->chain_lengths[scheduler->order[j - 1]] < scheduler->chain_lengths[system]; j--) {
+            scheduler->order[j] = scheduler->order[j - 1];
+        }
+        scheduler->order[j] = system;
+    }
+}
+
+internal void scheduler_run_system(void *data, u32 task, u32 worker) {
+    Scheduler *scheduler = data;
+    System *system = &scheduler->systems[task];
+
+    // pool threads don't have a world of their own
+    world = scheduler->world;
+    f64 start = os_now_seconds();
+    system->run(system->data, worker);
+    scheduler->seconds[task] = os_now_seconds() - start;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+u32 scheduler_add(Scheduler *scheduler, System system) {
+    MemTag prev_tag = mem_set_tag(MEM_TAG_WORLD);
+    arrput(scheduler->systems, system);
+    mem_set_tag(prev_tag);
+    return arrlen(scheduler->systems) - 1;
+}
+
+void scheduler_set_enabled(Scheduler *scheduler, u32 system, bool enabled) {
+    if (system < arrlen(scheduler->systems)) {
+        scheduler->systems[system].disabled = !enabled;
+    }
+}
+
+void scheduler_run(Scheduler *scheduler) {
+    scheduler_build(scheduler);
+
+    scheduler->world = world;
+    jobs_run_graph(arrlen(scheduler->order), scheduler->order, scheduler->dependent_offsets, scheduler->dependents,
+                   scheduler->pending, scheduler_run_system, scheduler);
+    world = scheduler->world;
+}
+
+void scheduler_free(Scheduler *scheduler) {
+    arrfree(scheduler->systems);
+    arrfree(scheduler->order);
+    arrfree(scheduler->dependents);
+    arrfree(scheduler->dependent_offsets);
+    arrfree(scheduler->chain_lengths);
+    arrfree(scheduler->pending);
+    arrfree(scheduler->seconds);
+    *scheduler = (Scheduler) {0};
+}
@@ -0,0 +1,68 @@
+#include "game.h"
+
+// ----------------------------------------------------------------------------
+// Lock free handoff between the simulation and render threads
+
+void snapshot_buffer_init(SnapshotBuffer *buffer) {
+    *buffer = (SnapshotBuffer) {0};
+    buffer->write_index = 0;
+    buffer->ready = 1;
+    buffer->read_index = 2;
+}
+
+void snapshot_buffer_free(SnapshotBuffer *buffer) {
+    for (u32 i = 0; i < ArrayCount(buffer->snapshots); i++) {
+        arrfree(buffer->snapshots[i].shapes);
+    }
+    *buffer = (SnapshotBuffer) {0};
+}
+
+RenderSnapshot *snapshot_begin_write(SnapshotBuffer *buffer) {
+    RenderSnapshot *snapshot = &buffer->snapshots[buffer->write_index];
+    // keep the shape array's capacity, after the first few ticks this never allocates
+    arrsetlen(snapshot->shapes, 0);
+    return snapshot;
+}
+
+void snapshot_publish(SnapshotBuffer *buffer) {
+    // swap our finished snapshot with the ready slot, whatever was there becomes our next one to write
+    u32 prev = ins_atomic_u32_eval_assign(&buffer->ready, buffer->write_index | SNAPSHOT_FRESH);
+    buffer->write_index = prev & ~SNAPSHOT_FRESH;
+}
+
+RenderSnapshot *snapshot_acquire(SnapshotBuffer *buffer) {
+    // nothing new since last time, keep drawing what we have
+    if ((ins_atomic_u32_eval(&buffer->ready) & SNAPSHOT_FRESH) == 0) {
+        return &buffer->snapshots[buffer->read_index];
+    }
+
+    // the writer may publish again in between, that's fine, we just take the newer one
+    u32 prev = ins_atomic_u32_eval_assign(&buffer->ready, buffer->read_index);
+    buffer->read_index = prev & ~SNAPSHOT_FRESH;
+    return &buffer->snapshots[buffer->read_index];
+}
+
+bool render_sparks_push(RenderSparkRing *ring, RenderSpark spark) {
+    u32 head = ring->head;
+    u32 tail = ins_atomic_u32_eval(&ring->tail);
+    if (head - tail >= RENDER_SPARKS_MAX) {
+        // the render thread is behind, dropping a spark is better than stalling the simulation
+        return false;
+    }
+
+    ring->items[head % RENDER_SPARKS_MAX] = spark;
+    ins_atomic_u32_eval_assign(&ring->head, head + 1);
+    return true;
+}
+
+bool render_sparks_pop(RenderSparkRing *ring, RenderSpark *spark) {
+    u32 tail = ring->tail;
+    u32 head = ins_atomic_u32_eval(&ring->head);
+    if (tail == head) {
+        return false;
+    }
+
+    *spark = ring->items[tail % RENDER_SPARKS_MAX];
+    ins_atomic_u32_eval_assign(&ring->tail, tail + 1);
+    return true;
+}
@@ -0,0 +1,445 @@
+#include "game.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Contact solver, see game.h
+
+// contacts a collider is expected to be in at once, bodies in a pile touch about three others
+// and a couple of map cells
+internal const u32 CONTACT_RESERVE_PER_COLLIDER = 4;
+
+internal bool contact_body_asleep(Entity entity) {
+    return entity_has_components(entity, COMPONENT_MOVEMENT) && world->movements.asleep[entity];
+}
+
+// asleep bodies are solved as if they were static until something wakes them
+internal f32 contact_inv_mass(Entity entity) {
+    if (!entity_has_components(entity, COMPONENT_MOVEMENT) || world->movements.asleep[entity]) return 0;
+    return world->movements.inv_mass[entity];
+}
+
+internal f32 contact_restitution(Entity entity) {
+    return entity_has_components(entity, COMPONENT_MOVEMENT) ? world->movements.restitution[entity] : 0;
+}
+
+// static bodies grip fully, so a pair's friction is whatever the moving body asks for
+internal f32 contact_friction(Entity entity) {
+    return entity_has_components(entity, COMPONENT_MOVEMENT) ? world->movements.contact_friction[entity] : 1;
+}
+
+// bodies with hit handlers decide for themselves what bounds do to them, see entity_move_x()
+internal bool contact_handled_by_on_hit(Entity entity, Entity other) {
+    if ((world->collider_blocks[other / COLLIDER_BLOCK_LANES].mask[other % COLLIDER_BLOCK_LANES] & MASK_BOUNDS) == 0) return false;
+    return world->colliders.on_hit_x[entity] || world->colliders.on_hit_y[entity];
+}
+
+internal Shape contact_collider_shape(Entity entity) {
+    return world->collider_blocks[entity / COLLIDER_BLOCK_LANES].shape[entity % COLLIDER_BLOCK_LANES];
+}
+
+internal Vector2 contact_velocity(Entity entity) {
+    if (!entity_has_components(entity, COMPONENT_MOVEMENT)) return (Vector2) {0};
+    return (Vector2) {world->movements.vel_x[entity], world->movements.vel_y[entity]};
+}
+
+// collider geometry around its center, circles are positioned by their center and rects by their corner
+typedef struct {
+    Vector2 center;
+    f32 radius;
+    f32 half_w;
+    f32 half_h;
+} ContactShape;
+
+internal ContactShape contact_shape(Entity entity) {
+    // blocks hold the corner of the bounds, circles sit in the middle of theirs like rects do
+    const ColliderBlock *block = &world->collider_blocks[entity / COLLIDER_BLOCK_LANES];
+    const u32 lane = entity % COLLIDER_BLOCK_LANES;
+    ContactShape shape = {
+        .radius = block->radius[lane],
+        .half_w = block->width[lane] * 0.5f,
+        .half_h = block->height[lane] * 0.5f,
+    };
+    shape.center.x = block->x[lane] + shape.half_w;
+    shape.center.y = block->y[lane] + shape.half_h;
+    return shape;
+}
+
+internal bool circ_circ_contact(Contact *contact, ContactShape a, ContactShape b, f32 margin) {
+    f32 dx = b.center.x - a.center.x;
+    f32 dy = b.center.y - a.center.y;
+    f32 radii = a.radius + b.radius;
+
+    f32 distance_sq = dx * dx + dy * dy;
+    if (distance_sq > (radii + margin) * (radii + margin)) return false;
+
+    // exactly on top of each other, any direction will do as long as it's the same every time
+    f32 distance = sqrtf(distance_sq);
+    contact->normal_x = (distance > 0) ? dx / distance : 0;
+    contact->normal_y = (distance > 0) ? dy / distance : 1;
+    contact->penetration = radii - distance;
+    return true;
+}
+
+internal bool circ_rect_contact(Contact *contact, ContactShape circ, ContactShape rect, f32 margin) {
+    // circle center relative to the rect center
+    f32 dx = circ.center.x - rect.center.x;
+    f32 dy = circ.center.y - rect.center.y;
+
+    if (fabsf(dx) <= rect.half_w && fabsf(dy) <= rect.half_h) {
+        // the center is inside, push it out through the nearest side
+        f32 out_x = rect.half_w - fabsf(dx);
+        f32 out_y = rect.half_h - fabsf(dy);
+        if (out_x < out_y) {
+            contact->normal_x = (dx >= 0) ? -1 : 1;
+            contact->normal_y = 0;
+            contact->penetration = out_x + circ.radius;
+        } else {
+            contact->normal_x = 0;
+            contact->normal_y = (dy >= 0) ? -1 : 1;
+            contact->penetration = out_y + circ.radius;
+        }
+        return true;
+    }
+
+    // otherwise the contact is with the nearest point on the rect's boundary
+    f32 from_x = dx - Clamp(-rect.half_w, dx, rect.half_w);
+    f32 from_y = dy - Clamp(-rect.half_h, dy, rect.half_h);
+    f32 distance_sq = from_x * from_x + from_y * from_y;
+    if (distance_sq > (circ.radius + margin) * (circ.radius + margin)) return false;
+
+    f32 distance = sqrtf(distance_sq);
+    contact->normal_x = -from_x / distance;
+    contact->normal_y = -from_y / distance;
+    contact->penetration = circ.radius - distance;
+    return true;
+}
+
+internal bool rect_rect_contact(Contact *contact, ContactShape a, ContactShape b, f32 margin) {
+    f32 dx = b.center.x - a.center.x;
+    f32 dy = b.center.y - a.center.y;
+    f32 overlap_x = a.half_w + b.half_w - fabsf(dx);
+    f32 overlap_y = a.half_h + b.half_h - fabsf(dy);
+    if (overlap_x < -margin || overlap_y < -margin) return false;
+
+    // separate along whichever axis has the least overlap
+    if (overlap_x < overlap_y) {
+        contact->normal_x = (dx >= 0) ? 1 : -1;
+        contact->normal_y = 0;
+        contact->penetration = overlap_x;
+    } else {
+        contact->normal_x = 0;
+        contact->normal_y = (dy >= 0) ? 1 : -1;
+        contact->penetration = overlap_y;
+    }
+    return true;
+}
+
+internal bool contact_between(Contact *contact, Shape shape_a, ContactShape a, Shape shape_b, ContactShape b, f32 margin) {
+    if (shape_a == SHAPE_CIRC && shape_b == SHAPE_CIRC) return circ_circ_contact(contact, a, b, margin);
+    if (shape_a == SHAPE_CIRC && shape_b == SHAPE_RECT) return circ_rect_contact(contact, a, b, margin);
+    if (shape_a == SHAPE_RECT && shape_b == SHAPE_RECT) return rect_rect_contact(contact, a, b, margin);
+    return false;
+}
+
+// a moving body that runs into an asleep one wakes it up, a slow one just leans on it
+internal void contact_wake_sleeper(ContactSolver *solver, Entity sleeper, Entity other) {
+    if (!contact_body_asleep(sleeper)) return;
+    if (!entity_has_components(other, COMPONENT_MOVEMENT) || world->movements.asleep[other]) return;
+
+    Vector2 vel = contact_velocity(other);
+    if (vel.x * vel.x + vel.y * vel.y > solver->sleep_speed * solver->sleep_speed) {
+        entity_wake(sleeper);
+    }
+}
+
+internal f32 contact_normal_speed(Contact *contact) {
+    Vector2 vel_a = contact_velocity(contact->a);
+    Vector2 vel_b = contact_velocity(contact->b);
+    return (vel_b.x - vel_a.x) * contact->normal_x + (vel_b.y - vel_a.y) * contact->normal_y;
+}
+
+// the tangent is the normal turned a quarter, there's no rotation so sliding is just velocity along it
+internal f32 contact_tangent_speed(Contact *contact) {
+    Vector2 vel_a = contact_velocity(contact->a);
+    Vector2 vel_b = contact_velocity(contact->b);
+    return (vel_b.y - vel_a.y) * contact->normal_x - (vel_b.x - vel_a.x) * contact->normal_y;
+}
+
+internal void contact_apply_impulse(Contact *contact, f32 normal_impulse, f32 tangent_impulse) {
+    Movements *movements = &world->movements;
+    f32 impulse_x = contact->normal_x * normal_impulse - contact->normal_y * tangent_impulse;
+    f32 impulse_y = contact->normal_y * normal_impulse + contact->normal_x * tangent_impulse;
+    if (contact->inv_mass_a > 0) {
+        movements->vel_x[contact->a] -= impulse_x * contact->inv_mass_a;
+        movements->vel_y[contact->a] -= impulse_y * contact->inv_mass_a;
+    }
+    if (contact->inv_mass_b > 0) {
+        movements->vel_x[contact->b] += impulse_x * contact->inv_mass_b;
+        movements->vel_y[contact->b] += impulse_y * contact->inv_mass_b;
+    }
+}
+
+// what this pair ended last tick with, NULL for a new contact
+internal int contact_compare_keys(const void *a, const void *b) {
+    const Contact *x = a;
+    const Contact *y = b;
+    if (x->key != y->key) return (x->key > y->key) ? 1 : -1;
+    return (x->cell > y->cell) - (x->cell < y->cell);
+}
+
+internal Contact *contact_find_previous(ContactSolver *solver, const Contact *contact) {
+    i32 lo = 0;
+    i32 hi = (i32) arrlen(solver->prev_contacts) - 1;
+    while (lo <= hi) {
+        i32 mid = lo + (hi - lo) / 2;
+        int order = contact_compare_keys(&solver->prev_contacts[mid], contact);
+        if (order == 0) return &solver->prev_contacts[mid];
+        if (order < 0) lo = mid + 1;
+        else           hi = mid - 1;
+    }
+    return NULL;
+}
+
+internal void contact_solver_update_sleep(ContactSolver *solver, f32 dt) {
+    Movements *movements = &world->movements;
+    const f32 sleep_speed_sq = solver->sleep_speed * solver->sleep_speed;
+
+    for (u32 i = 0; i < world->num_entities; i++) {
+        if (!entity_has_components(i, COMPONENT_MOVEMENT) || movements->inv_mass[i] == 0) continue;
+
+        // only bodies resting on something can sleep, and losing that support wakes them
+        if (!solver->touching[i] || solver->sleep_seconds <= 0) {
+            entity_wake(i);
+            continue;
+        }
+        if (movements->asleep[i]) continue;
+
+        f32 speed_sq = movements->vel_x[i] * movements->vel_x[i] + movements->vel_y[i] * movements->vel_y[i];
+        if (speed_sq > sleep_speed_sq) {
+            movements->sleep_seconds[i] = 0;
+            continue;
+        }
+
+        movements->sleep_seconds[i] += dt;
+        if (movements->sleep_seconds[i] >= solver->sleep_seconds) {
+            movements->asleep[i] = true;
+            movements->vel_x[i] = 0;
+            movements->vel_y[i] = 0;
+            movements->remainder_x[i] = 0;
+            movements->remainder_y[i] = 0;
+        }
+    }
+}
+
+internal void contact_solver_push(ContactSolver *solver, Contact contact) {
+    Entity a = contact.a;
+    Entity b = contact.b;
+
+    // resting against something counts as support even when the pair isn't solved
+    solver->touching[a] = true;
+    solver->touching[b] = true;
+
+    contact_wake_sleeper(solver, a, b);
+    contact_wake_sleeper(solver, b, a);
+
+    // nothing to solve between two bodies that can't be pushed
+    contact.inv_mass_a = contact_inv_mass(a);
+    contact.inv_mass_b = contact_inv_mass(b);
+    if (contact.inv_mass_a + contact.inv_mass_b == 0) return;
+
+    contact.normal_mass = 1 / (contact.inv_mass_a + contact.inv_mass_b);
+    contact.friction = Min(contact_friction(a), contact_friction(b));
+    arrput(solver->contacts, contact);
+}
+
+// one contact per solid cell near the body, each cell is a static rect of its own
+internal void contact_solver_add_tilemap(ContactSolver *solver, Entity body, Entity map) {
+    Tilemap *tilemap = &world->colliders.tilemaps[map];
+    const f32 cell_size = tilemap->cell_size;
+    const Shape body_shape = contact_collider_shape(body);
+    const ContactShape shape = contact_shape(body);
+    const f32 map_x = world->collider_blocks[map / COLLIDER_BLOCK_LANES].x[map % COLLIDER_BLOCK_LANES];
+    const f32 map_y = world->collider_blocks[map / COLLIDER_BLOCK_LANES].y[map % COLLIDER_BLOCK_LANES];
+
+    const f32 reach_x = ((body_shape == SHAPE_CIRC) ? shape.radius : shape.half_w) + solver->contact_margin;
+    const f32 reach_y = ((body_shape == SHAPE_CIRC) ? shape.radius : shape.half_h) + solver->contact_margin;
+    // a reach ending exactly on a cell edge still touches the cell on the other side of it,
+    // which is where swept moves leave a body resting on the map: one margin away
+    i32 col0 = ceilf((shape.center.x - reach_x - map_x) / cell_size) - 1;
+    i32 col1 = floorf((shape.center.x + reach_x - map_x) / cell_size);
+    i32 row0 = ceilf((shape.center.y - reach_y - map_y) / cell_size) - 1;
+    i32 row1 = floorf((shape.center.y + reach_y - map_y) / cell_size);
+
+    for (i32 row = row0; row <= row1; row++) {
+        u64 span = tilemap_row_span(tilemap, row, col0, col1);
+        while (span != 0) {
+            i32 col = col0 + ctz64(span);
+            span &= span - 1;
+
+            ContactShape cell = {
+                .center = {map_x + (col + 0.5f) * cell_size, map_y + (row + 0.5f) * cell_size},
+                .half_w = cell_size * 0.5f,
+                .half_h = cell_size * 0.5f,
+            };
+            // the map is part of the key, so a body touching the same cell index of two maps keeps two contacts
+            Contact contact = {
+                .a = body,
+                .b = map,
+                .key = ((u64) body << 32) | map,
+                .cell = (u32) (row * tilemap->cols + col) + 1,
+            };
+            if (contact_between(&contact, body_shape, shape, SHAPE_RECT, cell, solver->contact_margin)) {
+                contact_solver_push(solver, contact);
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void contact_solver_begin(ContactSolver *solver, u32 num_colliders) {
+    // both arrays swap roles every tick, so both get the room
+    arrsetcap(solver->contacts, num_colliders * CONTACT_RESERVE_PER_COLLIDER);
+    arrsetcap(solver->prev_contacts, num_colliders * CONTACT_RESERVE_PER_COLLIDER);
+
+    // last tick's contacts become the warm start lookup, and their array is reused for this tick
+    Contact *prev = solver->prev_contacts;
+    solver->prev_contacts = solver->contacts;
+    solver->contacts = prev;
+    arrsetlen(solver->contacts, 0);
+
+    arrsetlen(solver->touching, world->num_entities);
+    memset(solver->touching, 0, world->num_entities * sizeof(bool));
+}
+
+void contact_solver_add(ContactSolver *solver, Entity a, Entity b) {
+    Shape shape_a = contact_collider_shape(a);
+    Shape shape_b = contact_collider_shape(b);
+    if (shape_a == SHAPE_TILEMAP || (shape_a == SHAPE_RECT && shape_b == SHAPE_CIRC)) {
+        Entity swap = a; a = b; b = swap;
+        Shape swap_shape = shape_a; shape_a = shape_b; shape_b = swap_shape;
+    }
+
+    if (contact_handled_by_on_hit(a, b) || contact_handled_by_on_hit(b, a)) return;
+
+    if (shape_b == SHAPE_TILEMAP) {
+        contact_solver_add_tilemap(solver, a, b);
+        return;
+    }
+
+    Contact contact = {
+        .a = a,
+        .b = b,
+        .key = ((u64) a << 32) | b,
+    };
+    if (contact_between(&contact, shape_a, contact_shape(a), shape_b, contact_shape(b), solver->contact_margin)) {
+        contact_solver_push(solver, contact);
+    }
+}
+
+void contact_solver_run(ContactSolver *solver, f32 dt) {
+    Contact *contacts = solver->contacts;
+    u32 num_contacts = arrlen(contacts);
+
+    // the bounce target comes from the approach speed before any impulses are applied
+    for (u32 i = 0; i < num_contacts; i++) {
+        Contact *contact = &contacts[i];
+        f32 normal_speed = contact_normal_speed(contact);
+        f32 restitution = Max(contact_restitution(contact->a), contact_restitution(contact->b));
+        contact->bounce = (normal_speed < -solver->bounce_threshold) ? -restitution * normal_speed : 0;
+    }
+
+    for (u32 i = 0; i < num_contacts; i++) {
+        Contact *contact = &contacts[i];
+        Contact *prev = contact_find_previous(solver, contact);
+        if (!prev) continue;
+
+        contact->impulse = prev->impulse * solver->warm_start;
+        contact->tangent_impulse = prev->tangent_impulse * solver->warm_start;
+        contact_apply_impulse(contact, contact->impulse, contact->tangent_impulse);
+    }
+
+    // clamping the running totals rather than each step lets a later iteration
+    // take back some of what an earlier one (or the warm start) overshot
+    for (u32 iteration = 0; iteration < solver->iterations; iteration++) {
+        for (u32 i = 0; i < num_contacts; i++) {
+            Contact *contact = &contacts[i];
+
+            // friction can't push harder than the contact is pressed together
+            f32 max_friction = contact->friction * contact->impulse;
+            f32 tangent_delta = -contact_tangent_speed(contact) * contact->normal_mass;
+            f32 tangent_impulse = Clamp(-max_friction, contact->tangent_impulse + tangent_delta, max_friction);
+            contact_apply_impulse(contact, 0, tangent_impulse - contact->tangent_impulse);
+            contact->tangent_impulse = tangent_impulse;
+
+            f32 delta = (contact->bounce - contact_normal_speed(contact)) * contact->normal_mass;
+            f32 impulse = Max(contact->impulse + delta, 0);
+            contact_apply_impulse(contact, impulse - contact->impulse, 0);
+            contact->impulse = impulse;
+        }
+    }
+
+    // overlap is pushed out through the sub-pixel remainders rather than as velocity,
+    // so it's picked up smoothly by the next move without making anything bounce
+    Movements *movements = &world->movements;
+    for (u32 i = 0; i < num_contacts; i++) {
+        Contact *contact = &contacts[i];
+        f32 depth = contact->penetration - solver->position_slop;
+        if (depth <= 0) continue;
+
+        f32 correction = depth * solver->position_correction * contact->normal_mass;
+        movements->remainder_x[contact->a] -= contact->normal_x * correction * contact->inv_mass_a;
+        movements->remainder_y[contact->a] -= contact->normal_y * correction * contact->inv_mass_a;
+        movements->remainder_x[contact->b] += contact->normal_x * correction * contact->inv_mass_b;
+        movements->remainder_y[contact->b] += contact->normal_y * correction * contact->inv_mass_b;
+    }
+
+    // sorted so next tick can look up the impulses by pair
+    if (num_contacts > 1) {
+        qsort(contacts, num_contacts, sizeof(Contact), contact_compare_keys);
+    }
+
+    contact_solver_update_sleep(solver, dt);
+}
+
+void contact_solver_remap(ContactSolver *solver, const Entity *remap) {
+    // last tick's contacts are next tick's warm start, the ones before that are never looked at again
+    u32 num_kept = 0;
+    for (u32 i = 0; i < arrlen(solver->contacts); i++) {
+        Contact contact = solver->contacts[i];
+        Entity a = remap[contact.a];
+        Entity b = remap[contact.b];
+        if (a == ENTITY_NONE || b == ENTITY_NONE) continue;
+
+        // keyed like contact_solver_add() would key the pair now: tilemap cells body first,
+        // pairs of one shape lower id first, circle and rect pairs circle first
+        bool is_cell = contact.cell != 0;
+        bool same_shape = world->colliders.shape[a] == world->colliders.shape[b];
+        if (!is_cell && same_shape && a > b) {
+            Entity swap = a; a = b; b = swap;
+            contact.normal_x = -contact.normal_x;
+            contact.normal_y = -contact.normal_y;
+        }
+        contact.a = a;
+        contact.b = b;
+        contact.key = ((u64) a << 32) | b;
+        solver->contacts[num_kept++] = contact;
+    }
+    arrsetlen(solver->contacts, num_kept);
+    arrsetlen(solver->prev_contacts, 0);
+
+    if (num_kept > 1) {
+        qsort(solver->contacts, num_kept, sizeof(Contact), contact_compare_keys);
+    }
+}
+
+void contact_solver_free(ContactSolver *solver) {
+    arrfree(solver->contacts);
+    arrfree(solver->prev_contacts);
+    arrfree(solver->touching);
+    solver->contacts = NULL;
+    solver->prev_contacts = NULL;
+    solver->touching = NULL;
+}
@@ -0,0 +1,688 @@
+#include "game.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Spatial index and batched queries, see game.h
+// an entry spanning several cells sits in several buckets, queries only report it from the
+// cell holding the top left corner of where its bounds and the query's bounds meet, which is
+// exactly one of the cells the query visits, so there's no per query dedupe state
+
+#define SPATIAL_QUERY_BATCH 64
+#define SPATIAL_MIN_BUCKETS 64
+
+// everything a shape query needs, AabbQuery and CircleQuery both turn into one of these
+typedef struct {
+    f32 x0;
+    f32 y0;
+    f32 x1;
+    f32 y1;
+    bool is_circle;
+    Vector2 center;
+    f32 radius;
+    CollisionMask mask;
+    bool any_mask;          // every positioned entity matches, with or without a collider
+    Entity ignore;
+    Entity above;           // only entities after this one, for the broad phase
+    bool bounds_only;       // skip the exact shape test, for the broad phase
+} SpatialShapeQuery;
+
+// hits go either into a fixed slice or, single threaded only, onto an stb_ds array
+typedef struct {
+    Entity *fixed;
+    u32 max;
+    Entity **array;
+    u32 count;
+} SpatialResults;
+
+typedef struct {
+    World *world;
+    const void *queries;
+    void *results;
+    u32 max_results;
+    u32 *counts;
+    volatile u32 overflows;
+} SpatialJob;
+
+internal inline i32 spatial_cell(i32 v) {
+    return v >> SPATIAL_CELL_SHIFT;
+}
+
+internal inline i32 spatial_cell_f(f32 v) {
+    return (i32) floorf(v / SPATIAL_CELL_SIZE);
+}
+
+internal inline u32 spatial_bucket(const SpatialIndex *index, i32 cx, i32 cy) {
+    u32 h = ((u32) cx * 73856093u) ^ ((u32) cy * 19349663u);
+    return (h ^ (h >> 16)) & index->bucket_mask;
+}
+
+internal inline u64 spatial_cell_count(i32 cx0, i32 cy0, i32 cx1, i32 cy1) {
+    return (u64) (cx1 - cx0 + 1) * (u64) (cy1 - cy0 + 1);
+}
+
+internal bool spatial_entity_bounds(Entity entity, SpatialEntry *entry) {
+    if (!entity_has_components(entity, COMPONENT_POSITION)) return false;
+
+    i32 x = world->positions.x[entity];
+    i32 y = world->positions.y[entity];
+    *entry = (SpatialEntry) {.entity = entity, .mask = MASK_NONE, .x0 = x, .y0 = y, .x1 = x, .y1 = y};
+    if (!entity_has_components(entity, COMPONENT_COLLIDER)) return true;
+
+    // circles are positioned by their center, rects and tilemaps by their corner
+    x += world->colliders.offset_x[entity];
+    y += world->colliders.offset_y[entity];
+    if (world->colliders.shape[entity] == SHAPE_CIRC) {
+        i32 r = world->colliders.radius[entity];
+        entry->x0 = x - r;
+        entry->y0 = y - r;
+        entry->x1 = x + r;
+        entry->y1 = y + r;
+    } else {
+        entry->x0 = x;
+        entry->y0 = y;
+        entry->x1 = x + (i32) world->colliders.width[entity];
+        entry->y1 = y + (i32) world->colliders.height[entity];
+    }
+    entry->mask = world->colliders.mask[entity];
+    return true;
+}
+
+internal inline bool spatial_is_large(const SpatialEntry *entry) {
+    u64 cells = spatial_cell_count(spatial_cell(entry->x0), spatial_cell(entry->y0), spatial_cell(entry->x1), spatial_cell(entry->y1));
+    return cells > SPATIAL_MAX_CELLS;
+}
+
+// distinct buckets of an entry's cells, hash collisions between its own cells would list it twice otherwise
+internal u32 spatial_entry_buckets(const SpatialIndex *index, const SpatialEntry *entry, u32 buckets[SPATIAL_MAX_CELLS]) {
+    u32 num_buckets = 0;
+    for (i32 cy = spatial_cell(entry->y0); cy <= spatial_cell(entry->y1); cy++) {
+        for (i32 cx = spatial_cell(entry->x0); cx <= spatial_cell(entry->x1); cx++) {
+            u32 bucket = spatial_bucket(index, cx, cy);
+            bool seen = false;
+            for (u32 i = 0; i < num_buckets && !seen; i++) {
+                seen = buckets[i] == bucket;
+            }
+            if (!seen) buckets[num_buckets++] = bucket;
+        }
+    }
+    return num_buckets;
+}
+
+internal inline bool spatial_circle_rect(Vector2 center, f32 radius, f32 x0, f32 y0, f32 x1, f32 y1) {
+    f32 dx = center.x - Clamp(x0, center.x, x1);
+    f32 dy = center.y - Clamp(y0, center.y, y1);
+    return dx * dx + dy * dy <= radius * radius;
+}
+
+// any solid cell of the tilemap under the query
+internal bool spatial_tilemap_overlaps(const SpatialShapeQuery *query, const SpatialEntry *entry) {
+    const Tilemap *tilemap = &world->colliders.tilemaps[entry->entity];
+    const f32 cell_size = tilemap->cell_size;
+    i32 col0 = Max((i32) floorf((query->x0 - entry->x0) / cell_size), 0);
+    i32 col1 = Min((i32) floorf((query->x1 - entry->x0) / cell_size), (i32) tilemap->cols - 1);
+    i32 row0 = Max((i32) floorf((query->y0 - entry->y0) / cell_size), 0);
+    i32 row1 = Min((i32) floorf((query->y1 - entry->y0) / cell_size), (i32) tilemap->rows - 1);
+
+    for (i32 row = row0; row <= row1; row++) {
+        for (i32 col = col0; col <= col1; col += 64) {
+            u64 span = tilemap_row_span(tilemap, row, col, Min(col + 63, col1));
+            if (!query->is_circle && span != 0) return true;
+
+            while (span != 0) {
+                i32 cell = col + ctz64(span);
+                span &= span - 1;
+
+                f32 x = entry->x0 + cell * cell_size;
+                f32 y = entry->y0 + row * cell_size;
+                if (spatial_circle_rect(query->center, query->radius, x, y, x + cell_size, y + cell_size)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+internal bool spatial_shape_matches(const SpatialShapeQuery *query, const SpatialEntry *entry) {
+    if (entry->entity == query->ignore || entry->entity <= query->above) return false;
+    if (!query->any_mask && (entry->mask & query->mask) == 0) return false;
+    if (entry->x0 > query->x1 || entry->x1 < query->x0 || entry->y0 > query->y1 || entry->y1 < query->y0) return false;
+    if (query->bounds_only) return true;
+
+    // overlapping bounds are exact for rects against rects, everything else needs its shape.
+    // position-only entities are a point, which is a zero sized rect
+    Shape shape = entity_has_components(entry->entity, COMPONENT_COLLIDER) ? world->colliders.shape[entry->entity] : SHAPE_RECT;
+    if (shape == SHAPE_TILEMAP) {
+        return spatial_tilemap_overlaps(query, entry);
+    }
+    if (shape == SHAPE_CIRC) {
+        f32 r = world->colliders.radius[entry->entity];
+        Vector2 center = {entry->x0 + r, entry->y0 + r};
+        if (query->is_circle) {
+            f32 dx = center.x - query->center.x;
+            f32 dy = center.y - query->center.y;
+            return dx * dx + dy * dy <= (r + query->radius) * (r + query->radius);
+        }
+        return spatial_circle_rect(center, r, query->x0, query->y0, query->x1, query->y1);
+    }
+    if (query->is_circle) {
+        return spatial_circle_rect(query->center, query->radius, entry->x0, entry->y0, entry->x1, entry->y1);
+    }
+    return true;
+}
+
+internal inline void spatial_emit(SpatialResults *results, Entity entity) {
+    if (results->array) {
+        arrput(*results->array, entity);
+    } else if (results->count < results->max) {
+        results->fixed[results->count] = entity;
+    }
+    results->count++;
+}
+
+internal void spatial_collect(const SpatialIndex *index, const SpatialShapeQuery *query, SpatialResults *results) {
+    i32 cx0 = spatial_cell_f(query->x0);
+    i32 cy0 = spatial_cell_f(query->y0);
+    i32 cx1 = spatial_cell_f(query->x1);
+    i32 cy1 = spatial_cell_f(query->y1);
+
+    // a query covering more cells than there are buckets is cheaper as one pass over every entity
+    if (spatial_cell_count(cx0, cy0, cx1, cy1) > (u64) index->bucket_mask + 1) {
+        for (u32 i = 0; i < arrlen(index->items); i++) {
+            if (spatial_shape_matches(query, &index->items[i])) {
+                spatial_emit(results, index->items[i].entity);
+            }
+        }
+        return;
+    }
+
+    for (u32 i = 0; i < arrlen(index->large); i++) {
+        if (spatial_shape_matches(query, &index->large[i])) {
+            spatial_emit(results, index->large[i].entity);
+        }
+    }
+    for (i32 cy = cy0; cy <= cy1; cy++) {
+        for (i32 cx = cx0; cx <= cx1; cx++) {
+            u32 bucket = spatial_bucket(index, cx, cy);
+            for (u32 e = index->bucket_starts[bucket]; e < index->bucket_starts[bucket + 1]; e++) {
+                const SpatialEntry *entry = &index->entries[e];
+                // also drops entries that only share the bucket through a hash collision
+                if (Max(spatial_cell(entry->x0), cx0) != cx || Max(spatial_cell(entry->y0), cy0) != cy) continue;
+
+                if (spatial_shape_matches(query, entry)) {
+                    spatial_emit(results, entry->entity);
+                }
+            }
+        }
+    }
+}
+
+internal int spatial_compare_entities(const void *a, const void *b) {
+    Entity x = *(const Entity *) a;
+    Entity y = *(const Entity *) b;
+    return (x > y) - (x < y);
+}
+
+// large entries come first and cells are visited in order, callers that want entity order sort
+internal void spatial_sort_entities(Entity *entities, u32 count) {
+    if (count > 16) {
+        qsort(entities, count, sizeof(Entity), spatial_compare_entities);
+        return;
+    }
+    for (u32 i = 1; i < count; i++) {
+        Entity entity = entities[i];
+        u32 j = i;
+        for (; j > 0 && entities[j - 1] > entity; j--) {
+            entities[j] = entities[j - 1];
+        }
+        entities[j] = entity;
+    }
+}
+
+internal u32 spatial_collect_into(const SpatialShapeQuery *query, Entity *results, u32 max_results, u32 *count) {
+    SpatialResults out = {.fixed = results, .max = max_results};
+    spatial_collect(&world->spatial, query, &out);
+    *count = Min(out.count, max_results);
+    return out.count > max_results;
+}
+
+internal void spatial_aabb_job(void *data, u32 begin, u32 end, u32 worker) {
+    SpatialJob *job = data;
+    const AabbQuery *queries = job->queries;
+    world = job->world;
+
+    u32 overflows = 0;
+    for (u32 i = begin; i < end; i++) {
+        Rectangle bounds = queries[i].bounds;
+        SpatialShapeQuery query = {
+            .x0 = bounds.x,
+            .y0 = bounds.y,
+            .x1 = bounds.x + bounds.width,
+            .y1 = bounds.y + bounds.height,
+            .mask = queries[i].mask,
+            .ignore = queries[i].ignore,
+        };
+        overflows += spatial_collect_into(&query, (Entity *) job->results + (u64) i * job->max_results, job->max_results, &job->counts[i]);
+    }
+    if (overflows) ins_atomic_u32_add_eval(&job->overflows, overflows);
+}
+
+internal void spatial_circle_job(void *data, u32 begin, u32 end, u32 worker) {
+    SpatialJob *job = data;
+    const CircleQuery *queries = job->queries;
+    world = job->world;
+
+    u32 overflows = 0;
+    for (u32 i = begin; i < end; i++) {
+        Vector2 center = queries[i].center;
+        f32 r = queries[i].radius;
+        SpatialShapeQuery query = {
+            .x0 = center.x - r,
+            .y0 = center.y - r,
+            .x1 = center.x + r,
+            .y1 = center.y + r,
+            .is_circle = true,
+            .center = center,
+            .radius = r,
+            .mask = queries[i].mask,
+            .ignore = queries[i].ignore,
+        };
+        overflows += spatial_collect_into(&query, (Entity *) job->results + (u64) i * job->max_results, job->max_results, &job->counts[i]);
+    }
+    if (overflows) ins_atomic_u32_add_eval(&job->overflows, overflows);
+}
+
+// ----------------------------------------------------------------------------
+// Rays, the direction is unit length by the time these run
+
+// slab test, t_enter is 0 with the normal facing back along the ray when it starts inside
+internal bool spatial_ray_box(Vector2 origin, Vector2 dir, f32 x0, f32 y0, f32 x1, f32 y1, f32 max_t,
+                              f32 *t_enter, f32 *t_exit, Vector2 *normal) {
+    f32 t_near = 0;
+    f32 t_far = max_t;
+    Vector2 n = {-dir.x, -dir.y};
+
+    const f32 o[2] = {origin.x, origin.y};
+    const f32 d[2] = {dir.x, dir.y};
+    const f32 lo[2] = {x0, y0};
+    const f32 hi[2] = {x1, y1};
+    for (u32 axis = 0; axis < 2; axis++) {
+        if (d[axis] == 0) {
+            if (o[axis] < lo[axis] || o[axis] > hi[axis]) return false;
+            continue;
+        }
+
+        f32 inv = 1.0f / d[axis];
+        f32 t0 = (lo[axis] - o[axis]) * inv;
+        f32 t1 = (hi[axis] - o[axis]) * inv;
+        if (t0 > t1) {
+            f32 swap = t0; t0 = t1; t1 = swap;
+        }
+        if (t0 > t_near) {
+            t_near = t0;
+            n = (axis == 0) ? (Vector2) {(d[0] > 0) ? -1.0f : 1.0f, 0} : (Vector2) {0, (d[1] > 0) ? -1.0f : 1.0f};
+        }
+        t_far = Min(t_far, t1);
+        if (t_near > t_far) return false;
+    }
+
+    *t_enter = t_near;
+    *t_exit = t_far;
+    *normal = n;
+    return true;
+}
+
+internal bool spatial_ray_circle(Vector2 origin, Vector2 dir, Vector2 center, f32 radius, f32 max_t, f32 *t, Vector2 *normal) {
+    f32 mx = origin.x - center.x;
+    f32 my = origin.y - center.y;
+    f32 c = mx * mx + my * my - radius * radius;
+    if (c <= 0) {
+        *t = 0;
+        *normal = (Vector2) {-dir.x, -dir.y};
+        return true;
+    }
+
+    // the discriminant from the offset perpendicular to the ray rather than b * b - c,
+    // which loses everything to cancellation for far away circles
+    f32 b = mx * dir.x + my * dir.y;
+    f32 hx = mx - b * dir.x;
+    f32 hy = my - b * dir.y;
+    f32 disc = radius * radius - (hx * hx + hy * hy);
+    if (b > 0 || disc < 0) return false;
+
+    f32 hit = -b - sqrtf(disc);
+    if (hit > max_t) return false;
+
+    *t = hit;
+    *normal = (Vector2) {(mx + dir.x * hit) / radius, (my + dir.y * hit) / radius};
+    return true;
+}
+
+// walk the cells the ray crosses inside the map until one is solid
+internal bool spatial_ray_tilemap(Vector2 origin, Vector2 dir, const SpatialEntry *entry, f32 max_t, f32 *t, Vector2 *normal) {
+    f32 t_enter, t_exit;
+    Vector2 n;
+    if (!spatial_ray_box(origin, dir, entry->x0, entry->y0, entry->x1, entry->y1, max_t, &t_enter, &t_exit, &n)) return false;
+
+    const Tilemap *tilemap = &world->colliders.tilemaps[entry->entity];
+    const f32 cell_size = tilemap->cell_size;
+    f32 px = origin.x + dir.x * t_enter - entry->x0;
+    f32 py = origin.y + dir.y * t_enter - entry->y0;
+    i32 col = Clamp(0, (i32) floorf(px / cell_size), (i32) tilemap->cols - 1);
+    i32 row = Clamp(0, (i32) floorf(py / cell_size), (i32) tilemap->rows - 1);
+
+    i32 step_x = (dir.x > 0) ? 1 : -1;
+    i32 step_y = (dir.y > 0) ? 1 : -1;
+    f32 next_x = (dir.x != 0) ? (entry->x0 + (col + (dir.x > 0)) * cell_size - origin.x) / dir.x : INFINITY;
+    f32 next_y = (dir.y != 0) ? (entry->y0 + (row + (dir.y > 0)) * cell_size - origin.y) / dir.y : INFINITY;
+    f32 delta_x = (dir.x != 0) ? cell_size / fabsf(dir.x) : INFINITY;
+    f32 delta_y = (dir.y != 0) ? cell_size / fabsf(dir.y) : INFINITY;
+
+    f32 at = t_enter;
+    while (at <= t_exit && col >= 0 && col < (i32) tilemap->cols && row >= 0 && row < (i32) tilemap->rows) {
+        if (tilemap_row_span(tilemap, row, col, col) & 1) {
+            *t = at;
+            *normal = n;
+            return true;
+        }
+        if (next_x < next_y) {
+            at = next_x;
+            next_x += delta_x;
+            col += step_x;
+            n = (Vector2) {(f32) -step_x, 0};
+        } else {
+            at = next_y;
+            next_y += delta_y;
+            row += step_y;
+            n = (Vector2) {0, (f32) -step_y};
+        }
+    }
+    return false;
+}
+
+internal bool spatial_ray_entry(const RayQuery *ray, const SpatialEntry *entry, f32 max_t, RayHit *hit) {
+    if (entry->entity == ray->ignore || (entry->mask & ray->mask) == 0) return false;
+
+    f32 t, t_exit;
+    Vector2 normal;
+    bool hits;
+    switch (world->colliders.shape[entry->entity]) {
+        case SHAPE_CIRC: {
+            f32 r = world->colliders.radius[entry->entity];
+            hits = spatial_ray_circle(ray->origin, ray->direction, (Vector2) {entry->x0 + r, entry->y0 + r}, r, max_t, &t, &normal);
+            break;
+        }
+        case SHAPE_TILEMAP: {
+            hits = spatial_ray_tilemap(ray->origin, ray->direction, entry, max_t, &t, &normal);
+            break;
+        }
+        default: {
+            hits = spatial_ray_box(ray->origin, ray->direction, entry->x0, entry->y0, entry->x1, entry->y1, max_t, &t, &t_exit, &normal);
+            break;
+        }
+    }
+    if (!hits) return false;
+
+    *hit = (RayHit) {
+        .entity = entry->entity,
+        .distance = t,
+        .point = {ray->origin.x + ray->direction.x * t, ray->origin.y + ray->direction.y * t},
+        .normal = normal,
+    };
+    return true;
+}
+
+internal inline bool spatial_hit_before(const RayHit *a, const RayHit *b) {
+    return a->distance < b->distance || (a->distance == b->distance && a->entity < b->entity);
+}
+
+// keeps hits[0..*count) sorted nearest first, once full the farthest falls off the end
+internal void spatial_record_hit(RayHit *hits, u32 max_hits, u32 *count, u32 *total, const RayHit *hit) {
+    for (u32 i = 0; i < Min(*count, max_hits); i++) {
+        if (hits[i].entity == hit->entity) return;
+    }
+    (*total)++;
+    if (max_hits == 0) return;
+
+    u32 i = Min(*count, max_hits - 1);
+    if (*count == max_hits && !spatial_hit_before(hit, &hits[i])) return;
+    for (; i > 0 && spatial_hit_before(hit, &hits[i - 1]); i--) {
+        hits[i] = hits[i - 1];
+    }
+    hits[i] = *hit;
+    *count = Min(*count + 1, max_hits);
+}
+
+// with `all` false hits[0] ends up the nearest hit, otherwise every hit goes through spatial_record_hit()
+internal u32 spatial_cast(const RayQuery *query, bool all, RayHit *hits, u32 max_hits, u32 *count) {
+    const SpatialIndex *index = &world->spatial;
+    RayHit nearest = {0};
+    u32 total = 0;
+    *count = 0;
+
+    RayQuery ray = *query;
+    f32 length = sqrtf(ray.direction.x * ray.direction.x + ray.direction.y * ray.direction.y);
+    if (length > 0 && ray.max_distance >= 0) {
+        ray.direction.x /= length;
+        ray.direction.y /= length;
+        const f32 max_t = ray.max_distance;
+
+        RayHit hit;
+        for (u32 i = 0; i < arrlen(index->large); i++) {
+            f32 limit = (!all && nearest.entity != ENTITY_NONE) ? nearest.distance : max_t;
+            if (!spatial_ray_entry(&ray, &index->large[i], limit, &hit)) continue;
+            if (all) {
+                spatial_record_hit(hits, max_hits, count, &total, &hit);
+            } else if (nearest.entity == ENTITY_NONE || spatial_hit_before(&hit, &nearest)) {
+                nearest = hit;
+            }
+        }
+
+        // grid walk, Amanatides & Woo. entries in several cells get tested once per cell, which is cheaper
+        // than remembering them, all hits drop the repeats and the nearest hit doesn't care
+        i32 cx = spatial_cell_f(ray.origin.x);
+        i32 cy = spatial_cell_f(ray.origin.y);
+        i32 step_x = (ray.direction.x > 0) ? 1 : -1;
+        i32 step_y = (ray.direction.y > 0) ? 1 : -1;
+        f32 next_x = (ray.direction.x != 0) ? ((cx + (ray.direction.x > 0)) * (f32) SPATIAL_CELL_SIZE - ray.origin.x) / ray.direction.x : INFINITY;
+        f32 next_y = (ray.direction.y != 0) ? ((cy + (ray.direction.y > 0)) * (f32) SPATIAL_CELL_SIZE - ray.origin.y) / ray.direction.y : INFINITY;
+        f32 delta_x = (ray.direction.x != 0) ? SPATIAL_CELL_SIZE / fabsf(ray.direction.x) : INFINITY;
+        f32 delta_y = (ray.direction.y != 0) ? SPATIAL_CELL_SIZE / fabsf(ray.direction.y) : INFINITY;
+
+        bool in_grid = arrlen(index->entries) > 0;
+        while (in_grid) {
+            u32 bucket = spatial_bucket(index, cx, cy);
+            for (u32 e = index->bucket_starts[bucket]; e < index->bucket_starts[bucket + 1]; e++) {
+                f32 limit = (!all && nearest.entity != ENTITY_NONE) ? nearest.distance : max_t;
+                if (!spatial_ray_entry(&ray, &index->entries[e], limit, &hit)) continue;
+                if (all) {
+                    spatial_record_hit(hits, max_hits, count, &total, &hit);
+                } else if (nearest.entity == ENTITY_NONE || spatial_hit_before(&hit, &nearest)) {
+                    nearest = hit;
+                }
+            }
+
+            // nothing in a later cell can come before a hit that's inside this one
+            f32 t_exit = Min(next_x, next_y);
+            if (!all && nearest.entity != ENTITY_NONE && nearest.distance <= t_exit) break;
+            if (t_exit > max_t) break;
+
+            if (next_x < next_y) {
+                next_x += delta_x;
+                cx += step_x;
+            } else {
+                next_y += delta_y;
+                cy += step_y;
+            }
+            // heading away from every occupied cell, unbounded rays would never stop otherwise
+            in_grid = (step_x > 0 ? cx <= index->cell_x1 : cx >= index->cell_x0)
+                   && (step_y > 0 ? cy <= index->cell_y1 : cy >= index->cell_y0);
+        }
+    }
+
+    if (!all) {
+        hits[0] = nearest;
+        *count = nearest.entity != ENTITY_NONE;
+    }
+    return total > max_hits;
+}
+
+internal void spatial_raycast_job(void *data, u32 begin, u32 end, u32 worker) {
+    SpatialJob *job = data;
+    const RayQuery *queries = job->queries;
+    world = job->world;
+
+    for (u32 i = begin; i < end; i++) {
+        u32 count;
+        spatial_cast(&queries[i], false, (RayHit *) job->results + i, 1, &count);
+    }
+}
+
+internal void spatial_raycast_all_job(void *data, u32 begin, u32 end, u32 worker) {
+    SpatialJob *job = data;
+    const RayQuery *queries = job->queries;
+    world = job->world;
+
+    u32 overflows = 0;
+    for (u32 i = begin; i < end; i++) {
+        overflows += spatial_cast(&queries[i], true, (RayHit *) job->results + (u64) i * job->max_results, job->max_results, &job->counts[i]);
+    }
+    if (overflows) ins_atomic_u32_add_eval(&job->overflows, overflows);
+}
+
+internal u32 spatial_run(JobRangeFunc *func, const void *queries, u32 num_queries, void *results, u32 max_results, u32 *counts) {
+    // pool threads don't have a world of their own
+    SpatialJob job = {
+        .world = world,
+        .queries = queries,
+        .results = results,
+        .max_results = max_results,
+        .counts = counts,
+    };
+    jobs_parallel_for(num_queries, SPATIAL_QUERY_BATCH, func, &job);
+    world = job.world;
+    return job.overflows;
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+void world_build_spatial_index() {
+    SpatialIndex *index = &world->spatial;
+
+    MemTag prev_tag = mem_set_tag(MEM_TAG_WORLD);
+    arrsetlen(index->items, 0);
+    arrsetlen(index->large, 0);
+    u32 num_cells = 0;
+    index->cell_x0 = index->cell_y0 = INT32_MAX;
+    index->cell_x1 = index->cell_y1 = INT32_MIN;
+    for (u32 i = 1; i < world->num_entities; i++) {
+        SpatialEntry entry;
+        if (!spatial_entity_bounds(i, &entry)) continue;
+
+        arrput(index->items, entry);
+        if (spatial_is_large(&entry)) {
+            arrput(index->large, entry);
+        } else {
+            num_cells += spatial_cell_count(spatial_cell(entry.x0), spatial_cell(entry.y0), spatial_cell(entry.x1), spatial_cell(entry.y1));
+            index->cell_x0 = Min(index->cell_x0, spatial_cell(entry.x0));
+            index->cell_y0 = Min(index->cell_y0, spatial_cell(entry.y0));
+            index->cell_x1 = Max(index->cell_x1, spatial_cell(entry.x1));
+            index->cell_y1 = Max(index->cell_y1, spatial_cell(entry.y1));
+        }
+    }
+
+    // at least twice as many buckets as occupied cells keeps the chains short
+    u32 num_buckets = SPATIAL_MIN_BUCKETS;
+    while (num_buckets < 2 * num_cells) num_buckets *= 2;
+    index->bucket_mask = num_buckets - 1;
+    arrsetlen(index->bucket_starts, num_buckets + 1);
+    memset(index->bucket_starts, 0, (num_buckets + 1) * sizeof(u32));
+
+    // counting sort: count, prefix sum to the end of every bucket, then fill backwards
+    // so each bucket comes out in entity order
+    u32 buckets[SPATIAL_MAX_CELLS];
+    for (u32 i = 0; i < arrlen(index->items); i++) {
+        if (spatial_is_large(&index->items[i])) continue;
+
+        u32 num_entry_buckets = spatial_entry_buckets(index, &index->items[i], buckets);
+        for (u32 b = 0; b < num_entry_buckets; b++) {
+            index->bucket_starts[buckets[b]]++;
+        }
+    }
+    for (u32 b = 1; b <= num_buckets; b++) {
+        index->bucket_starts[b] += index->bucket_starts[b - 1];
+    }
+
+    arrsetlen(index->entries, index->bucket_starts[num_buckets]);
+    for (u32 i = arrlen(index->items); i-- > 0;) {
+        if (spatial_is_large(&index->items[i])) continue;
+
+        u32 num_entry_buckets = spatial_entry_buckets(index, &index->items[i], buckets);
+        for (u32 b = 0; b < num_entry_buckets; b++) {
+            index->entries[--index->bucket_starts[buckets[b]]] = index->items[i];
+        }
+    }
+    mem_set_tag(prev_tag);
+}
+
+void world_cleanup_spatial_index() {
+    SpatialIndex *index = &world->spatial;
+    arrfree(index->bucket_starts);
+    arrfree(index->entries);
+    arrfree(index->large);
+    arrfree(index->items);
+    arrfree(index->candidates);
+    *index = (SpatialIndex) {0};
+}
+
+u32 world_query_aabb(const AabbQuery *queries, u32 num_queries, Entity *results, u32 max_results, u32 *counts) {
+    return spatial_run(spatial_aabb_job, queries, num_queries, results, max_results, counts);
+}
+
+u32 world_query_circle(const CircleQuery *queries, u32 num_queries, Entity *results, u32 max_results, u32 *counts) {
+    return spatial_run(spatial_circle_job, queries, num_queries, results, max_results, counts);
+}
+
+void world_raycast(const RayQuery *queries, u32 num_queries, RayHit *hits) {
+    spatial_run(spatial_raycast_job, queries, num_queries, hits, 1, NULL);
+}
+
+u32 world_raycast_all(const RayQuery *queries, u32 num_queries, RayHit *hits, u32 max_hits, u32 *counts) {
+    return spatial_run(spatial_raycast_all_job, queries, num_queries, hits, max_hits, counts);
+}
+
+void spatial_index_candidates(Entity entity, i32 margin, Entity **candidates) {
+    SpatialEntry self;
+    if (!spatial_entity_bounds(entity, &self)) return;
+
+    SpatialShapeQuery query = {
+        .x0 = self.x0 - margin,
+        .y0 = self.y0 - margin,
+        .x1 = self.x1 + margin,
+        .y1 = self.y1 + margin,
+        .any_mask = true,
+        .above = entity,
+        .bounds_only = true,
+    };
+    u32 first = arrlen(*candidates);
+    SpatialResults out = {.array = candidates};
+    spatial_collect(&world->spatial, &query, &out);
+    spatial_sort_entities(*candidates + first, arrlen(*candidates) - first);
+}
+
+void spatial_index_visible(Rectangle view, Entity **visible) {
+    SpatialShapeQuery query = {
+        .x0 = view.x,
+        .y0 = view.y,
+        .x1 = view.x + view.width,
+        .y1 = view.y + view.height,
+        .any_mask = true,
+        .bounds_only = true,
+    };
+    u32 first = arrlen(*visible);
+    SpatialResults out = {.array = visible};
+    spatial_collect(&world->spatial, &query, &out);
+    spatial_sort_entities(*visible + first, arrlen(*visible) - first);
+}
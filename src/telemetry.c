@@ -0,0 +1,83 @@
+#include "game.h"
+#include "telemetry.h"
+
+// ----------------------------------------------------------------------------
+// Live telemetry writer, see telemetry.h
+
+internal void telemetry_write_columns(const TelemetryHeader *header, TelemetryFrame *frame, u32 num_entities) {
+    // the fixed columns go straight across, values are already 4 bytes wide
+    memcpy(telemetry_column(header, frame, TELEMETRY_COMPONENTS), world->infos.components, num_entities * sizeof(u32));
+    memcpy(telemetry_column(header, frame, TELEMETRY_POSITION_X), world->positions.x, num_entities * sizeof(i32));
+    memcpy(telemetry_column(header, frame, TELEMETRY_POSITION_Y), world->positions.y, num_entities * sizeof(i32));
+    memcpy(telemetry_column(header, frame, TELEMETRY_VELOCITY_X), world->movements.vel_x, num_entities * sizeof(f32));
+    memcpy(telemetry_column(header, frame, TELEMETRY_VELOCITY_Y), world->movements.vel_y, num_entities * sizeof(f32));
+
+    f32 *bounds_x = telemetry_column(header, frame, TELEMETRY_BOUNDS_X);
+    f32 *bounds_y = telemetry_column(header, frame, TELEMETRY_BOUNDS_Y);
+    f32 *bounds_w = telemetry_column(header, frame, TELEMETRY_BOUNDS_WIDTH);
+    f32 *bounds_h = telemetry_column(header, frame, TELEMETRY_BOUNDS_HEIGHT);
+    for (u32 i = 0; i < num_entities; i++) {
+        Rectangle bounds = {0};
+        entity_get_bounds(i, &bounds);
+        bounds_x[i] = bounds.x;
+        bounds_y[i] = bounds.y;
+        bounds_w[i] = bounds.width;
+        bounds_h[i] = bounds.height;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Implementation
+
+bool telemetry_start(TelemetryWriter *writer, u32 max_entities) {
+    *writer = (TelemetryWriter) {0};
+    if (!os_shared_memory_create(&writer->memory, TELEMETRY_SEGMENT_NAME, telemetry_segment_size(max_entities))) {
+        fprintf(stderr, "telemetry: couldn't create shared memory '%s'\n", TELEMETRY_SEGMENT_NAME);
+        return false;
+    }
+
+    // frames start out zeroed with an even sequence, readers see an empty frame 0 until the first publish
+    TelemetryHeader *header = writer->memory.base;
+    header->max_entities = max_entities;
+    header->frame_bytes = (u32) telemetry_frame_size(max_entities);
+    header->latest = 0;
+    header->version = TELEMETRY_VERSION;
+    header->alive = 1;
+    // the magic last, a reader that sees it sees everything above too
+    ins_atomic_fence();
+    ins_atomic_u32_eval_assign(&header->magic, TELEMETRY_MAGIC);
+
+    writer->header = header;
+    return true;
+}
+
+void telemetry_publish(TelemetryWriter *writer, u64 tick) {
+    TelemetryHeader *header = writer->header;
+    if (!header) return;
+
+    u32 index = (header->latest + 1) % TELEMETRY_FRAMES;
+    TelemetryFrame *frame = telemetry_frame(header, index);
+
+    ins_atomic_u32_eval_assign(&frame->sequence, frame->sequence + 1);
+    ins_atomic_fence();
+
+    u32 num_entities = Min(world->num_entities, header->max_entities);
+    frame->num_entities = num_entities;
+    frame->total_entities = world->num_entities;
+    frame->tick = tick;
+    frame->time = os_now_seconds();
+    telemetry_write_columns(header, frame, num_entities);
+
+    ins_atomic_fence();
+    ins_atomic_u32_eval_assign(&frame->sequence, frame->sequence + 1);
+    ins_atomic_u32_eval_assign(&header->latest, index);
+}
+
+void telemetry_stop(TelemetryWriter *writer) {
+    if (!writer->header) return;
+
+    // readers that still have it mapped keep the memory, they just stop getting new frames
+    ins_atomic_u32_eval_assign(&writer->header->alive, 0);
+    os_shared_memory_close(&writer->memory);
+    *writer = (TelemetryWriter) {0};
+}
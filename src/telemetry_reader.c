@@ -0,0 +1,123 @@
+#include "telemetry.h"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// Telemetry reader, attaches to a running game's telemetry segment and prints
+// what it sees, without raylib and without ever blocking the simulation
+// usage: prong_telemetry_reader [num_rows] [interval_seconds]
+// the game exports while its telemetry toggle is on (the 5 key, or PRONG_TELEMETRY=1)
+
+// give up on a frame after this many torn copies, the writer is lapping us
+internal const u32 READER_MAX_ATTEMPTS = 64;
+
+typedef struct {
+    TelemetryFrame frame;
+    u32 *columns[TELEMETRY_COLUMN_COUNT];
+    u32 num_rows;
+    // copies thrown away because the writer came around mid copy
+    u32 retries;
+} TelemetryCopy;
+
+// seqlock read of the newest frame, only the first `copy->num_rows` rows of every column are copied
+internal bool telemetry_read(const TelemetryHeader *header, TelemetryCopy *copy) {
+    for (u32 attempt = 0; attempt < READER_MAX_ATTEMPTS; attempt++) {
+        u32 index = ins_atomic_u32_load(&header->latest) % TELEMETRY_FRAMES;
+        TelemetryFrame *frame = telemetry_frame(header, index);
+
+        u32 sequence = ins_atomic_u32_load(&frame->sequence);
+        if (sequence & 1) {
+            copy->retries++;
+            continue;
+        }
+        ins_atomic_fence();
+
+        copy->frame = *frame;
+        u32 num_rows = Min(copy->num_rows, Min(copy->frame.num_entities, header->max_entities));
+        for (u32 column = 0; column < TELEMETRY_COLUMN_COUNT; column++) {
+            memcpy(copy->columns[column], telemetry_column(header, frame, column), num_rows * sizeof(u32));
+        }
+
+        ins_atomic_fence();
+        if (ins_atomic_u32_load(&frame->sequence) == sequence) {
+            copy->frame.num_entities = num_rows;
+            return true;
+        }
+        copy->retries++;
+    }
+    return false;
+}
+
+internal void telemetry_print(const TelemetryCopy *copy, u64 prev_tick, f64 prev_time) {
+    const TelemetryFrame *frame = &copy->frame;
+    f64 elapsed = frame->time - prev_time;
+    f64 tick_rate = (prev_time > 0 && elapsed > 0) ? (f64) (frame->tick - prev_tick) / elapsed : 0;
+    printf("tick %llu, entities %u, %.1f ticks/s, %u torn reads\n",
+           (unsigned long long) frame->tick, frame->total_entities, tick_rate, copy->retries);
+
+    const i32 *x = (const i32 *) copy->columns[TELEMETRY_POSITION_X];
+    const i32 *y = (const i32 *) copy->columns[TELEMETRY_POSITION_Y];
+    const f32 *vel_x = (const f32 *) copy->columns[TELEMETRY_VELOCITY_X];
+    const f32 *vel_y = (const f32 *) copy->columns[TELEMETRY_VELOCITY_Y];
+    const f32 *bounds_w = (const f32 *) copy->columns[TELEMETRY_BOUNDS_WIDTH];
+    const f32 *bounds_h = (const f32 *) copy->columns[TELEMETRY_BOUNDS_HEIGHT];
+    for (u32 i = 0; i < frame->num_entities; i++) {
+        printf("  %5u  mask %02x  pos %6d %6d  vel %8.1f %8.1f  size %5.0f x %-5.0f\n",
+               i, copy->columns[TELEMETRY_COMPONENTS][i], x[i], y[i], vel_x[i], vel_y[i], bounds_w[i], bounds_h[i]);
+    }
+}
+
+int main(int argc, char **argv) {
+    u32 num_rows    = (argc > 1) ? (u32) atoi(argv[1]) : 8;
+    f64 interval    = (argc > 2) ? atof(argv[2]) : 1.0;
+
+    // the game might not be up yet, or not exporting yet
+    OsSharedMemory memory = {0};
+    printf("waiting for '%s'...\n", TELEMETRY_SEGMENT_NAME);
+    while (!os_shared_memory_open(&memory, TELEMETRY_SEGMENT_NAME)) {
+        os_sleep_seconds(0.25);
+    }
+
+    const TelemetryHeader *header = memory.base;
+    while (ins_atomic_u32_load(&header->magic) != TELEMETRY_MAGIC) {
+        os_sleep_seconds(0.01);
+    }
+    ins_atomic_fence();
+    if (header->version != TELEMETRY_VERSION || memory.size < telemetry_segment_size(header->max_entities)) {
+        fprintf(stderr, "telemetry: segment version %u with %u entities doesn't match this reader (version %u)\n",
+                header->version, header->max_entities, TELEMETRY_VERSION);
+        os_shared_memory_close(&memory);
+        return 1;
+    }
+
+    TelemetryCopy copy = {.num_rows = Min(num_rows, header->max_entities)};
+    for (u32 column = 0; column < TELEMETRY_COLUMN_COUNT; column++) {
+        copy.columns[column] = calloc(Max(copy.num_rows, 1), sizeof(u32));
+    }
+
+    u64 prev_tick = 0;
+    f64 prev_time = 0;
+    while (ins_atomic_u32_load(&header->alive)) {
+        if (telemetry_read(header, &copy)) {
+            telemetry_print(&copy, prev_tick, prev_time);
+            prev_tick = copy.frame.tick;
+            prev_time = copy.frame.time;
+        } else {
+            printf("no consistent frame after %u attempts\n", READER_MAX_ATTEMPTS);
+        }
+        os_sleep_seconds(interval);
+    }
+    printf("writer stopped\n");
+
+    for (u32 column = 0; column < TELEMETRY_COLUMN_COUNT; column++) {
+        free(copy.columns[column]);
+    }
+    os_shared_memory_close(&memory);
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Include single file header implementations
+
+#define STB_DS_IMPLEMENTATION
+#include "stb_ds.h"
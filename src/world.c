@@ -4,7 +4,17 @@ internal bool entity_move_x(Entity entity, f32 amount);
 internal bool entity_move_y(Entity entity, f32 amount);
 
 internal bool entities_overlap(Entity a, Entity b, int offset_x, int offset_y);
-internal void entities_resolve_collision(Entity a, Entity b);
+internal bool tilemap_overlaps(Entity map, Entity body, i32 offset_x, i32 offset_y);
+
+internal void entity_add_builtin(Entity entity, ComponentMask component);
+
+internal void world_build_collider_blocks();
+internal u32 collider_block_candidates(const ColliderBlock *block, i32 x0, i32 y0, i32 x1, i32 y1, CollisionMask mask);
+internal void world_resolve_overlaps(f32 dt);
+internal void world_queue_hit_event(Entity entity, Entity other, Axis axis, i32 sign, OnHitFunc on_hit);
+internal void world_dispatch_hit_events();
+
+internal f64 world_stats_clock();
 
 internal void entity_create_infos();
 internal void entity_create_names();
@@ -17,19 +27,35 @@ internal void entity_cleanup_names();
 internal void entity_cleanup_positions();
 internal void entity_cleanup_velocities();
 internal void entity_cleanup_colliders();
+internal void entity_cleanup_hit_events();
 
-internal void world_log();
+// every world starts out on the same stream, owners that want their own reseed it
+internal const u64 WORLD_RNG_SEED = 0x57304C44;
 
 // -----------------------------------------------------------------------------
 // Implementation
 
+thread_static World *world = NULL;
+
 void world_init() {
-    if (world.initialized) {
+    if (world->initialized) {
         world_cleanup();
     }
 
-    world = (World) {0};
-    world.initialized = true;
+    *world = (World) {0};
+    world->initialized = true;
+    rng_seed(&world->rng, WORLD_RNG_SEED);
+
+    world->solver = (ContactSolver) {
+        .iterations = 8,
+        .warm_start = 0.9f,
+        .bounce_threshold = 30,
+        .position_slop = 1,
+        .position_correction = 0.5f,
+        .contact_margin = 1,
+        .sleep_speed = 15,
+        .sleep_seconds = 0.5f,
+    };
 
     // reserve the '0' entity id to represent 'no entity'
     world_create_entity();
@@ -37,198 +63,359 @@ void world_init() {
 }
 
 void world_update(f32 dt) {
-    if (!world.initialized) {
+    if (!world->initialized) {
         world_init();
     }
 
-    if (state.debug.log) {
-        world_log();
-    }
+    world->stats = (WorldStats) {0};
+    world_build_collider_blocks();
 
-    for (u32 i = 0; i < world.num_entities; i++) {
+    // move everything, swept moves stop short of MASK_BOUNDS colliders as they go
+    f64 move_start = world_stats_clock();
+    for (u32 i = 0; i < world->num_entities; i++) {
         bool has_position = entity_has_components(i, COMPONENT_POSITION);
         bool has_velocity = entity_has_components(i, COMPONENT_MOVEMENT);
-        bool has_collider = entity_has_components(i, COMPONENT_COLLIDER);
 
         if (has_position) {
-            world.positions.prev_x[i] = world.positions.x[i];
-            world.positions.prev_y[i] = world.positions.y[i];
+            world->positions.prev_x[i] = world->positions.x[i];
+            world->positions.prev_y[i] = world->positions.y[i];
         }
 
         f32 move_x = 0;
         f32 move_y = 0;
-        if (has_velocity) {
-            if (world.movements.friction[i] > 0) {
-                world.movements.vel_x[i] = calc_approach(world.movements.vel_x[i], 0, world.movements.friction[i] * dt);
-                world.movements.vel_y[i] = calc_approach(world.movements.vel_y[i], 0, world.movements.friction[i] * dt);
+        if (has_velocity && world->movements.asleep[i]) {
+            world->stats.sleeping_bodies++;
+        } else if (has_velocity) {
+            if (world->movements.friction[i] > 0) {
+                world->movements.vel_x[i] = calc_approach(world->movements.vel_x[i], 0, world->movements.friction[i] * dt);
+                world->movements.vel_y[i] = calc_approach(world->movements.vel_y[i], 0, world->movements.friction[i] * dt);
             }
 
             // TODO - set gravity direction, for now just apply to y
-            if (world.movements.gravity[i] != 0) {
-                world.movements.vel_y[i] += world.movements.gravity[i] * dt;
+            if (world->movements.gravity[i] != 0) {
+                world->movements.vel_y[i] += world->movements.gravity[i] * dt;
             }
 
-            f32 total_move_x = world.movements.remainder_x[i] + world.movements.vel_x[i] * dt;
-            f32 total_move_y = world.movements.remainder_y[i] + world.movements.vel_y[i] * dt;
+            f32 total_move_x = world->movements.remainder_x[i] + world->movements.vel_x[i] * dt;
+            f32 total_move_y = world->movements.remainder_y[i] + world->movements.vel_y[i] * dt;
             move_x = (i32) total_move_x;
             move_y = (i32) total_move_y;
-            world.movements.remainder_x[i] = total_move_x - move_x;
-            world.movements.remainder_y[i] = total_move_y - move_y;
+            world->movements.remainder_x[i] = total_move_x - move_x;
+            world->movements.remainder_y[i] = total_move_y - move_y;
         }
 
         if (has_position) {
             entity_move_x(i, move_x);
             entity_move_y(i, move_y);
         }
+    }
+
+    // then push apart whatever ended up overlapping
+    f64 overlap_start = world_stats_clock();
+    world->stats.move_seconds = overlap_start - move_start;
+    world_resolve_overlaps(dt);
+    world->stats.overlap_seconds = world_stats_clock() - overlap_start;
+
+    // physics is done, now let user code react to this tick's hits
+    if (world->defer_hit_events) {
+        f64 dispatch_start = world_stats_clock();
+        world_dispatch_hit_events();
+        world->stats.dispatch_seconds = world_stats_clock() - dispatch_start;
+    }
 
-        if (has_collider) {
-            for (u32 j = 0; j < world.num_entities; j++) {
-                if (i == j) continue;
+    // creates, destroys and component changes recorded during the tick
+    world_apply_commands();
 
-                bool other_has_collider = entity_has_components(j, COMPONENT_COLLIDER);
-                if (other_has_collider) {
-                    if (entities_overlap(i, j, 0, 0)) {
-                        entities_resolve_collision(i, j);
-                    }
-                }
-            }
-        }
+    if (world->spatial_queries) {
+        world_build_spatial_index();
+    }
+
+    if (world->collect_checksums) {
+        world->checksum = world_checksum();
     }
 }
 
 void world_cleanup() {
-    if (world.initialized) {
+    if (world->initialized) {
         entity_cleanup_infos();
         entity_cleanup_names();
         entity_cleanup_positions();
         entity_cleanup_velocities();
         entity_cleanup_colliders();
+        entity_cleanup_hit_events();
+        world_cleanup_registry();
+        world_cleanup_commands();
+        world_cleanup_spatial_index();
+        world_cleanup_compaction();
+        narrow_phase_free(&world->narrow_phase);
+        contact_solver_free(&world->solver);
     }
-    world = (World) {0};
+    *world = (World) {0};
 }
 
 Entity world_create_entity() {
     // ensure that we have an initialized world before creating any entities
-    if (!world.initialized) {
+    if (!world->initialized) {
         world_init();
     }
 
     // return the next unused entity id
-    u32 next_entity_id = world.num_entities++;
+    u32 next_entity_id = world->num_entities++;
 
     // TODO - scan for available slots first, if there is one pass the index into `entity_add_<component>()`
     //  to zero out the arrays for that entity's slot, see comment in world_destroy_entity()
 
     // add an 'empty' element to each component array for the new entity
+    MemTag prev_tag = mem_set_tag(MEM_TAG_WORLD);
     entity_create_infos();
     entity_create_names();
     entity_create_positions();
     entity_create_velocities();
     entity_create_colliders();
+    mem_set_tag(prev_tag);
 
     // mark this entity as in use and active
-    world.infos.active[next_entity_id] = true;
-    world.infos.in_use[next_entity_id] = true;
+    world->infos.active[next_entity_id] = true;
+    world->infos.in_use[next_entity_id] = true;
 
     return next_entity_id;
 }
 
 void world_destroy_entity(Entity entity) {
-    // TODO -
-    //   then when creating a new entity, don't always increment world.num_entities,
+    if (entity == ENTITY_NONE || entity >= world->num_entities || !world->infos.in_use[entity]) {
+        return;
+    }
+
+    // registered components first, their sparse sets point back at the entity
+    ComponentSignature signature = world->infos.signatures[entity];
+    for (u32 word = 0; word < ArrayCount(signature.bits); word++) {
+        u64 bits = signature.bits[word];
+        if (word == 0) bits &= ~((1ull << COMPONENT_BUILTIN_COUNT) - 1);
+        for (; bits != 0; bits &= bits - 1) {
+            entity_remove_component(entity, word * 64 + ctz64(bits));
+        }
+    }
+
+    arrfree(world->colliders.tilemaps[entity].cells);
+    world->colliders.tilemaps[entity] = (Tilemap) {0};
+    world->colliders.shape[entity] = SHAPE_NONE;
+    world->colliders.mask[entity] = MASK_NONE;
+    world->colliders.on_hit_x[entity] = NULL;
+    world->colliders.on_hit_y[entity] = NULL;
+    world->names.name[entity] = NAME_EMPTY;
+
+    world->infos.components[entity] = COMPONENT_NONE;
+    world->infos.signatures[entity] = (ComponentSignature) {0};
+    world->infos.active[entity] = false;
+    world->infos.in_use[entity] = false;
+
+    // TODO - the slot itself isn't reused yet,
+    //   then when creating a new entity, don't always increment world->num_entities,
     //   instead first check for any unused entity slots and return one of those if available,
-    //   otherwise increment world.num_entities and add a new slot
+    //   otherwise increment world->num_entities and add a new slot
 }
 
 bool entity_has_components(Entity entity, ComponentMask mask) {
-    bool is_invalid = (entity == ENTITY_NONE || entity >= world.num_entities); // TODO - equality too? double check
-    bool is_unused = !world.infos.in_use[entity];
+    bool is_invalid = (entity == ENTITY_NONE || entity >= world->num_entities); // TODO - equality too? double check
+    bool is_unused = !world->infos.in_use[entity];
     if (is_invalid && is_unused) {
         return false;
     }
 
-    return (world.infos.components[entity] & mask) == mask;
+    return (world->infos.components[entity] & mask) == mask;
+}
+
+bool entity_get_bounds(Entity entity, Rectangle *bounds) {
+    if (!entity_has_components(entity, COMPONENT_POSITION)) {
+        return false;
+    }
+
+    f32 x = world->positions.x[entity];
+    f32 y = world->positions.y[entity];
+    if (!entity_has_components(entity, COMPONENT_COLLIDER)) {
+        *bounds = (Rectangle) {x, y, 0, 0};
+        return true;
+    }
+
+    // circles are positioned by their center, rects by their corner
+    x += world->colliders.offset_x[entity];
+    y += world->colliders.offset_y[entity];
+    if (world->colliders.shape[entity] == SHAPE_CIRC) {
+        f32 r = world->colliders.radius[entity];
+        *bounds = (Rectangle) {x - r, y - r, 2 * r, 2 * r};
+    } else {
+        *bounds = (Rectangle) {x, y, world->colliders.width[entity], world->colliders.height[entity]};
+    }
+    return true;
+}
+
+void world_query_visible(Rectangle view, Entity **visible) {
+    // an aabb query that takes every positioned entity, colliders or not, by bounds alone
+    spatial_index_visible(view, visible);
 }
 
 void entity_add_name(Entity entity, NameStr name) {
-    world.infos.components[entity] |= COMPONENT_NAME;
+    entity_add_builtin(entity, COMPONENT_NAME);
 
-    strcpy_s(world.names.name[entity].val, NAME_MAX_LEN, name.val);
+    strcpy_s(world->names.name[entity].val, NAME_MAX_LEN, name.val);
 }
 
 void entity_add_position(Entity entity, u32 x, u32 y) {
-    world.infos.components[entity] |= COMPONENT_POSITION;
+    entity_add_builtin(entity, COMPONENT_POSITION);
 
-    world.positions.x[entity] = x;
-    world.positions.y[entity] = y;
-    world.positions.prev_x[entity] = x;
-    world.positions.prev_y[entity] = y;
+    world->positions.x[entity] = x;
+    world->positions.y[entity] = y;
+    world->positions.prev_x[entity] = x;
+    world->positions.prev_y[entity] = y;
 }
 
 void entity_add_velocity(Entity entity, f32 vel_x, f32 vel_y, f32 friction, f32 gravity) {
-    world.infos.components[entity] |= COMPONENT_MOVEMENT;
+    entity_add_builtin(entity, COMPONENT_MOVEMENT);
+
+    world->movements.vel_x[entity] = vel_x;
+    world->movements.vel_y[entity] = vel_y;
+    world->movements.remainder_x[entity] = 0;
+    world->movements.remainder_y[entity] = 0;
+    world->movements.friction[entity] = friction;
+    world->movements.gravity[entity] = gravity;
+    world->movements.inv_mass[entity] = 1;
+    world->movements.restitution[entity] = 1;
+    world->movements.contact_friction[entity] = 0;
+    entity_wake(entity);
+}
+
+void entity_set_body(Entity entity, f32 mass, f32 restitution, f32 contact_friction) {
+    world->movements.inv_mass[entity] = (mass > 0) ? 1 / mass : 0;
+    world->movements.restitution[entity] = restitution;
+    world->movements.contact_friction[entity] = contact_friction;
+    entity_wake(entity);
+}
 
-    world.movements.vel_x[entity] = vel_x;
-    world.movements.vel_y[entity] = vel_y;
-    world.movements.remainder_x[entity] = 0;
-    world.movements.remainder_y[entity] = 0;
-    world.movements.friction[entity] = friction;
-    world.movements.gravity[entity] = gravity;
+void entity_wake(Entity entity) {
+    world->movements.sleep_seconds[entity] = 0;
+    world->movements.asleep[entity] = false;
 }
 
 void entity_add_collider_rect(Entity entity, CollisionMask mask, u32 offset_x, u32 offset_y, u32 width, u32 height) {
-    world.infos.components[entity] |= COMPONENT_COLLIDER;
+    entity_add_builtin(entity, COMPONENT_COLLIDER);
+
+    world->colliders.offset_x[entity] = offset_x;
+    world->colliders.offset_y[entity] = offset_y;
+    world->colliders.width[entity] = width;
+    world->colliders.height[entity] = height;
+    world->colliders.radius[entity] = calc_max(width, height) / 2;
+    world->colliders.shape[entity] = SHAPE_RECT;
+    world->colliders.mask[entity] = mask;
+    world->colliders.on_hit_x[entity] = NULL;
+    world->colliders.on_hit_y[entity] = NULL;
+}
 
-    world.colliders.offset_x[entity] = offset_x;
-    world.colliders.offset_y[entity] = offset_y;
-    world.colliders.width[entity] = width;
-    world.colliders.height[entity] = height;
-    world.colliders.radius[entity] = calc_max(width, height) / 2;
-    world.colliders.shape[entity] = SHAPE_RECT;
-    world.colliders.mask[entity] = mask;
-    world.colliders.on_hit_x[entity] = NULL;
-    world.colliders.on_hit_y[entity] = NULL;
+void entity_add_collider_tilemap(Entity entity, CollisionMask mask, u32 offset_x, u32 offset_y, u32 cell_size, u32 cols, u32 rows) {
+    entity_add_builtin(entity, COMPONENT_COLLIDER);
+
+    world->colliders.offset_x[entity] = offset_x;
+    world->colliders.offset_y[entity] = offset_y;
+    world->colliders.width[entity] = cols * cell_size;
+    world->colliders.height[entity] = rows * cell_size;
+    world->colliders.radius[entity] = 0;
+    world->colliders.shape[entity] = SHAPE_TILEMAP;
+    world->colliders.mask[entity] = mask;
+    world->colliders.on_hit_x[entity] = NULL;
+    world->colliders.on_hit_y[entity] = NULL;
+
+    Tilemap *tilemap = &world->colliders.tilemaps[entity];
+    tilemap->cols = cols;
+    tilemap->rows = rows;
+    tilemap->cell_size = cell_size;
+    tilemap->words_per_row = (cols + 63) / 64;
+
+    MemTag prev_tag = mem_set_tag(MEM_TAG_WORLD);
+    arrsetlen(tilemap->cells, tilemap->words_per_row * rows);
+    mem_set_tag(prev_tag);
+    memset(tilemap->cells, 0, tilemap->words_per_row * rows * sizeof(u64));
 }
 
-void entity_add_collider_circ(Entity entity, CollisionMask mask, u32 offset_x, u32 offset_y, u32 radius) {
-    world.infos.components[entity] |= COMPONENT_COLLIDER;
+void entity_set_tile(Entity entity, u32 col, u32 row, bool solid) {
+    Tilemap *tilemap = &world->colliders.tilemaps[entity];
+    if (col >= tilemap->cols || row >= tilemap->rows) return;
+
+    u64 *word = &tilemap->cells[row * tilemap->words_per_row + col / 64];
+    u64 bit = 1ull << (col % 64);
+    *word = solid ? (*word | bit) : (*word & ~bit);
+}
 
-    world.colliders.offset_x[entity] = offset_x;
-    world.colliders.offset_y[entity] = offset_y;
-    world.colliders.width[entity] = 2 * radius;
-    world.colliders.height[entity] = 2 * radius;
-    world.colliders.radius[entity] = radius;
-    world.colliders.shape[entity] = SHAPE_CIRC;
-    world.colliders.mask[entity] = mask;
-    world.colliders.on_hit_x[entity] = NULL;
-    world.colliders.on_hit_y[entity] = NULL;
+void entity_add_collider_circ(Entity entity, CollisionMask mask, u32 offset_x, u32 offset_y, u32 radius) {
+    entity_add_builtin(entity, COMPONENT_COLLIDER);
+
+    world->colliders.offset_x[entity] = offset_x;
+    world->colliders.offset_y[entity] = offset_y;
+    world->colliders.width[entity] = 2 * radius;
+    world->colliders.height[entity] = 2 * radius;
+    world->colliders.radius[entity] = radius;
+    world->colliders.shape[entity] = SHAPE_CIRC;
+    world->colliders.mask[entity] = mask;
+    world->colliders.on_hit_x[entity] = NULL;
+    world->colliders.on_hit_y[entity] = NULL;
 }
 
 // -----------------------------------------------------------------------------
 // Internal implementation
 
-internal bool entities_overlap(Entity a, Entity b, int offset_x, int offset_y) {
-    i32 a_x = world.positions.x[a] + world.colliders.offset_x[a] + offset_x;
-    i32 a_y = world.positions.y[a] + world.colliders.offset_y[a] + offset_y;
-    i32 b_x = world.positions.x[b] + world.colliders.offset_x[b];
-    i32 b_y = world.positions.y[b] + world.colliders.offset_y[b];
+// builtin components are tracked in both the fast ComponentMask and the wide signature
+internal void entity_add_builtin(Entity entity, ComponentMask component) {
+    world->infos.components[entity] |= component;
+
+    for (ComponentId id = 0; id < COMPONENT_BUILTIN_COUNT; id++) {
+        if (component & (1 << id)) {
+            signature_set(&world->infos.signatures[entity], id);
+        }
+    }
+}
 
-    switch (world.colliders.shape[a]) {
+internal bool entities_overlap(Entity a, Entity b, int offset_x, int offset_y) {
+    world->stats.collision_checks++;
+
+    const ColliderBlock *block_a = &world->collider_blocks[a / COLLIDER_BLOCK_LANES];
+    const ColliderBlock *block_b = &world->collider_blocks[b / COLLIDER_BLOCK_LANES];
+    const u32 lane_a = a % COLLIDER_BLOCK_LANES;
+    const u32 lane_b = b % COLLIDER_BLOCK_LANES;
+    const Shape shape_a = block_a->shape[lane_a];
+    const Shape shape_b = block_b->shape[lane_b];
+
+    // tilemaps answer from their cells, whichever side of the test they're on
+    if (shape_b == SHAPE_TILEMAP) return tilemap_overlaps(b, a, offset_x, offset_y);
+    if (shape_a == SHAPE_TILEMAP) return tilemap_overlaps(a, b, -offset_x, -offset_y);
+
+    // blocks hold the corner of the bounds, circles are tested from their center
+    i32 a_x = block_a->x[lane_a] + offset_x;
+    i32 a_y = block_a->y[lane_a] + offset_y;
+    i32 b_x = block_b->x[lane_b];
+    i32 b_y = block_b->y[lane_b];
+
+    switch (shape_a) {
         case SHAPE_CIRC: {
-            i32 a_r = world.colliders.radius[a];
-            switch (world.colliders.shape[b]) {
-                case SHAPE_CIRC: return circ_circ_overlaps(a_x, a_y, a_r, b_x, b_y, world.colliders.radius[b]);
-                case SHAPE_RECT: return circ_rect_overlaps(a_x, a_y, a_r, b_x, b_y, world.colliders.width[b], world.colliders.height[b]);
+            i32 a_r = block_a->radius[lane_a];
+            a_x += a_r;
+            a_y += a_r;
+            switch (shape_b) {
+                case SHAPE_CIRC: {
+                    i32 b_r = block_b->radius[lane_b];
+                    return circ_circ_overlaps(a_x, a_y, a_r, b_x + b_r, b_y + b_r, b_r);
+                }
+                case SHAPE_RECT: return circ_rect_overlaps(a_x, a_y, a_r, b_x, b_y, block_b->width[lane_b], block_b->height[lane_b]);
                 case SHAPE_NONE:
                 default: break;
             }
         } break;
         case SHAPE_RECT: {
-            i32 a_w = world.colliders.width[a];
-            i32 a_h = world.colliders.height[a];
-            switch (world.colliders.shape[b]) {
-                case SHAPE_CIRC: return circ_rect_overlaps(b_x, b_y, world.colliders.radius[b], a_x, a_y, a_w, a_h);
-                case SHAPE_RECT: return rect_rect_overlaps(a_x, a_y, a_w, a_h, b_x, b_y, world.colliders.width[b], world.colliders.height[b]);
+            i32 a_w = block_a->width[lane_a];
+            i32 a_h = block_a->height[lane_a];
+            switch (shape_b) {
+                case SHAPE_CIRC: {
+                    i32 b_r = block_b->radius[lane_b];
+                    return circ_rect_overlaps(b_x + b_r, b_y + b_r, b_r, a_x, a_y, a_w, a_h);
+                }
+                case SHAPE_RECT: return rect_rect_overlaps(a_x, a_y, a_w, a_h, b_x, b_y, block_b->width[lane_b], block_b->height[lane_b]);
                 case SHAPE_NONE:
                 default: break;
             }
@@ -241,136 +428,324 @@ internal bool entities_overlap(Entity a, Entity b, int offset_x, int offset_y) {
     return false;
 }
 
-internal void entities_resolve_collision(Entity a, Entity b) {
-    switch (world.colliders.shape[a]) {
-        case SHAPE_CIRC: {
-            switch (world.colliders.shape[b]) {
-                case SHAPE_CIRC: circ_circ_resolve(a, b); break;
-                case SHAPE_RECT: circ_rect_resolve(a, b); break;
-                case SHAPE_NONE:
-                default: break;
+// only the solid cells under the body's bounds are tested, however big the map is
+internal bool tilemap_overlaps(Entity map, Entity body, i32 offset_x, i32 offset_y) {
+    const ColliderBlock *block = &world->collider_blocks[body / COLLIDER_BLOCK_LANES];
+    const u32 lane = body % COLLIDER_BLOCK_LANES;
+    const Shape body_shape = block->shape[lane];
+    if (body_shape != SHAPE_CIRC && body_shape != SHAPE_RECT) return false;
+
+    const ColliderBlock *map_block = &world->collider_blocks[map / COLLIDER_BLOCK_LANES];
+    Tilemap *tilemap = &world->colliders.tilemaps[map];
+    const i32 cell_size = tilemap->cell_size;
+    const i32 map_x = map_block->x[map % COLLIDER_BLOCK_LANES];
+    const i32 map_y = map_block->y[map % COLLIDER_BLOCK_LANES];
+
+    // grown by a pixel, circles count as overlapping cells they only touch
+    const i32 body_x = block->x[lane] + offset_x;
+    const i32 body_y = block->y[lane] + offset_y;
+    i32 col0 = floorf((f32) (body_x - 1 - map_x) / cell_size);
+    i32 col1 = floorf((f32) (body_x + block->width[lane] + 1 - map_x) / cell_size);
+    i32 row0 = floorf((f32) (body_y - 1 - map_y) / cell_size);
+    i32 row1 = floorf((f32) (body_y + block->height[lane] + 1 - map_y) / cell_size);
+
+    const i32 radius = block->radius[lane];
+    for (i32 row = row0; row <= row1; row++) {
+        u64 span = tilemap_row_span(tilemap, row, col0, col1);
+        while (span != 0) {
+            i32 col = col0 + ctz64(span);
+            span &= span - 1;
+
+            // the edge cells may only be grazed, test them exactly like any other rect
+            i32 cell_x = map_x + col * cell_size;
+            i32 cell_y = map_y + row * cell_size;
+            bool overlaps = (body_shape == SHAPE_CIRC)
+                ? circ_rect_overlaps(body_x + radius, body_y + radius, radius, cell_x, cell_y, cell_size, cell_size)
+                : rect_rect_overlaps(body_x, body_y, block->width[lane], block->height[lane], cell_x, cell_y, cell_size, cell_size);
+            if (overlaps) return true;
+        }
+    }
+    return false;
+}
+
+// mirror the hot collider columns into blocks, see ColliderBlock in game.h
+internal void world_build_collider_blocks() {
+    u32 num_blocks = (world->num_entities + COLLIDER_BLOCK_LANES - 1) / COLLIDER_BLOCK_LANES;
+    MemTag prev_tag = mem_set_tag(MEM_TAG_WORLD);
+    arrsetlen(world->collider_blocks, num_blocks);
+    mem_set_tag(prev_tag);
+
+    for (u32 i = 0; i < num_blocks; i++) {
+        // lanes past the last entity, or without a collider, stay SHAPE_NONE with their bits clear
+        ColliderBlock *block = &world->collider_blocks[i];
+        *block = (ColliderBlock) {0};
+
+        for (u32 lane = 0; lane < COLLIDER_BLOCK_LANES; lane++) {
+            Entity entity = i * COLLIDER_BLOCK_LANES + lane;
+            if (entity >= world->num_entities || !entity_has_components(entity, COMPONENT_COLLIDER)) continue;
+
+            Shape shape = world->colliders.shape[entity];
+            i32 x = world->positions.x[entity] + world->colliders.offset_x[entity];
+            i32 y = world->positions.y[entity] + world->colliders.offset_y[entity];
+            i32 radius = world->colliders.radius[entity];
+            if (shape == SHAPE_CIRC) {
+                x -= radius;
+                y -= radius;
             }
-        } break;
-        case SHAPE_RECT: {
-            switch (world.colliders.shape[b]) {
-                case SHAPE_CIRC: circ_rect_resolve(b, a); break;
-                case SHAPE_RECT: rect_rect_resolve(a, b); break;
-                case SHAPE_NONE:
-                default: break;
+
+            block->x[lane] = x;
+            block->y[lane] = y;
+            block->width[lane] = (shape == SHAPE_CIRC) ? 2 * radius : (i32) world->colliders.width[entity];
+            block->height[lane] = (shape == SHAPE_CIRC) ? 2 * radius : (i32) world->colliders.height[entity];
+            block->radius[lane] = radius;
+            block->mask[lane] = world->colliders.mask[entity];
+            block->shape[lane] = shape;
+            block->colliders |= 1u << lane;
+            if (entity_has_components(entity, COMPONENT_MOVEMENT)) {
+                block->moving |= 1u << lane;
             }
-        } break;
+        }
+    }
+}
 
-        case SHAPE_NONE:
-        default: break;
+// lanes whose collider matches the mask and whose bounds overlap or touch x0..x1, y0..y1
+internal u32 collider_block_candidates(const ColliderBlock *block, i32 x0, i32 y0, i32 x1, i32 y1, CollisionMask mask) {
+    u32 hits = 0;
+#if SIMD_SSE2
+    const __m128i v_x0 = _mm_set1_epi32(x0);
+    const __m128i v_y0 = _mm_set1_epi32(y0);
+    const __m128i v_x1 = _mm_set1_epi32(x1);
+    const __m128i v_y1 = _mm_set1_epi32(y1);
+    const __m128i v_mask = _mm_set1_epi32(mask);
+    for (u32 half = 0; half < COLLIDER_BLOCK_LANES; half += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *) &block->x[half]);
+        __m128i y = _mm_loadu_si128((const __m128i *) &block->y[half]);
+        __m128i right = _mm_add_epi32(x, _mm_loadu_si128((const __m128i *) &block->width[half]));
+        __m128i bottom = _mm_add_epi32(y, _mm_loadu_si128((const __m128i *) &block->height[half]));
+
+        __m128i apart = _mm_or_si128(_mm_cmpgt_epi32(x, v_x1), _mm_cmpgt_epi32(v_x0, right));
+        apart = _mm_or_si128(apart, _mm_or_si128(_mm_cmpgt_epi32(y, v_y1), _mm_cmpgt_epi32(v_y0, bottom)));
+        __m128i masked = _mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128((const __m128i *) &block->mask[half]), v_mask), v_mask);
+        hits |= _mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(apart, masked))) << half;
     }
+#else
+    for (u32 lane = 0; lane < COLLIDER_BLOCK_LANES; lane++) {
+        bool hit = block->x[lane] <= x1 && block->x[lane] + block->width[lane] >= x0
+                && block->y[lane] <= y1 && block->y[lane] + block->height[lane] >= y0
+                && (block->mask[lane] & mask) == mask;
+        hits |= hit << lane;
+    }
+#endif
+    return hits & block->colliders;
 }
 
-internal void circ_circ_resolve(Entity entity, Entity collided_with) {
-    f32 dx = world.positions.x[entity] - world.positions.x[collided_with];
-    f32 dy = world.positions.y[entity] - world.positions.y[collided_with];
-    f32 distance = sqrtf(dx * dx + dy * dy);
-    dx /= distance;
-    dy /= distance;
+// pairs with a tilemap skip the kernels, the solver looks up the cells under the body directly
+internal inline void world_add_pair(Entity a, bool a_is_tilemap, Entity b) {
+    if (a_is_tilemap || world->collider_blocks[b / COLLIDER_BLOCK_LANES].shape[b % COLLIDER_BLOCK_LANES] == SHAPE_TILEMAP) {
+        contact_solver_add(&world->solver, a, b);
+    } else {
+        narrow_phase_add_pair(&world->narrow_phase, a, b);
+    }
+}
 
-    f32 overlap = (world.colliders.radius[entity] + world.colliders.radius[collided_with]) - distance;
-    world.positions.x[entity] -= dx * overlap / 2;
-    world.positions.y[entity] -= dy * overlap / 2;
-    world.positions.x[collided_with] += dx * overlap / 2;
-    world.positions.y[collided_with] += dy * overlap / 2;
+internal void world_resolve_overlaps(f32 dt) {
+    NarrowPhase *narrow = &world->narrow_phase;
+
+    // pairs come from the spatial index over the moved positions, the narrow phase only reports pairs
+    // within the contact margin so anything farther apart can't matter. small worlds skip the index
+    // and take every later collider, either way candidates are in entity order so the pairs are too.
+    // two bodies that can't move can never need pushing apart
+    const ColliderBlock *blocks = world->collider_blocks;
+    const u32 num_blocks = arrlen(blocks);
+    u32 num_colliders = 0;
+    u32 num_circles = 0;
+    u32 num_rects = 0;
+    for (u32 b = 0; b < num_blocks; b++) {
+        for (u32 bits = blocks[b].colliders; bits != 0; bits &= bits - 1) {
+            u8 shape = blocks[b].shape[ctz64(bits)];
+            num_circles += shape == SHAPE_CIRC;
+            num_rects += shape == SHAPE_RECT;
+            num_colliders++;
+        }
+    }
+    const bool use_index = num_colliders >= SPATIAL_BROAD_PHASE_MIN_COLLIDERS;
+    if (use_index) {
+        world_build_spatial_index();
+    }
 
-    // TODO - resolve velocities, just invert them for now
-    world.movements.vel_x[entity] *= -1;
-    world.movements.vel_y[entity] *= -1;
-    world.movements.vel_x[collided_with] *= -1;
-    world.movements.vel_y[collided_with] *= -1;
-}
+    ContactSolver *solver = &world->solver;
+    MemTag prev_tag = mem_set_tag(MEM_TAG_WORLD);
+    contact_solver_begin(solver, num_colliders);
+    narrow_phase_begin(narrow, solver->contact_margin, num_circles, num_rects);
+    const i32 margin = (i32) ceilf(solver->contact_margin) + 1;
+    Entity **candidates = &world->spatial.candidates;
+    // one collider's candidates are at most every other collider, so this never grows mid tick
+    arrsetcap(*candidates, num_colliders);
+    for (u32 i = 0; i < world->num_entities; i++) {
+        const u32 first_block = i / COLLIDER_BLOCK_LANES;
+        const u32 i_bit = 1u << (i % COLLIDER_BLOCK_LANES);
+        if ((blocks[first_block].colliders & i_bit) == 0) continue;
+        bool i_moves = (blocks[first_block].moving & i_bit) != 0;
+        bool i_is_tilemap = blocks[first_block].shape[i % COLLIDER_BLOCK_LANES] == SHAPE_TILEMAP;
+
+        if (!use_index) {
+            // the lanes after i in its own block, then every later block whole
+            for (u32 b = first_block; b < num_blocks; b++) {
+                u32 others = i_moves ? blocks[b].colliders : blocks[b].moving;
+                if (b == first_block) others &= ~((i_bit << 1) - 1);
+
+                while (others != 0) {
+                    u32 lane = ctz64(others);
+                    others &= others - 1;
+                    world_add_pair(i, i_is_tilemap, b * COLLIDER_BLOCK_LANES + lane);
+                }
+            }
+            continue;
+        }
 
-internal void circ_rect_resolve(Entity entity, Entity collided_with) {
-    i32 cx = world.positions.x[entity] + world.colliders.offset_x[entity];
-    i32 cy = world.positions.y[entity] + world.colliders.offset_y[entity];
-    i32 cr = world.colliders.radius[entity];
+        arrsetlen(*candidates, 0);
+        spatial_index_candidates(i, margin, candidates);
+        for (u32 c = 0; c < arrlen(*candidates); c++) {
+            Entity j = (*candidates)[c];
+            u32 b = j / COLLIDER_BLOCK_LANES;
+            if (b >= num_blocks) continue;
 
-    i32 rx = world.positions.x[collided_with] + world.colliders.offset_x[collided_with];
-    i32 ry = world.positions.y[collided_with] + world.colliders.offset_y[collided_with];
-    i32 rw = world.colliders.width[collided_with];
-    i32 rh = world.colliders.height[collided_with];
+            u32 others = i_moves ? blocks[b].colliders : blocks[b].moving;
+            if (others & (1u << (j % COLLIDER_BLOCK_LANES))) {
+                world_add_pair(i, i_is_tilemap, j);
+            }
+        }
+    }
+    narrow_phase_run(narrow);
 
-    i32 nearest_x = calc_max(rx, calc_min(cx, rx + rw));
-    i32 nearest_y = calc_max(ry, calc_min(cy, ry + rh));
-    i32 dx = nearest_x - cx;
-    i32 dy = nearest_y - cy;
+    world->stats.collision_checks += narrow_phase_pair_count(narrow);
 
-    f32 distance = sqrtf(dx * dx + dy * dy);
-    f32 overlap = cr - distance;
+    // the kernels only say which pairs touch, the solver works out the contact for each
+    for (u32 kind = 0; kind < PAIR_KIND_COUNT; kind++) {
+        PairBucket *bucket = &narrow->buckets[kind];
+        for (u32 batch = 0; batch < arrlen(bucket->hit_masks); batch++) {
+            u32 mask = bucket->hit_masks[batch];
+            for (u32 lane = 0; mask != 0; lane++, mask >>= 1) {
+                if ((mask & 1) == 0) continue;
 
-    if (distance == 0) {
-        // special case, circle exactly at the center of rectangle
-        world.positions.x[entity] += cr;
-        world.positions.y[entity] += cr;
-    } else {
-        dx /= distance;
-        dy /= distance;
-        // move circle out of rect by overlap amount in direction vector
-        world.positions.x[entity] -= dx * overlap;
-        world.positions.y[entity] -= dy * overlap;
+                u32 pair = batch * NARROW_PHASE_BATCH + lane;
+                contact_solver_add(solver, bucket->a[pair], bucket->b[pair]);
+            }
+        }
     }
+    contact_solver_run(solver, dt);
+    mem_set_tag(prev_tag);
 
-    // resolve velocities
-    // TODO - invert the circle for now
-    //   better will be to figure out which axes were overlapped,
-    //   and resolve taking that and movement direction into account
-    world.movements.vel_x[entity] *= -1;
-    world.movements.vel_y[entity] *= -1;
+    world->stats.contacts = arrlen(solver->contacts);
 }
 
-internal void rect_rect_resolve(Entity entity, Entity collided_with) {
-    i32 x1 = world.positions.x[entity] + world.colliders.offset_x[entity];
-    i32 y1 = world.positions.y[entity] + world.colliders.offset_y[entity];
-    i32 w1 = world.colliders.width[entity];
-    i32 h1 = world.colliders.height[entity];
+internal Entity world_check_collisions(Entity entity, u32 mask, int offset_x, int offset_y) {
+    const ColliderBlock *blocks = world->collider_blocks;
+    const u32 entity_block = entity / COLLIDER_BLOCK_LANES;
+    const u32 entity_lane = entity % COLLIDER_BLOCK_LANES;
+    if ((blocks[entity_block].colliders & (1u << entity_lane)) == 0) {
+        return ENTITY_NONE;
+    }
+
+    // stream the blocks, only lanes whose bounds reach the moved bounds get the exact test
+    i32 x0 = blocks[entity_block].x[entity_lane] + offset_x;
+    i32 y0 = blocks[entity_block].y[entity_lane] + offset_y;
+    i32 x1 = x0 + blocks[entity_block].width[entity_lane];
+    i32 y1 = y0 + blocks[entity_block].height[entity_lane];
+    for (u32 b = 0; b < arrlen(blocks); b++) {
+        u32 candidates = collider_block_candidates(&blocks[b], x0, y0, x1, y1, mask);
+        if (b == entity_block) candidates &= ~(1u << entity_lane);
+
+        while (candidates != 0) {
+            Entity other = b * COLLIDER_BLOCK_LANES + ctz64(candidates);
+            candidates &= candidates - 1;
+
+            if (entities_overlap(entity, other, offset_x, offset_y)) {
+                return other;
+            }
+        }
+    }
+    return ENTITY_NONE;
+}
 
-    i32 x2 = world.positions.x[collided_with] + world.colliders.offset_x[collided_with];
-    i32 y2 = world.positions.y[collided_with] + world.colliders.offset_y[collided_with];
-    i32 w2 = world.colliders.width[collided_with];
-    i32 h2 = world.colliders.height[collided_with];
+internal void world_queue_hit_event(Entity entity, Entity other, Axis axis, i32 sign, OnHitFunc on_hit) {
+    i32 x = world->positions.x[entity] + world->colliders.offset_x[entity];
+    i32 y = world->positions.y[entity] + world->colliders.offset_y[entity];
 
-    i32 overlap_l = (x1 + w1) - x2;
-    i32 overlap_r = (x2 + w2) - x1;
-    i32 overlap_t = (y1 + h1) - y2;
-    i32 overlap_b = (y2 + h2) - y1;
+    // circles are positioned by their center, rects by their corner
+    i32 half_w, half_h;
+    if (world->colliders.shape[entity] == SHAPE_CIRC) {
+        half_w = half_h = world->colliders.radius[entity];
+    } else {
+        half_w = world->colliders.width[entity] / 2;
+        half_h = world->colliders.height[entity] / 2;
+        x += half_w;
+        y += half_h;
+    }
 
-    i32 min_overlap = overlap_l;
-    if (overlap_r < min_overlap) min_overlap = overlap_r;
-    if (overlap_t < min_overlap) min_overlap = overlap_t;
-    if (overlap_b < min_overlap) min_overlap = overlap_b;
+    // the contact point is on the leading edge of the collider along the axis of movement
+    CollisionEvent event = {
+        .entity = entity,
+        .other = other,
+        .axis = axis,
+        .contact_x = x + (axis == AXIS_X ? sign * half_w : 0),
+        .contact_y = y + (axis == AXIS_Y ? sign * half_h : 0),
+        .on_hit = on_hit,
+    };
+    MemTag prev_tag = mem_set_tag(MEM_TAG_EVENTS);
+    arrput(world->hit_events.queued, event);
+    mem_set_tag(prev_tag);
+}
 
-    if      (min_overlap == overlap_l) world.positions.x[entity] -= overlap_l;
-    else if (min_overlap == overlap_r) world.positions.x[entity] += overlap_r;
-    else if (min_overlap == overlap_t) world.positions.y[entity] -= overlap_t;
-    else if (min_overlap == overlap_b) world.positions.y[entity] += overlap_b;
+internal u32 world_find_hit_handler(OnHitFunc on_hit) {
+    CollisionEvents *events = &world->hit_events;
+    for (u32 i = 0; i < arrlen(events->handlers); i++) {
+        if (events->handlers[i] == on_hit) return i;
+    }
 
-    // TODO - resolve velocities
+    arrput(events->handlers, on_hit);
+    arrput(events->handler_counts, 0);
+    return arrlen(events->handlers) - 1;
 }
 
-internal Entity world_check_collisions(Entity entity, u32 mask, int offset_x, int offset_y) {
-    Colliders *colliders = &world.colliders;
+internal void world_dispatch_hit_events() {
+    CollisionEvents *events = &world->hit_events;
+    u32 num_events = arrlen(events->queued);
+    if (num_events == 0) return;
+
+    MemTag prev_tag = mem_set_tag(MEM_TAG_EVENTS);
+
+    // regroup the queue by handler so each callback runs back to back,
+    // it's a stable counting sort so events keep their queue order within a handler.
+    // there's only ever a handful of distinct handlers, so a linear search is fine
+    arrsetlen(events->handlers, 0);
+    arrsetlen(events->handler_counts, 0);
+    for (u32 i = 0; i < num_events; i++) {
+        u32 handler = world_find_hit_handler(events->queued[i].on_hit);
+        events->handler_counts[handler]++;
+    }
 
-    for (u32 other = 0; other < world.num_entities; ++other) {
-        bool is_different = (other != entity);
-        bool is_masked = (colliders->mask[other] & mask) == mask;
-        bool this_has_collider = entity_has_components(entity, COMPONENT_COLLIDER);
-        bool that_has_collider = entity_has_components(other, COMPONENT_COLLIDER);
+    u32 offset = 0;
+    for (u32 i = 0; i < arrlen(events->handler_counts); i++) {
+        u32 count = events->handler_counts[i];
+        events->handler_counts[i] = offset;
+        offset += count;
+    }
 
-        // skip entities that don't need to be processed
-        if (!is_different || !is_masked || !this_has_collider || !that_has_collider) {
-            continue;
-        }
+    arrsetlen(events->sorted, num_events);
+    for (u32 i = 0; i < num_events; i++) {
+        u32 handler = world_find_hit_handler(events->queued[i].on_hit);
+        events->sorted[events->handler_counts[handler]++] = events->queued[i];
+    }
+    arrsetlen(events->queued, 0);
+    mem_set_tag(prev_tag);
 
-        if (entities_overlap(entity, other, offset_x, offset_y)) {
-            return other;
-        }
+    for (u32 i = 0; i < num_events; i++) {
+        CollisionEvent *event = &events->sorted[i];
+        events->dispatching = event;
+        event->on_hit(event->entity, event->other);
     }
-    return ENTITY_NONE;
+    events->dispatching = NULL;
 }
 
 internal bool entity_move_x(Entity entity, f32 amount) {
@@ -380,13 +755,17 @@ internal bool entity_move_x(Entity entity, f32 amount) {
         while (amount != 0) {
             Entity would_collide_with = world_check_collisions(entity, MASK_BOUNDS, sign, 0);
             if (would_collide_with != ENTITY_NONE) {
-                OnHitFunc on_hit = world.colliders.on_hit_x[entity];
-                if (on_hit) {
+                OnHitFunc on_hit = world->colliders.on_hit_x[entity];
+                if (on_hit && world->defer_hit_events) {
+                    world_queue_hit_event(entity, would_collide_with, AXIS_X, sign, on_hit);
+                } else if (on_hit) {
                     on_hit(entity, would_collide_with);
+                    // the handler can move, add or remove anything, catch the blocks up
+                    world_build_collider_blocks();
                 } else {
                     // stop
-                    world.movements.vel_x[entity] = 0;
-                    world.movements.remainder_x[entity] = 0;
+                    world->movements.vel_x[entity] = 0;
+                    world->movements.remainder_x[entity] = 0;
                 }
 
                 // moving any further would cause an overlap of colliders
@@ -395,11 +774,12 @@ internal bool entity_move_x(Entity entity, f32 amount) {
 
             // won't collide, move one unit
             amount -= sign;
-            world.positions.x[entity] += sign;
+            world->positions.x[entity] += sign;
+            world->collider_blocks[entity / COLLIDER_BLOCK_LANES].x[entity % COLLIDER_BLOCK_LANES] += sign;
         }
     } else {
         // no collider, just move the full amount
-        world.positions.x[entity] += amount;
+        world->positions.x[entity] += amount;
     }
 
     // didn't hit anything
@@ -413,13 +793,17 @@ internal bool entity_move_y(Entity entity, f32 amount) {
         while (amount != 0) {
             Entity would_collide_with = world_check_collisions(entity, MASK_BOUNDS, 0, sign);
             if (would_collide_with != ENTITY_NONE) {
-                OnHitFunc on_hit = world.colliders.on_hit_y[entity];
-                if (on_hit) {
+                OnHitFunc on_hit = world->colliders.on_hit_y[entity];
+                if (on_hit && world->defer_hit_events) {
+                    world_queue_hit_event(entity, would_collide_with, AXIS_Y, sign, on_hit);
+                } else if (on_hit) {
                     on_hit(entity, would_collide_with);
+                    // the handler can move, add or remove anything, catch the blocks up
+                    world_build_collider_blocks();
                 } else {
                     // stop
-                    world.movements.vel_y[entity] = 0;
-                    world.movements.remainder_y[entity] = 0;
+                    world->movements.vel_y[entity] = 0;
+                    world->movements.remainder_y[entity] = 0;
                 }
 
                 // moving any further would cause an overlap of colliders
@@ -428,89 +812,122 @@ internal bool entity_move_y(Entity entity, f32 amount) {
 
             // won't collide, move one unit
             amount -= sign;
-            world.positions.y[entity] += sign;
+            world->positions.y[entity] += sign;
+            world->collider_blocks[entity / COLLIDER_BLOCK_LANES].y[entity % COLLIDER_BLOCK_LANES] += sign;
         }
     } else {
         // no collider, just move the full amount
-        world.positions.y[entity] += amount;
+        world->positions.y[entity] += amount;
     }
 
     // didn't hit anything
     return false;
 }
 
+// zero when stats are off, so the phase timings just add up to nothing
+internal f64 world_stats_clock() {
+    return world->collect_stats ? os_now_seconds() : 0;
+}
+
 internal void entity_create_infos() {
-    arrput(world.infos.active, false);
-    arrput(world.infos.in_use, false);
-    arrput(world.infos.components, COMPONENT_NONE);
+    arrput(world->infos.active, false);
+    arrput(world->infos.in_use, false);
+    arrput(world->infos.components, COMPONENT_NONE);
+    arrput(world->infos.signatures, (ComponentSignature) {0});
 }
 
 internal void entity_create_names() {
-    arrput(world.names.name, NAME_EMPTY);
+    arrput(world->names.name, NAME_EMPTY);
 }
 
 internal void entity_create_positions() {
-    arrput(world.positions.x, 0);
-    arrput(world.positions.y, 0);
-    arrput(world.positions.prev_x, 0);
-    arrput(world.positions.prev_y, 0);
+    arrput(world->positions.x, 0);
+    arrput(world->positions.y, 0);
+    arrput(world->positions.prev_x, 0);
+    arrput(world->positions.prev_y, 0);
 }
 
 internal void entity_create_velocities() {
-    arrput(world.movements.vel_x, 0);
-    arrput(world.movements.vel_y, 0);
-    arrput(world.movements.remainder_x, 0);
-    arrput(world.movements.remainder_y, 0);
-    arrput(world.movements.friction, 0);
-    arrput(world.movements.gravity, 0);
+    arrput(world->movements.vel_x, 0);
+    arrput(world->movements.vel_y, 0);
+    arrput(world->movements.remainder_x, 0);
+    arrput(world->movements.remainder_y, 0);
+    arrput(world->movements.friction, 0);
+    arrput(world->movements.gravity, 0);
+    arrput(world->movements.inv_mass, 0);
+    arrput(world->movements.restitution, 0);
+    arrput(world->movements.contact_friction, 0);
+    arrput(world->movements.sleep_seconds, 0);
+    arrput(world->movements.asleep, false);
 }
 
 internal void entity_create_colliders() {
-    arrput(world.colliders.offset_x, 0);
-    arrput(world.colliders.offset_y, 0);
-    arrput(world.colliders.width, 0);
-    arrput(world.colliders.height, 0);
-    arrput(world.colliders.radius, 0);
-    arrput(world.colliders.shape, SHAPE_NONE);
-    arrput(world.colliders.mask, MASK_NONE);
-    arrput(world.colliders.on_hit_x, NULL);
-    arrput(world.colliders.on_hit_y, NULL);
+    arrput(world->colliders.offset_x, 0);
+    arrput(world->colliders.offset_y, 0);
+    arrput(world->colliders.width, 0);
+    arrput(world->colliders.height, 0);
+    arrput(world->colliders.radius, 0);
+    arrput(world->colliders.shape, SHAPE_NONE);
+    arrput(world->colliders.mask, MASK_NONE);
+    arrput(world->colliders.on_hit_x, NULL);
+    arrput(world->colliders.on_hit_y, NULL);
+    arrput(world->colliders.tilemaps, (Tilemap) {0});
+}
+
+internal void entity_cleanup_hit_events() {
+    arrfree(world->hit_events.queued);
+    arrfree(world->hit_events.sorted);
+    arrfree(world->hit_events.handlers);
+    arrfree(world->hit_events.handler_counts);
 }
 
 internal void entity_cleanup_infos() {
-    arrfree(world.infos.active);
-    arrfree(world.infos.in_use);
-    arrfree(world.infos.components);
+    arrfree(world->infos.active);
+    arrfree(world->infos.in_use);
+    arrfree(world->infos.components);
+    arrfree(world->infos.signatures);
 }
 
 internal void entity_cleanup_names() {
-    arrfree(world.names.name);
+    arrfree(world->names.name);
 }
 
 internal void entity_cleanup_positions() {
-    arrfree(world.positions.x);
-    arrfree(world.positions.y);
-    arrfree(world.positions.prev_x);
-    arrfree(world.positions.prev_y);
+    arrfree(world->positions.x);
+    arrfree(world->positions.y);
+    arrfree(world->positions.prev_x);
+    arrfree(world->positions.prev_y);
 }
 
 internal void entity_cleanup_velocities() {
-    arrfree(world.movements.vel_x);
-    arrfree(world.movements.vel_y);
-    arrfree(world.movements.remainder_x);
-    arrfree(world.movements.remainder_y);
+    arrfree(world->movements.vel_x);
+    arrfree(world->movements.vel_y);
+    arrfree(world->movements.remainder_x);
+    arrfree(world->movements.remainder_y);
+    arrfree(world->movements.friction);
+    arrfree(world->movements.gravity);
+    arrfree(world->movements.inv_mass);
+    arrfree(world->movements.restitution);
+    arrfree(world->movements.contact_friction);
+    arrfree(world->movements.sleep_seconds);
+    arrfree(world->movements.asleep);
 }
 
 internal void entity_cleanup_colliders() {
-    arrfree(world.colliders.offset_x);
-    arrfree(world.colliders.offset_y);
-    arrfree(world.colliders.width);
-    arrfree(world.colliders.height);
-    arrfree(world.colliders.radius);
-    arrfree(world.colliders.shape);
-    arrfree(world.colliders.mask);
-    arrfree(world.colliders.on_hit_x);
-    arrfree(world.colliders.on_hit_y);
+    arrfree(world->colliders.offset_x);
+    arrfree(world->colliders.offset_y);
+    arrfree(world->colliders.width);
+    arrfree(world->colliders.height);
+    arrfree(world->colliders.radius);
+    arrfree(world->colliders.shape);
+    arrfree(world->colliders.mask);
+    arrfree(world->colliders.on_hit_x);
+    arrfree(world->colliders.on_hit_y);
+    for (u32 i = 0; i < arrlen(world->colliders.tilemaps); i++) {
+        arrfree(world->colliders.tilemaps[i].cells);
+    }
+    arrfree(world->colliders.tilemaps);
+    arrfree(world->collider_blocks);
 }
 
 typedef struct {
@@ -536,11 +953,11 @@ typedef struct {
     u32 radius;
 } EntityData;
 
-internal void world_log() {
-    TraceLog(LOG_INFO, "world: %d entities", world.num_entities);
+void world_log() {
+    TraceLog(LOG_INFO, "world: %d entities", world->num_entities);
     TraceLog(LOG_INFO, "--------------------------------------");
 
-    for (u32 i = 0; i < world.num_entities; ++i) {
+    for (u32 i = 0; i < world->num_entities; ++i) {
         if (i == ENTITY_NONE) {
             continue;
         }
@@ -548,33 +965,33 @@ internal void world_log() {
         EntityData e = {0};
         e.entity = i;
 
-        e.in_use = world.infos.in_use[i];
-        e.active = world.infos.active[i];
-        e.components = world.infos.components[i];
+        e.in_use = world->infos.in_use[i];
+        e.active = world->infos.active[i];
+        e.components = world->infos.components[i];
 
         if (entity_has_components(i, COMPONENT_NAME)) {
-            e.name = &world.names.name[i];
+            e.name = &world->names.name[i];
         }
         if (entity_has_components(i, COMPONENT_POSITION)) {
-            e.x = world.positions.x[i];
-            e.y = world.positions.y[i];
-            e.prev_x = world.positions.prev_x[i];
-            e.prev_y = world.positions.prev_y[i];
+            e.x = world->positions.x[i];
+            e.y = world->positions.y[i];
+            e.prev_x = world->positions.prev_x[i];
+            e.prev_y = world->positions.prev_y[i];
         }
         if (entity_has_components(i, COMPONENT_MOVEMENT)) {
-            e.vel_x = world.movements.vel_x[i];
-            e.vel_y = world.movements.vel_y[i];
-            e.remainder_x = world.movements.remainder_x[i];
-            e.remainder_y = world.movements.remainder_y[i];
-            e.friction = world.movements.friction[i];
-            e.gravity = world.movements.gravity[i];
+            e.vel_x = world->movements.vel_x[i];
+            e.vel_y = world->movements.vel_y[i];
+            e.remainder_x = world->movements.remainder_x[i];
+            e.remainder_y = world->movements.remainder_y[i];
+            e.friction = world->movements.friction[i];
+            e.gravity = world->movements.gravity[i];
         }
         if (entity_has_components(i, COMPONENT_COLLIDER)) {
-            e.offset_x = world.colliders.offset_x[i];
-            e.offset_y = world.colliders.offset_y[i];
-            e.width = world.colliders.width[i];
-            e.height = world.colliders.height[i];
-            e.radius = world.colliders.radius[i];
+            e.offset_x = world->colliders.offset_x[i];
+            e.offset_y = world->colliders.offset_y[i];
+            e.width = world->colliders.width[i];
+            e.height = world->colliders.height[i];
+            e.radius = world->colliders.radius[i];
         }
 
         TraceLog(LOG_INFO, "Entity %d (in_use: %d, active: %d, components: %#x): name: '%s', pos: (%d, %d), prev_pos: (%d, %d), vel: (%.2f, %.2f), remainder: (%.2f, %.2f), friction: %.2f, gravity: %.2f, collider: (%d, %d, %d, %d, %d)",
@@ -583,3 +1000,9 @@ internal void world_log() {
 
     TraceLog(LOG_INFO, "--------------------------------------\n");
 }
+
+// ----------------------------------------------------------------------------
+// Include single file header implementations
+
+#define STB_DS_IMPLEMENTATION
+#include "stb_ds.h"